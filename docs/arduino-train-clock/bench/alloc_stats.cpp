@@ -0,0 +1,130 @@
+/**
+ * Heap Accounting - implementation
+ *
+ * See alloc_stats.h for an overview. The benchmark is single-threaded, so
+ * the counters are plain variables.
+ */
+
+#include "alloc_stats.h"
+
+#include <stdlib.h>
+#include <new>
+
+static AllocStats stats;
+
+static void noteAllocation(size_t requested, size_t held) {
+  stats.allocations++;
+  stats.requestedBytes += requested;
+  stats.liveBytes += held;
+  if (stats.liveBytes > stats.peakBytes) stats.peakBytes = stats.liveBytes;
+}
+
+AllocStats allocStats() {
+  return stats;
+}
+
+void resetAllocPeak() {
+  stats.peakBytes = stats.liveBytes;
+}
+
+#ifdef BENCH_WRAP_MALLOC
+
+// Linked with -Wl,--wrap=malloc (etc.): every call to malloc() in the
+// program lands in __wrap_malloc(), and __real_malloc() is the C library's
+
+#include <malloc.h>
+
+extern "C" {
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* block, size_t size);
+void __real_free(void* block);
+
+void* __wrap_malloc(size_t size) {
+  void* block = __real_malloc(size);
+  if (block) noteAllocation(size, malloc_usable_size(block));
+  return block;
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+  void* block = __real_calloc(count, size);
+  if (block) noteAllocation(count * size, malloc_usable_size(block));
+  return block;
+}
+
+void* __wrap_realloc(void* block, size_t size) {
+  size_t held = block ? malloc_usable_size(block) : 0;
+  void* moved = __real_realloc(block, size);
+  if (moved) {
+    stats.liveBytes -= held;
+    noteAllocation(size, malloc_usable_size(moved));
+  } else if (size == 0) {
+    stats.liveBytes -= held; // realloc(block, 0) may free the block
+  }
+  return moved;
+}
+
+void __wrap_free(void* block) {
+  if (block) stats.liveBytes -= malloc_usable_size(block);
+  __real_free(block);
+}
+} // extern "C"
+
+bool mallocTracked() {
+  return true;
+}
+
+// operator new goes through the wrapped malloc
+void* operator new(size_t size) {
+  void* block = malloc(size ? size : 1);
+  if (!block) throw std::bad_alloc();
+  return block;
+}
+
+void operator delete(void* block) noexcept {
+  free(block);
+}
+
+#else // BENCH_WRAP_MALLOC
+
+// Without the wrappers only operator new is seen; each block carries its
+// size in a header so delete can account for it
+
+static const size_t HEADER_SIZE = alignof(max_align_t);
+
+bool mallocTracked() {
+  return false;
+}
+
+void* operator new(size_t size) {
+  char* block = (char*)malloc(HEADER_SIZE + size);
+  if (!block) throw std::bad_alloc();
+  *(size_t*)block = size;
+  noteAllocation(size, size);
+  return block + HEADER_SIZE;
+}
+
+void operator delete(void* block) noexcept {
+  if (!block) return;
+  char* start = (char*)block - HEADER_SIZE;
+  stats.liveBytes -= *(size_t*)start;
+  free(start);
+}
+
+#endif // BENCH_WRAP_MALLOC
+
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+
+void operator delete[](void* block) noexcept {
+  operator delete(block);
+}
+
+void operator delete(void* block, size_t) noexcept {
+  operator delete(block);
+}
+
+void operator delete[](void* block, size_t) noexcept {
+  operator delete(block);
+}
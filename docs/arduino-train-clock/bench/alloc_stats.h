@@ -0,0 +1,44 @@
+/**
+ * Heap Accounting for the native benchmark
+ *
+ * Counts every allocation the measured code makes and tracks the bytes
+ * live at once, so a stage can report allocations per run and its peak
+ * heap above where it started.
+ *
+ * operator new/delete are replaced everywhere. malloc, calloc, realloc
+ * and free (which ArduinoJson's default allocator calls) are only seen on
+ * Linux, where bench/track_malloc.py links them through wrappers; there
+ * mallocTracked() is true. Live bytes count malloc_usable_size(), the
+ * heap a block really takes.
+ *
+ * Usage:
+ *   AllocStats before = allocStats();
+ *   resetAllocPeak();
+ *   ...
+ *   AllocStats after = allocStats();
+ *   after.allocations - before.allocations;   // allocations made
+ *   after.peakBytes - before.liveBytes;       // peak heap growth
+ */
+
+#ifndef ALLOC_STATS_H
+#define ALLOC_STATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct AllocStats {
+  uint64_t allocations;    // Blocks allocated (realloc counts as one)
+  uint64_t requestedBytes; // Bytes asked for by those allocations
+  int64_t liveBytes;       // Heap held right now
+  int64_t peakBytes;       // Most heap held since resetAllocPeak()
+};
+
+AllocStats allocStats();
+
+// Start a new peak from the current live bytes
+void resetAllocPeak();
+
+// True when malloc and friends are counted, not just operator new
+bool mallocTracked();
+
+#endif // ALLOC_STATS_H
@@ -0,0 +1,513 @@
+/**
+ * Parse/Render Benchmark for Metro-North Railroad Train Clock
+ *
+ * Replays recorded /trains responses through the firmware's own decoder,
+ * train table and display code on a desktop, and reports for each stage:
+ * time per run, throughput, heap allocations per run and the peak heap
+ * above where the stage started. Built by the `native` env:
+ *
+ *   pio run -e native
+ *   .pio/build/native/program [options] [payload files or directories]
+ *
+ * With no payloads given, every file in bench/payloads is replayed. Files
+ * ending in .msgpack are decoded as MessagePack; JSON payloads are also
+ * converted to MessagePack and replayed in both formats.
+ *
+ * Stages, per payload:
+ *   decode           body -> TrainTable (TrainDecoder::decode)
+ *   merge            two copies of the table -> one board (TrainTable::merge)
+ *   serial_board     full boxed board to the serial monitor (SerialDisplay)
+ *   serial_tick      countdown list (SerialDisplay::tick)
+ *   grid_20x4        full frame of a 20x4 character LCD
+ *   grid_53x30       full frame of a 320x240 TFT at text size 1
+ *   grid_53x30_tick  compose and diff with nothing changed (each tick)
+ *
+ * Options:
+ *   --time MS        Shortest timed batch per stage (default 200)
+ *   --save FILE      Write the results as a baseline
+ *   --check FILE     Compare with a baseline; exit 1 when allocations,
+ *                    allocated bytes or peak heap of any stage grew by more
+ *                    than the tolerance, or a payload no longer decodes
+ *   --tolerance PCT  Allowed memory growth for --check (default 10)
+ *   --time-tolerance PCT
+ *                    Also fail --check when a stage got this much slower
+ *                    (off by default: timings vary between machines)
+ */
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <dirent.h>
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "alloc_stats.h"
+#include "config_defaults.h"
+#include "grid_display.h"
+#include "serial_display.h"
+#include "train_decoder.h"
+#include "train_table.h"
+#include "wall_clock.h"
+
+static const char* const DEFAULT_PAYLOAD_DIR = "bench/payloads";
+
+// Timed batches per stage; the fastest counts
+static const int BATCHES = 3;
+
+// Slack on top of the percentage tolerance, so tiny numbers (0 -> 1
+// allocation, a few bytes of peak) do not fail a check
+static const double ALLOCATION_SLACK = 0.5;
+static const double BYTES_SLACK = 64;
+
+/**
+ * Stream over a payload held in memory
+ */
+class MemoryStream : public Stream {
+ public:
+  MemoryStream(const uint8_t* data, size_t size) : data(data), size(size) {}
+
+  int available() override { return (int)(size - position); }
+  int read() override { return position < size ? data[position++] : -1; }
+  int peek() override { return position < size ? data[position] : -1; }
+
+  size_t readBytes(char* buffer, size_t length) override {
+    size_t count = std::min(length, size - position);
+    memcpy(buffer, data + position, count);
+    position += count;
+    return count;
+  }
+
+  size_t write(uint8_t) override { return 0; }
+
+ private:
+  const uint8_t* data;
+  size_t size;
+  size_t position = 0;
+};
+
+/**
+ * Print that only counts what it is sent
+ */
+class NullPrint : public Print {
+ public:
+  size_t write(uint8_t) override {
+    bytes++;
+    return 1;
+  }
+
+  size_t write(const uint8_t*, size_t size) override {
+    bytes += size;
+    return size;
+  }
+
+  size_t bytes = 0;
+};
+
+/**
+ * Character panel of a given size that counts the cells sent to it
+ */
+class BenchGrid : public GridDisplay {
+ public:
+  BenchGrid(uint8_t columns, uint8_t rows, uint8_t mergeGap)
+      : GridDisplay(mergeGap), columns(columns), rows(rows) {}
+
+  bool begin() override {
+    setGeometry(columns, rows);
+    return true;
+  }
+
+  // Forget what the panel shows, so the next board is drawn in full
+  void blank() { panelCleared(); }
+
+  size_t cells = 0;
+
+ protected:
+  void drawRun(uint8_t, uint8_t, const char*, uint8_t length) override {
+    cells += length;
+  }
+
+ private:
+  uint8_t columns;
+  uint8_t rows;
+};
+
+struct Payload {
+  std::string name;
+  PayloadFormat format;
+  std::vector<uint8_t> bytes;
+};
+
+struct StageResult {
+  double microsPerRun;
+  double bytesPerRun;       // Input or output bytes, for throughput
+  double allocationsPerRun;
+  double allocatedPerRun;   // Bytes requested per run
+  int64_t peakBytes;        // Peak heap above the start of the stage
+};
+
+struct Options {
+  unsigned long minBatchMicros = 200000;
+  std::string savePath;
+  std::string checkPath;
+  double tolerance = 10;
+  double timeTolerance = -1;
+  std::vector<std::string> paths;
+};
+
+// Large: kept out of main()'s stack frame
+static TrainDecoder decoder;
+static TrainTable table;
+static TrainTable views[2];
+static TrainTable merged;
+static NullPrint serialOut;
+static SerialDisplay serialDisplay(serialOut);
+static BenchGrid lcd(20, 4, 1);
+static BenchGrid tft(53, 30, 0);
+
+/**
+ * Time `run` in batches of growing size until one takes minBatchMicros
+ */
+template <typename Run>
+static StageResult measure(const Options& options, size_t bytesPerRun, Run run) {
+  run(); // Warm up: first-use allocations are not part of a steady run
+
+  unsigned long iterations = 1;
+  double bestMicros = 0;
+  AllocStats before = {};
+  AllocStats after = {};
+
+  for (int batch = 0; batch < BATCHES;) {
+    before = allocStats();
+    resetAllocPeak();
+    unsigned long start = micros();
+    for (unsigned long i = 0; i < iterations; i++) run();
+    unsigned long elapsed = micros() - start;
+    after = allocStats();
+
+    if (elapsed < options.minBatchMicros && batch == 0) {
+      iterations = elapsed > 0
+          ? iterations * options.minBatchMicros / elapsed + 1
+          : iterations * 10;
+      continue;
+    }
+
+    double perRun = (double)elapsed / iterations;
+    if (batch == 0 || perRun < bestMicros) bestMicros = perRun;
+    batch++;
+  }
+
+  StageResult result;
+  result.microsPerRun = bestMicros;
+  result.bytesPerRun = (double)bytesPerRun;
+  result.allocationsPerRun = (double)(after.allocations - before.allocations) / iterations;
+  result.allocatedPerRun = (double)(after.requestedBytes - before.requestedBytes) / iterations;
+  result.peakBytes = after.peakBytes - before.liveBytes;
+  return result;
+}
+
+static bool readFile(const std::string& path, std::vector<uint8_t>& bytes) {
+  FILE* file = fopen(path.c_str(), "rb");
+  if (file == nullptr) return false;
+
+  uint8_t chunk[4096];
+  size_t count;
+  while ((count = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+    bytes.insert(bytes.end(), chunk, chunk + count);
+  }
+  fclose(file);
+  return true;
+}
+
+static bool endsWith(const std::string& text, const char* suffix) {
+  size_t length = strlen(suffix);
+  return text.size() >= length && text.compare(text.size() - length, length, suffix) == 0;
+}
+
+static std::string baseName(const std::string& path) {
+  size_t slash = path.find_last_of('/');
+  return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+/**
+ * Load one payload file; JSON ones also yield a MessagePack copy
+ */
+static bool loadPayload(const std::string& path, std::vector<Payload>& payloads) {
+  Payload payload;
+  payload.name = baseName(path);
+  payload.format = endsWith(path, ".msgpack") ? PAYLOAD_MSGPACK : PAYLOAD_JSON;
+  if (!readFile(path, payload.bytes)) {
+    fprintf(stderr, "Cannot read %s\n", path.c_str());
+    return false;
+  }
+  payloads.push_back(payload);
+
+  if (payload.format == PAYLOAD_JSON) {
+    JsonDocument document;
+    if (deserializeJson(document, (const char*)payload.bytes.data(),
+                        payload.bytes.size()) == DeserializationError::Ok) {
+      std::string packed;
+      serializeMsgPack(document, packed);
+
+      Payload copy;
+      copy.name = payload.name + ">msgpack";
+      copy.format = PAYLOAD_MSGPACK;
+      copy.bytes.assign(packed.begin(), packed.end());
+      payloads.push_back(copy);
+    }
+  }
+  return true;
+}
+
+static bool loadPayloads(const std::string& path, std::vector<Payload>& payloads) {
+  DIR* directory = opendir(path.c_str());
+  if (directory == nullptr) return loadPayload(path, payloads);
+
+  std::vector<std::string> files;
+  while (struct dirent* entry = readdir(directory)) {
+    std::string name = entry->d_name;
+    if (endsWith(name, ".json") || endsWith(name, ".msgpack")) {
+      files.push_back(path + "/" + name);
+    }
+  }
+  closedir(directory);
+
+  std::sort(files.begin(), files.end());
+  bool ok = true;
+  for (const std::string& file : files) ok = loadPayload(file, payloads) && ok;
+  return ok;
+}
+
+static bool parseOptions(int argc, char** argv, Options& options) {
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    bool hasValue = i + 1 < argc;
+
+    if (arg == "--time" && hasValue) {
+      options.minBatchMicros = strtoul(argv[++i], nullptr, 10) * 1000;
+    } else if (arg == "--save" && hasValue) {
+      options.savePath = argv[++i];
+    } else if (arg == "--check" && hasValue) {
+      options.checkPath = argv[++i];
+    } else if (arg == "--tolerance" && hasValue) {
+      options.tolerance = atof(argv[++i]);
+    } else if (arg == "--time-tolerance" && hasValue) {
+      options.timeTolerance = atof(argv[++i]);
+    } else if (arg.compare(0, 2, "--") == 0) {
+      fprintf(stderr, "Unknown or incomplete option %s\n", arg.c_str());
+      return false;
+    } else {
+      options.paths.push_back(arg);
+    }
+  }
+
+  if (options.paths.empty()) options.paths.push_back(DEFAULT_PAYLOAD_DIR);
+  return true;
+}
+
+// Baselines: one line per payload and stage,
+//   <payload> <stage> <us/run> <allocations/run> <bytes/run> <peak bytes>
+typedef std::map<std::string, StageResult> Baseline;
+
+static bool loadBaseline(const std::string& path, Baseline& baseline) {
+  FILE* file = fopen(path.c_str(), "r");
+  if (file == nullptr) return false;
+
+  char payload[128];
+  char stage[64];
+  StageResult result = {};
+  long long peak;
+  while (fscanf(file, "%127s %63s %lf %lf %lf %lld", payload, stage,
+                &result.microsPerRun, &result.allocationsPerRun,
+                &result.allocatedPerRun, &peak) == 6) {
+    result.peakBytes = peak;
+    baseline[std::string(payload) + " " + stage] = result;
+  }
+  fclose(file);
+  return true;
+}
+
+static bool grewBeyond(double now, double before, double tolerance, double slack) {
+  return now > before * (1 + tolerance / 100) + slack;
+}
+
+/**
+ * Compare one result with its baseline; prints what regressed
+ */
+static bool withinBaseline(const Options& options, const std::string& key,
+                           const StageResult& now, const StageResult& before) {
+  bool ok = true;
+  if (grewBeyond(now.allocationsPerRun, before.allocationsPerRun,
+                 options.tolerance, ALLOCATION_SLACK)) {
+    printf("  REGRESSION %s: %.1f allocations/run, baseline %.1f\n",
+           key.c_str(), now.allocationsPerRun, before.allocationsPerRun);
+    ok = false;
+  }
+  if (grewBeyond(now.allocatedPerRun, before.allocatedPerRun,
+                 options.tolerance, BYTES_SLACK)) {
+    printf("  REGRESSION %s: %.0f bytes allocated/run, baseline %.0f\n",
+           key.c_str(), now.allocatedPerRun, before.allocatedPerRun);
+    ok = false;
+  }
+  if (grewBeyond((double)now.peakBytes, (double)before.peakBytes,
+                 options.tolerance, BYTES_SLACK)) {
+    printf("  REGRESSION %s: peak heap %lld bytes, baseline %lld\n", key.c_str(),
+           (long long)now.peakBytes, (long long)before.peakBytes);
+    ok = false;
+  }
+  if (options.timeTolerance >= 0 &&
+      grewBeyond(now.microsPerRun, before.microsPerRun, options.timeTolerance, 0)) {
+    printf("  REGRESSION %s: %.1f us/run, baseline %.1f\n", key.c_str(),
+           now.microsPerRun, before.microsPerRun);
+    ok = false;
+  }
+  return ok;
+}
+
+static void printResult(const std::string& stage, const StageResult& result,
+                        const StageResult* before) {
+  printf("  %-16s %10.2f", stage.c_str(), result.microsPerRun);
+  if (result.bytesPerRun > 0) {
+    printf(" %9.1f", result.bytesPerRun / std::max(result.microsPerRun, 0.001)); // MB/s
+  } else {
+    printf(" %9s", "-");
+  }
+  printf(" %10.1f %10.0f %9lld", result.allocationsPerRun, result.allocatedPerRun,
+         (long long)result.peakBytes);
+  if (before != nullptr && before->microsPerRun > 0) {
+    printf("  %+5.0f%%", (result.microsPerRun / before->microsPerRun - 1) * 100);
+  }
+  printf("\n");
+}
+
+int main(int argc, char** argv) {
+  Options options;
+  if (!parseOptions(argc, argv, options)) return 2;
+
+  std::vector<Payload> payloads;
+  for (const std::string& path : options.paths) {
+    if (!loadPayloads(path, payloads)) return 2;
+  }
+  if (payloads.empty()) {
+    fprintf(stderr, "No payloads found\n");
+    return 2;
+  }
+
+  Baseline baseline;
+  if (!options.checkPath.empty() && !loadBaseline(options.checkPath, baseline)) {
+    fprintf(stderr, "Cannot read baseline %s\n", options.checkPath.c_str());
+    return 2;
+  }
+
+  applyTimeZone();
+  lcd.begin();
+  tft.begin();
+
+  AllocStats start = allocStats();
+  decoder.begin(JSON_ARENA_BYTES);
+  AllocStats filterBuilt = allocStats();
+
+  printf("Train table %u bytes, decoder %u bytes (filter and arena: %llu allocations, %lld bytes heap)\n",
+         (unsigned)sizeof(TrainTable), (unsigned)sizeof(TrainDecoder),
+         (unsigned long long)(filterBuilt.allocations - start.allocations),
+         (long long)(filterBuilt.liveBytes - start.liveBytes));
+  if (!mallocTracked()) {
+    printf("Note: only operator new is counted on this host (ArduinoJson uses malloc)\n");
+  }
+
+  FILE* save = nullptr;
+  if (!options.savePath.empty()) {
+    save = fopen(options.savePath.c_str(), "w");
+    if (save == nullptr) {
+      fprintf(stderr, "Cannot write %s\n", options.savePath.c_str());
+      return 2;
+    }
+  }
+
+  bool ok = true;
+  for (const Payload& payload : payloads) {
+    MemoryStream probe(payload.bytes.data(), payload.bytes.size());
+    table.clear();
+    DeserializationError error = decoder.decode(probe, payload.format, table);
+
+    printf("\n%s: %zu bytes, %u trains kept, %u dropped\n", payload.name.c_str(),
+           payload.bytes.size(), table.count, table.droppedTrains);
+    if (error) {
+      printf("  DECODE FAILED: %s\n", error.c_str());
+      ok = false;
+      continue;
+    }
+    printf("  %-16s %10s %9s %10s %10s %9s\n", "stage", "us/run", "MB/s",
+           "allocs/run", "bytes/run", "peak");
+
+    std::vector<std::pair<std::string, StageResult>> results;
+
+    results.emplace_back("decode", measure(options, payload.bytes.size(), [&] {
+      MemoryStream input(payload.bytes.data(), payload.bytes.size());
+      table.clear();
+      decoder.decode(input, payload.format, table);
+    }));
+
+    views[0] = table;
+    views[1] = table;
+    results.emplace_back("merge", measure(options, 0, [&] {
+      merged.merge(views, 2);
+    }));
+
+    serialOut.bytes = 0;
+    serialDisplay.drawBoard(table, nullptr);
+    results.emplace_back("serial_board", measure(options, serialOut.bytes, [&] {
+      serialDisplay.drawBoard(table, nullptr);
+    }));
+
+    serialOut.bytes = 0;
+    serialDisplay.tick(table, true);
+    results.emplace_back("serial_tick", measure(options, serialOut.bytes, [&] {
+      serialDisplay.tick(table, true);
+    }));
+
+    lcd.blank();
+    lcd.cells = 0;
+    lcd.drawBoard(table, nullptr);
+    results.emplace_back("grid_20x4", measure(options, lcd.cells, [&] {
+      lcd.blank();
+      lcd.drawBoard(table, nullptr);
+    }));
+
+    tft.blank();
+    tft.cells = 0;
+    tft.drawBoard(table, nullptr);
+    results.emplace_back("grid_53x30", measure(options, tft.cells, [&] {
+      tft.blank();
+      tft.drawBoard(table, nullptr);
+    }));
+
+    results.emplace_back("grid_53x30_tick", measure(options, 0, [&] {
+      tft.tick(table, false);
+    }));
+
+    for (const auto& entry : results) {
+      std::string key = payload.name + " " + entry.first;
+      const StageResult& result = entry.second;
+
+      auto found = baseline.find(key);
+      const StageResult* before = found != baseline.end() ? &found->second : nullptr;
+      printResult(entry.first, result, before);
+      if (before != nullptr) ok = withinBaseline(options, key, result, *before) && ok;
+
+      if (save != nullptr) {
+        fprintf(save, "%s %.3f %.2f %.1f %lld\n", key.c_str(), result.microsPerRun,
+                result.allocationsPerRun, result.allocatedPerRun,
+                (long long)result.peakBytes);
+      }
+    }
+  }
+
+  if (save != nullptr) fclose(save);
+
+  if (!options.checkPath.empty()) {
+    printf("\n%s\n", ok ? "Within baseline" : "Regressions found");
+  }
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,95 @@
+#!/usr/bin/env python3
+"""
+Record /trains payloads for the native benchmark (bench/bench.cpp)
+
+Usage:
+    python bench/capture_payloads.py
+        Regenerate the mock payloads in bench/payloads from
+        mock_train_server.py's boards (needs flask importable)
+
+    python bench/capture_payloads.py URL NAME
+        Save the body a live server returns for URL as
+        bench/payloads/NAME.json, e.g.
+        python bench/capture_payloads.py "http://192.168.1.100:5000/trains?limit=50" capture_gtfs_50
+
+Captures are stored as received, so a server schema change shows up in the
+benchmark as soon as a new capture is replayed next to the old one.
+"""
+
+import json
+import os
+import random
+import sys
+import urllib.request
+
+BENCH_DIR = os.path.dirname(os.path.abspath(__file__))
+PAYLOAD_DIR = os.path.join(BENCH_DIR, "payloads")
+
+# Same trips, routes and delays on every run (times follow the clock)
+SEED = 20240501
+
+# Trains per generated board: a quiet station, the default, a full table,
+# and more than the clock keeps (MAX_TRAINS is 20)
+MOCK_COUNTS = [1, 5, 20, 100]
+
+# Stops per train in the "stops" variant, which adds per-stop detail like
+# web_server.py's /trains (the fields the clock does not read)
+STOPS_PER_TRAIN = 8
+
+
+def mock_payloads():
+    """{name: payload} built from mock_train_server's Board"""
+    sys.path.insert(0, os.path.dirname(BENCH_DIR))
+    import mock_train_server
+
+    random.seed(SEED)
+    payloads = {}
+    for count in MOCK_COUNTS:
+        board = mock_train_server.Board(count)
+        payloads[f"mock_{count}"] = {"seq": board.seq, "trains": board.trains}
+
+    board = mock_train_server.Board(20)
+    trains = []
+    for train in board.trains:
+        detailed = dict(train)
+        detailed["stops"] = [{
+            "stop_id": str(100 + i),
+            "stop_sequence": i + 1,
+            "arrival_time": train["arrival_time"],
+            "arrival_delay": train["delay_seconds"],
+            "departure_time": train["arrival_time"],
+            "track": train["track"],
+            "status": train["status"],
+            "schedule_relationship": "SCHEDULED",
+        } for i in range(STOPS_PER_TRAIN)]
+        trains.append(detailed)
+    payloads["mock_20_stops"] = {"seq": board.seq, "trains": trains}
+    return payloads
+
+
+def save(name, body):
+    path = os.path.join(PAYLOAD_DIR, name + ".json")
+    with open(path, "wb") as file:
+        file.write(body)
+    print(f"{path}: {len(body)} bytes")
+
+
+def main():
+    os.makedirs(PAYLOAD_DIR, exist_ok=True)
+
+    if len(sys.argv) == 3:
+        url, name = sys.argv[1], sys.argv[2]
+        request = urllib.request.Request(url, headers={"Accept": "application/json"})
+        with urllib.request.urlopen(request, timeout=30) as response:
+            save(name, response.read())
+    elif len(sys.argv) == 1:
+        for name, payload in mock_payloads().items():
+            # Compact, as Flask's jsonify sends it
+            save(name, json.dumps(payload, separators=(",", ":")).encode())
+    else:
+        print(__doc__)
+        sys.exit(2)
+
+
+if __name__ == "__main__":
+    main()
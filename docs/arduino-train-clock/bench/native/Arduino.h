@@ -0,0 +1,128 @@
+/**
+ * Arduino Core Shim for the native benchmark build
+ *
+ * Just enough of the Arduino API for the parts of the firmware that have
+ * no hardware behind them (decoder, train table, string pool, renderers,
+ * wall clock, poll scheduler) to build on a desktop with `pio run -e
+ * native`: Print, Stream, the timing functions and random(). Anything else
+ * the firmware uses is deliberately missing, so code that grows a hardware
+ * dependency fails to build here instead of being measured against a fake.
+ *
+ * Only found by the native envs (`-I bench/native`; the fleet env adds
+ * its sockets in fleet/native); device builds use the real Arduino core.
+ */
+
+#ifndef BENCH_ARDUINO_H
+#define BENCH_ARDUINO_H
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <chrono>
+#include <thread>
+
+inline unsigned long micros() {
+  using namespace std::chrono;
+  static const steady_clock::time_point start = steady_clock::now();
+  return (unsigned long)duration_cast<microseconds>(steady_clock::now() - start).count();
+}
+
+inline unsigned long millis() { return micros() / 1000; }
+
+inline void delay(unsigned long ms) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+inline void yield() {}
+
+// [0, howBig) and [howSmall, howBig), as the Arduino core's; seeded per
+// process by randomSeed()
+inline long random(long howBig) {
+  return howBig <= 0 ? 0 : (long)(((unsigned long)rand() << 16 ^ rand()) % howBig);
+}
+
+inline long random(long howSmall, long howBig) {
+  return howSmall >= howBig ? howSmall : howSmall + random(howBig - howSmall);
+}
+
+inline void randomSeed(unsigned long seed) { srand((unsigned)seed); }
+
+// The host clock is already set; only the time zone is applied
+inline void configTzTime(const char* timeZone, const char*) {
+  setenv("TZ", timeZone, 1);
+  tzset();
+}
+
+class Print {
+ public:
+  virtual ~Print() {}
+
+  virtual size_t write(uint8_t c) = 0;
+
+  virtual size_t write(const uint8_t* data, size_t size) {
+    size_t written = 0;
+    while (written < size && write(data[written])) written++;
+    return written;
+  }
+
+  size_t write(const char* text) { return write((const uint8_t*)text, strlen(text)); }
+  size_t write(const char* data, size_t size) { return write((const uint8_t*)data, size); }
+
+  size_t print(const char* text) { return write(text); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(long value) { return printf("%ld", value); }
+  size_t print(unsigned long value) { return printf("%lu", value); }
+  size_t print(int value) { return print((long)value); }
+  size_t print(unsigned value) { return print((unsigned long)value); }
+
+  size_t println() { return write("\r\n"); }
+
+  template <typename T>
+  size_t println(T value) { return print(value) + println(); }
+
+  size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+    char text[256];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    if (length < 0) return 0;
+    return write(text, (size_t)length < sizeof(text) ? length : sizeof(text) - 1);
+  }
+
+  virtual void flush() {}
+};
+
+class Stream : public Print {
+ public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+
+  void setTimeout(unsigned long ms) { timeout = ms; }
+
+  // Stops early at the end of the data; a memory stream never waits
+  virtual size_t readBytes(char* buffer, size_t length) {
+    size_t count = 0;
+    while (count < length) {
+      int c = read();
+      if (c < 0) break;
+      buffer[count++] = (char)c;
+    }
+    return count;
+  }
+
+  size_t readBytes(uint8_t* buffer, size_t length) {
+    return readBytes((char*)buffer, length);
+  }
+
+ protected:
+  unsigned long timeout = 1000;
+};
+
+#endif // BENCH_ARDUINO_H
@@ -0,0 +1,13 @@
+/**
+ * Configuration for the native benchmark build
+ *
+ * Stands in for include/config.h, which holds credentials and is not
+ * checked in. Nothing is set: every value comes from config_defaults.h,
+ * as on a device with an empty configuration. (A local include/config.h,
+ * where present, is picked up by the headers next to it instead.)
+ */
+
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#endif // CONFIG_H
@@ -0,0 +1,17 @@
+"""
+PlatformIO extra script for the native benchmark env
+
+Routes malloc, calloc, realloc and free through the counting wrappers in
+bench/alloc_stats.cpp. Needs GNU ld's --wrap, so only on Linux; elsewhere
+the benchmark counts operator new alone and says so.
+"""
+
+import sys
+
+Import("env")  # noqa: F821 (provided by PlatformIO)
+
+if sys.platform.startswith("linux"):
+    env.Append(  # noqa: F821
+        CPPDEFINES=["BENCH_WRAP_MALLOC"],
+        LINKFLAGS=["-Wl,--wrap=" + name for name in ("malloc", "calloc", "realloc", "free")],
+    )
@@ -10,6 +10,8 @@ existing MTA GTFS client to serve data to Arduino devices.
 Requirements:
     - Flask web framework
     - Existing mta_gtfs_client module
+    - msgpack (optional, enables application/msgpack replies)
+    - zeroconf (optional, advertises the server to SERVICE_DISCOVERY clocks)
 
 Usage:
     python example_web_server.py
@@ -19,9 +21,27 @@ Then configure Arduino to use:
 """
 
 from flask import Flask, jsonify, request
+from werkzeug.serving import WSGIRequestHandler
 from datetime import datetime
+import socket
 import sys
 import os
+import zlib
+
+# MessagePack is optional: without the package every client gets JSON
+try:
+    import msgpack
+except ImportError:
+    msgpack = None
+
+# zeroconf is optional: without it clocks need API_ENDPOINT to find us
+try:
+    from zeroconf import ServiceInfo, Zeroconf
+except ImportError:
+    Zeroconf = None
+
+# DNS-SD type the clock browses for (DISCOVERY_SERVICE in service_discovery.h)
+SERVICE_TYPE = "_mnr-trains._tcp.local."
 
 # Add parent directory to path to import from src
 sys.path.insert(0, os.path.abspath(os.path.join(os.path.dirname(__file__), '../..')))
@@ -41,27 +61,148 @@ if GTFS_AVAILABLE:
     mta_client = MTAGTFSRealtimeClient()
 
 
-def parse_gtfs_to_json(trip_updates, max_trains=10):
+# Compress with a 4 KB window so the clock's small-window inflater can
+# decode it (INFLATE_WINDOW_BITS in the firmware's config_defaults.h)
+COMPRESSION_WINDOW_BITS = 12
+COMPRESSION_MIN_SIZE = 256
+
+
+def compress_response(response):
+    """gzip- or deflate-encode response if the client accepts it"""
+    response.vary.add('Accept-Encoding')
+    body = response.get_data()
+    coding = request.accept_encodings.best_match(['gzip', 'deflate'])
+    if coding is None or len(body) < COMPRESSION_MIN_SIZE:
+        return response
+
+    wbits = COMPRESSION_WINDOW_BITS + (16 if coding == 'gzip' else 0)
+    compressor = zlib.compressobj(6, zlib.DEFLATED, wbits)
+    response.set_data(compressor.compress(body) + compressor.flush())
+    response.headers['Content-Encoding'] = coding
+    return response
+
+
+def advertise_service(port, path):
+    """
+    Announce the API over DNS-SD as _mnr-trains._tcp, so clocks built
+    with SERVICE_DISCOVERY 1 find this server without an API_ENDPOINT.
+
+    Returns the Zeroconf instance, which has to be kept for as long as the
+    announcement should last, or None without the zeroconf package.
+    """
+    if Zeroconf is None:
+        print("  (pip install zeroconf to let clocks find this server)")
+        return None
+
+    # The address other hosts reach us on: the one the default route uses
+    # (connecting a UDP socket sends nothing)
+    with socket.socket(socket.AF_INET, socket.SOCK_DGRAM) as probe:
+        probe.connect(("10.255.255.255", 1))
+        address = probe.getsockname()[0]
+
+    info = ServiceInfo(
+        SERVICE_TYPE,
+        f"{socket.gethostname()}.{SERVICE_TYPE}",
+        addresses=[socket.inet_aton(address)],
+        port=port,
+        properties={"path": path},
+    )
+    zeroconf = Zeroconf()
+    zeroconf.register_service(info)
+    print(f"  Advertised as {SERVICE_TYPE} on {address}:{port}{path}")
+    return zeroconf
+
+
+def conditional_response(payload, last_modified=None):
+    """
+    Encode payload as JSON or MessagePack, with ETag (and optionally
+    Last-Modified) validators
+
+    MessagePack is used when the request's Accept header prefers it, and
+    the body is compressed when Accept-Encoding allows.
+    Answers 304 Not Modified when the request's If-None-Match or
+    If-Modified-Since shows the client already has this payload, so an
+    unchanged feed costs the clock no parsing or redraw.
+    """
+    mimetype = 'application/json'
+    if msgpack is not None:
+        # JSON first, so clients sending */* (browsers, curl) still get JSON
+        mimetype = request.accept_mimetypes.best_match(
+            ['application/json', 'application/msgpack']) or mimetype
+
+    if mimetype == 'application/msgpack':
+        response = app.response_class(msgpack.packb(payload), mimetype=mimetype)
+    else:
+        response = jsonify(payload)
+    response.vary.add('Accept')
+    compress_response(response)
+    response.add_etag()
+    if last_modified is not None:
+        response.last_modified = last_modified
+    return response.make_conditional(request)
+
+
+# What a clock with its station's timetable in flash still needs from the
+# server; it has the rest (SCHEDULE_REALTIME_FIELDS in schedule_index.h)
+COMPACT_FIELDS = ("trip_id", "track", "status", "delay_seconds")
+
+
+def project_trains(trains, fields):
+    """Trains reduced to the keys in fields"""
+    return [{key: train[key] for key in fields if key in train}
+            for train in trains]
+
+
+def request_fields():
+    """
+    Keys of each train the request asks for: ?fields=<key>,<key>... (the
+    firmware sends the ones it stores), COMPACT_FIELDS for ?compact=1 from
+    older firmware, or None for all of them
+    """
+    fields = request.args.get('fields')
+    if fields:
+        return tuple(field for field in fields.split(',') if field)
+    if request.args.get('compact') == '1':
+        return COMPACT_FIELDS
+    return None
+
+
+def parse_gtfs_to_json(trip_updates, max_trains=10, station=None, route=None,
+                       destination=None):
     """
     Transform GTFS-RT trip updates to Arduino-friendly JSON format
     
     Args:
         trip_updates: List of TripUpdate protobuf messages
         max_trains: Maximum number of trains to return
+        station: Stop ID the board is for: only trains calling there, with
+            their arrival there (default: each train's next stop)
+        route: Only trains of this route (readable name, e.g. "Hudson Line")
+        destination: Stop ID where the trip ends: only trains terminating there
     
     Returns:
         dict: JSON-serializable dictionary with train data
     """
     trains = []
     
-    for trip_update in trip_updates[:max_trains]:
+    for trip_update in trip_updates:
+        if len(trains) >= max_trains:
+            break
+
         # Extract trip information
         trip_id = trip_update.trip.trip_id if trip_update.HasField('trip') else "Unknown"
         route_id = trip_update.trip.route_id if trip_update.HasField('trip') else "Unknown"
         
-        # Get the next stop information
-        if len(trip_update.stop_time_update) > 0:
-            next_stop = trip_update.stop_time_update[0]
+        if destination is not None and (
+                not trip_update.stop_time_update or
+                trip_update.stop_time_update[-1].stop_id != destination):
+            continue
+
+        # Get the next stop information (or the board's station)
+        stops = [stop for stop in trip_update.stop_time_update
+                 if station is None or stop.stop_id == station]
+        if len(stops) > 0:
+            next_stop = stops[0]
             
             # Extract arrival time
             arrival_time = "N/A"
@@ -111,6 +252,9 @@ def parse_gtfs_to_json(trip_updates, max_trains=10):
                 if key in route_id:
                     route_name = value
                     break
+
+            if route is not None and route_name != route:
+                continue
             
             # Create train entry
             train = {
@@ -135,11 +279,21 @@ def get_trains():
     
     Query parameters:
         - limit: Maximum number of trains (default: 10)
+        - origin_station (or station): Stop ID the board is for (default:
+          each train's next stop)
+        - destination_station: Stop ID where the trips end
+        - route: Only trains of this line, e.g. "Hudson Line"
+        - fields: Comma-separated keys of each train to send (default: all)
+        - compact: 1 for trip_id, track, status and delay_seconds only
     
     Returns:
         JSON response with train data
     """
     limit = request.args.get('limit', default=10, type=int)
+    station = request.args.get('origin_station') or request.args.get('station')
+    destination = request.args.get('destination_station')
+    route = request.args.get('route')
+    fields = request_fields()
     
     if not GTFS_AVAILABLE:
         # Return mock data if GTFS client not available
@@ -164,13 +318,20 @@ def get_trains():
         trip_updates = mta_client.get_trip_updates(feed)
         
         # Transform to JSON format
-        result = parse_gtfs_to_json(trip_updates, max_trains=limit)
+        result = parse_gtfs_to_json(trip_updates, max_trains=limit,
+                                    station=station, route=route,
+                                    destination=destination)
+        if fields is not None:
+            result['trains'] = project_trains(result['trains'], fields)
         
-        # Add metadata
-        result['updated_at'] = datetime.now().isoformat()
+        # Add metadata. updated_at is the feed's own timestamp rather than
+        # the request time, so identical feeds produce identical bodies
+        # (and ETags).
+        feed_time = datetime.fromtimestamp(feed.header.timestamp)
+        result['updated_at'] = feed_time.isoformat()
         result['source'] = 'MTA GTFS-RT'
         
-        return jsonify(result)
+        return conditional_response(result, feed_time)
     
     except Exception as e:
         return jsonify({
@@ -188,6 +349,10 @@ def status():
         "endpoints": {
             "/api/trains": "Get upcoming trains (JSON)",
             "/api/trains?limit=5": "Get specific number of trains",
+            "/api/trains?origin_station=<stop_id>&destination_station=<stop_id>&route=<line>":
+                "Only matching trains",
+            "/api/trains?fields=<key>,<key>": "Only these keys of each train",
+            "/api/trains?compact=1": "Only delays, tracks and status",
             "/api/status": "Server status"
         }
     })
@@ -246,4 +411,12 @@ if __name__ == '__main__':
     print("\nPress Ctrl+C to stop")
     print("=" * 60 + "\n")
     
+    # Werkzeug answers HTTP/1.0 and closes every connection by default;
+    # HTTP/1.1 lets the clock keep one socket open between polls
+    WSGIRequestHandler.protocol_version = "HTTP/1.1"
+
+    # With debug on, the reloader's child process is the one serving
+    if os.environ.get("WERKZEUG_RUN_MAIN") == "true":
+        advertiser = advertise_service(5000, "/api/trains")
+
     app.run(host='0.0.0.0', port=5000, debug=True)
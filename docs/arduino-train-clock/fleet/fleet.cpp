@@ -0,0 +1,574 @@
+/**
+ * Fleet Load Generator for Metro-North Railroad Train Clock
+ *
+ * Runs a fleet of simulated clocks against a train server from a desktop,
+ * so a server change (or a firmware change to what clocks ask for) can be
+ * measured under the load of many clocks before any of them is flashed.
+ * Each simulated clock is a process running the firmware's own fetch
+ * path: HttpSession (keep-alive connection, pipelined views, conditional
+ * GET with ETag / Last-Modified, the fetch budgets of main.cpp), the view
+ * query of main.cpp's viewQuery() through QueryBuilder, delta sync with
+ * its resync on a base mismatch, and TrainDecoder into TrainTable. Between
+ * fetches it waits as PollScheduler decides (Cache-Control max-age,
+ * Retry-After and backoff included), or at a fixed interval with jitter.
+ * Built by the `fleet` env:
+ *
+ *   pio run -e fleet
+ *   .pio/build/fleet/program [options] [endpoint URL]
+ *
+ * The endpoint defaults to mock_train_server.py on this machine
+ * (http://127.0.0.1:5000/api/trains); web_server.py serves /trains.
+ * Only http:// is supported (the session is built with HTTP_SESSION_TLS 0),
+ * and no Accept-Encoding is offered, so byte counts are uncompressed.
+ *
+ * Report, over every response of every clock:
+ *   latency          pipeline sent until the response's body was decoded,
+ *                    p50 / p90 / p99 / max, for all, 200 and 304 replies;
+ *                    first byte the same for the status line alone
+ *   per clock-hour   polls, bytes received and sent (headers included) and
+ *                    TCP connections opened
+ *   outcomes         new boards, 304s, deltas, resyncs, cut-off boards,
+ *                    and each kind of error, with the error rate
+ *
+ * Options:
+ *   --devices N      Simulated clocks (default 10)
+ *   --duration S     Length of the run in seconds (default 300)
+ *   --interval S     Poll every S seconds instead of PollScheduler's
+ *                    adaptive schedule
+ *   --jitter PCT     +/- spread of each --interval (default 10)
+ *   --ramp S         Spread of the clocks' first polls, as when a building
+ *                    full of them powers up (default 3)
+ *   --view QUERY     A view, as an API_VIEWS entry ("route=Harlem%20Line");
+ *                    repeat for several (default one view, "")
+ *   --rows N         limit= of each view, the display's train rows
+ *                    (default MAX_TRAINS)
+ *   --station ID, --destination ID
+ *                    As API_STATION / API_DESTINATION (GTFS stop IDs)
+ *   --compact        Ask for SCHEDULE_REALTIME_FIELDS only, as a clock
+ *                    with a timetable does
+ *   --msgpack        Offer MessagePack first, as ACCEPT_MSGPACK does
+ *   --no-delta       Full boards only (DELTA_SYNC 0)
+ *   --header "NAME: VALUE"
+ *                    Extra request header, e.g. X-API-Key; repeatable
+ *   --max-errors PCT Exit 1 if more than PCT% of responses failed
+ */
+
+#include <Arduino.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "config_defaults.h"
+#include "http_session.h"
+#include "metrics.h"
+#include "poll_scheduler.h"
+#include "query_builder.h"
+#include "schedule_index.h"
+#include "train_decoder.h"
+#include "train_schema.h"
+#include "train_table.h"
+#include "wall_clock.h"
+
+static const char* const DEFAULT_ENDPOINT = "http://127.0.0.1:5000/api/trains";
+
+// As in main.cpp
+static const uint8_t MAX_VIEWS = 4;
+static const size_t QUERY_CAPACITY = HTTP_SESSION_QUERY_CAPACITY;
+static const time_t DEPARTED_GRACE = 60;
+static const unsigned long FETCH_CONNECT_MS = 5000;
+static const unsigned long FETCH_FIRST_BYTE_MS = 4000;
+static const unsigned long FETCH_READ_MS = 2000;
+static const unsigned long FETCH_DEADLINE_MS = 8000;
+
+static const unsigned long SECONDS_PER_HOUR = 3600;
+
+struct Options {
+  std::string endpoint = DEFAULT_ENDPOINT;
+  unsigned devices = 10;
+  unsigned long durationMs = 300000;
+  unsigned long intervalMs = 0; // 0: PollScheduler
+  unsigned jitterPercent = 10;
+  unsigned long rampMs = 3000;
+  std::vector<std::string> views;
+  unsigned long rows = MAX_TRAINS;
+  std::string station;
+  std::string destination;
+  bool compact = false;
+  bool msgpack = false;
+  bool delta = true;
+  std::vector<std::string> headers;
+  double maxErrorPercent = -1; // Off
+};
+
+// Outcome of one view's response, as main.cpp's ViewFetch, with the
+// failures told apart for the report
+enum Outcome : uint8_t {
+  OUTCOME_UPDATED,
+  OUTCOME_UNCHANGED,
+  OUTCOME_RESYNC,
+  OUTCOME_PARTIAL,
+  OUTCOME_TRANSPORT,   // Negative HttpSessionError in status
+  OUTCOME_HTTP_STATUS, // Neither 200 nor 304
+  OUTCOME_DECODE,      // Body failed to decode
+  OUTCOME_DELTA,       // Delta against a board never held
+  OUTCOME_COUNT
+};
+
+static const char* const OUTCOME_NAMES[OUTCOME_COUNT] = {
+  "new board", "not modified", "delta resync", "cut off (partial)",
+  "transport", "HTTP status", "decode failed", "delta without base",
+};
+
+static bool isFailure(uint8_t outcome) {
+  return outcome >= OUTCOME_PARTIAL;
+}
+
+// What a clock tells the parent, one record per write(): small enough to
+// be written atomically to the shared pipe
+enum RecordKind : uint8_t {
+  RECORD_RESPONSE,
+  RECORD_CLOCK, // Totals, once the run is over
+};
+
+struct Record {
+  uint8_t kind;
+  uint8_t outcome;
+  bool delta;
+  int16_t status;
+  uint32_t latencyUs;
+  uint32_t firstByteUs;
+  // RECORD_CLOCK
+  uint32_t polls;
+  uint32_t connects;
+  uint32_t elapsedMs;
+  unsigned long long bytesReceived;
+  unsigned long long bytesSent;
+};
+
+static Options options;
+
+// ---------------------------------------------------------------------------
+// One simulated clock (a child process): the network task's state
+// ---------------------------------------------------------------------------
+
+static int reportFd = -1;
+static HttpSession api;
+static TrainDecoder decoder;
+static PollScheduler poller;
+static TrainTable views[MAX_VIEWS];
+static HttpValidators viewValidators[MAX_VIEWS];
+static TrainTable board;
+static TrainTable scratch;
+static uint8_t viewCount = 1;
+
+// Filled by HttpSession through metrics.h
+static uint32_t connects = 0;
+static uint32_t lastFirstByteUs = 0;
+
+void recordPhase(MetricPhase phase, uint32_t micros) {
+  if (phase == PHASE_FIRST_BYTE) lastFirstByteUs = micros;
+}
+
+void countEvent(MetricCounter counter) {
+  if (counter == COUNTER_HTTP_CONNECTS) connects++;
+}
+
+static void report(const Record& record) {
+  while (write(reportFd, &record, sizeof(record)) < 0 && errno == EINTR) {
+  }
+}
+
+static const char* viewEntry(uint8_t view) {
+  return options.views.empty() ? "" : options.views[view].c_str();
+}
+
+/**
+ * The query of main.cpp's viewQuery(), from the options
+ */
+static void viewQuery(uint8_t view, char* buffer, size_t size) {
+  QueryBuilder query(buffer, size);
+  query.append(viewEntry(view));
+  if (options.delta && views[view].seq != 0) {
+    query.add("since", (unsigned long)views[view].seq);
+  }
+  query.add("fields", options.compact ? SCHEDULE_REALTIME_FIELDS : TRAIN_FIELD_KEYS);
+  query.add("limit", options.rows);
+  query.add("origin_station", options.station.c_str());
+  query.add("destination_station", options.destination.c_str());
+}
+
+/**
+ * Read the next pipelined response, for `view`, as main.cpp's fetchView()
+ */
+static Outcome fetchView(uint8_t view, Record& record) {
+  lastFirstByteUs = 0;
+  int httpCode = api.nextResponse();
+  record.status = (int16_t)httpCode;
+  record.firstByteUs = lastFirstByteUs;
+
+  if (httpCode <= 0) return OUTCOME_TRANSPORT;
+  if (httpCode == HTTP_CODE_NOT_MODIFIED) return OUTCOME_UNCHANGED;
+  if (httpCode != HTTP_CODE_OK || api.contentEncoding()[0] != '\0') {
+    return OUTCOME_HTTP_STATUS;
+  }
+
+  TrainTable& held = views[view];
+  bool msgpack = strstr(api.contentType(), "msgpack") != nullptr;
+  scratch = held;
+  scratch.incomplete = false;
+  DeserializationError error = decoder.decode(
+      api.body(), msgpack ? PAYLOAD_MSGPACK : PAYLOAD_JSON, scratch);
+  record.delta = decoder.isDelta();
+
+  bool mismatched = decoder.isDelta() && decoder.deltaBase() != held.seq;
+  if (error == DeserializationError::IncompleteInput && decoder.recordCount() > 0 &&
+      !mismatched) {
+    scratch.incomplete = true;
+    scratch.seq = 0;
+    viewValidators[view].clear();
+    held = scratch;
+    return OUTCOME_PARTIAL;
+  }
+  if (error) return OUTCOME_DECODE;
+  if (mismatched) return held.seq != 0 ? OUTCOME_RESYNC : OUTCOME_DELTA;
+
+  api.acceptValidators();
+  held = scratch;
+  return OUTCOME_UPDATED;
+}
+
+/**
+ * One fetch cycle, as main.cpp's fetchTrainData(): every view pipelined,
+ * then a second pipeline for the views whose delta did not fit
+ */
+static void fetchCycle() {
+  bool failed = false;
+  long maxAge = -1;
+  long retryAfter = -1;
+  api.setDeadline(millis() + FETCH_DEADLINE_MS);
+
+  bool pending[MAX_VIEWS];
+  for (uint8_t v = 0; v < viewCount; v++) pending[v] = true;
+
+  for (int pass = 0; pass < 2; pass++) {
+    static char queries[MAX_VIEWS][QUERY_CAPACITY];
+    const char* list[MAX_VIEWS];
+    HttpValidators* validators[MAX_VIEWS];
+    uint8_t listed[MAX_VIEWS];
+    uint8_t count = 0;
+
+    for (uint8_t v = 0; v < viewCount; v++) {
+      if (!pending[v]) continue;
+      pending[v] = false;
+      viewQuery(v, queries[v], sizeof(queries[v]));
+      list[count] = queries[v];
+      validators[count] = &viewValidators[v];
+      listed[count++] = v;
+    }
+    if (count == 0) break;
+
+    unsigned long sentUs = micros();
+    api.pipeline(list, validators, count);
+    for (uint8_t k = 0; k < count; k++) {
+      uint8_t v = listed[k];
+      Record record = {};
+      record.kind = RECORD_RESPONSE;
+      Outcome outcome = fetchView(v, record);
+
+      long age = api.maxAge();
+      if (age >= 0 && (maxAge < 0 || age < maxAge)) maxAge = age;
+      if (api.retryAfter() > retryAfter) retryAfter = api.retryAfter();
+      api.end();
+
+      record.outcome = outcome;
+      record.latencyUs = micros() - sentUs;
+      report(record);
+
+      if (outcome == OUTCOME_RESYNC && pass == 0) {
+        views[v].seq = 0;
+        viewValidators[v].clear();
+        pending[v] = true;
+      } else if (isFailure(outcome) || outcome == OUTCOME_RESYNC) {
+        failed = true;
+      }
+    }
+  }
+  api.clearDeadline();
+
+  board.merge(views, viewCount, time(nullptr) - DEPARTED_GRACE);
+  if (failed) {
+    poller.failed(retryAfter);
+  } else {
+    poller.succeeded(board, maxAge);
+  }
+}
+
+/**
+ * Next poll of the fixed schedule: --interval, +/- --jitter
+ */
+static unsigned long fixedInterval() {
+  unsigned long spread = options.intervalMs * options.jitterPercent / 100;
+  return options.intervalMs - spread + random(2 * spread + 1);
+}
+
+static void runClock(unsigned index) {
+  randomSeed(getpid() ^ (unsigned long)time(nullptr) ^ (index * 2654435761UL));
+  viewCount = options.views.empty() ? 1 : (uint8_t)options.views.size();
+
+  decoder.begin(JSON_ARENA_BYTES);
+  api.begin(options.endpoint.c_str());
+  api.setTimeouts(FETCH_CONNECT_MS, FETCH_FIRST_BYTE_MS, FETCH_READ_MS);
+  if (options.msgpack) api.setAccept("application/msgpack, application/json;q=0.5");
+  for (const std::string& header : options.headers) {
+    size_t colon = header.find(':');
+    size_t value = header.find_first_not_of(' ', colon + 1);
+    api.addHeader(header.substr(0, colon).c_str(),
+                  value == std::string::npos ? "" : header.c_str() + value);
+  }
+
+  unsigned long startMs = millis();
+  delay(random(options.rampMs + 1));
+
+  Record totals = {};
+  totals.kind = RECORD_CLOCK;
+  poller.begin();
+  unsigned long nextPollMs = millis();
+
+  while (millis() - startMs < options.durationMs) {
+    bool due = options.intervalMs > 0 ? (long)(millis() - nextPollMs) >= 0
+                                      : poller.due();
+    if (!due) {
+      delay(10);
+      continue;
+    }
+    fetchCycle();
+    totals.polls++;
+    nextPollMs = millis() + fixedInterval();
+  }
+  api.close();
+
+  totals.connects = connects;
+  totals.elapsedMs = millis() - startMs;
+  totals.bytesReceived = WiFiClient::bytesReceived;
+  totals.bytesSent = WiFiClient::bytesSent;
+  report(totals);
+}
+
+// ---------------------------------------------------------------------------
+// The parent: start the clocks, gather their records, report
+// ---------------------------------------------------------------------------
+
+static bool parseOptions(int argc, char** argv) {
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    bool hasValue = i + 1 < argc;
+
+    if (arg == "--devices" && hasValue) {
+      options.devices = strtoul(argv[++i], nullptr, 10);
+    } else if (arg == "--duration" && hasValue) {
+      options.durationMs = strtoul(argv[++i], nullptr, 10) * 1000;
+    } else if (arg == "--interval" && hasValue) {
+      options.intervalMs = strtoul(argv[++i], nullptr, 10) * 1000;
+    } else if (arg == "--jitter" && hasValue) {
+      options.jitterPercent = std::min(100UL, strtoul(argv[++i], nullptr, 10));
+    } else if (arg == "--ramp" && hasValue) {
+      options.rampMs = strtoul(argv[++i], nullptr, 10) * 1000;
+    } else if (arg == "--view" && hasValue) {
+      options.views.push_back(argv[++i]);
+    } else if (arg == "--rows" && hasValue) {
+      options.rows = strtoul(argv[++i], nullptr, 10);
+    } else if (arg == "--station" && hasValue) {
+      options.station = argv[++i];
+    } else if (arg == "--destination" && hasValue) {
+      options.destination = argv[++i];
+    } else if (arg == "--compact") {
+      options.compact = true;
+    } else if (arg == "--msgpack") {
+      options.msgpack = true;
+    } else if (arg == "--no-delta") {
+      options.delta = false;
+    } else if (arg == "--header" && hasValue) {
+      options.headers.push_back(argv[++i]);
+    } else if (arg == "--max-errors" && hasValue) {
+      options.maxErrorPercent = atof(argv[++i]);
+    } else if (arg.compare(0, 2, "--") == 0) {
+      fprintf(stderr, "Unknown or incomplete option %s\n", arg.c_str());
+      return false;
+    } else {
+      options.endpoint = arg;
+    }
+  }
+
+  if (options.devices == 0 || options.durationMs == 0) {
+    fprintf(stderr, "--devices and --duration must be at least 1\n");
+    return false;
+  }
+  if (options.views.size() > MAX_VIEWS) {
+    fprintf(stderr, "At most %u views\n", (unsigned)MAX_VIEWS);
+    return false;
+  }
+  for (const std::string& header : options.headers) {
+    if (header.find(':') == std::string::npos || header.find(':') == 0) {
+      fprintf(stderr, "--header needs \"NAME: VALUE\", got %s\n", header.c_str());
+      return false;
+    }
+  }
+  if (!HttpSession().begin(options.endpoint.c_str())) {
+    fprintf(stderr, "Cannot use endpoint %s (http:// only)\n", options.endpoint.c_str());
+    return false;
+  }
+  return true;
+}
+
+static double percentile(const std::vector<uint32_t>& sorted, double fraction) {
+  if (sorted.empty()) return 0;
+  size_t index = (size_t)(fraction * (sorted.size() - 1) + 0.5);
+  return sorted[index] / 1000.0;
+}
+
+static void printLatency(const char* name, std::vector<uint32_t> samples) {
+  if (samples.empty()) return;
+  std::sort(samples.begin(), samples.end());
+  printf("  %-12s %8zu %9.1f %9.1f %9.1f %9.1f\n", name, samples.size(),
+         percentile(samples, 0.50), percentile(samples, 0.90),
+         percentile(samples, 0.99), samples.back() / 1000.0);
+}
+
+int main(int argc, char** argv) {
+  if (!parseOptions(argc, argv)) return 2;
+  signal(SIGPIPE, SIG_IGN);
+  applyTimeZone();
+
+  int pipeFds[2];
+  if (pipe(pipeFds) != 0) {
+    perror("pipe");
+    return 2;
+  }
+
+  printf("%u clocks for %lu s against %s, ", options.devices,
+         options.durationMs / 1000, options.endpoint.c_str());
+  if (options.intervalMs > 0) {
+    printf("every %lu s +/- %u%%\n", options.intervalMs / 1000, options.jitterPercent);
+  } else {
+    printf("adaptive schedule (PollScheduler)\n");
+  }
+  fflush(stdout);
+
+  std::vector<pid_t> clocks;
+  for (unsigned i = 0; i < options.devices; i++) {
+    pid_t pid = fork();
+    if (pid < 0) {
+      perror("fork");
+      break;
+    }
+    if (pid == 0) {
+      close(pipeFds[0]);
+      reportFd = pipeFds[1];
+      runClock(i);
+      _exit(0);
+    }
+    clocks.push_back(pid);
+  }
+  close(pipeFds[1]);
+
+  std::vector<uint32_t> latencyAll, latencyOk, latencyNotModified, firstByte;
+  unsigned long outcomes[OUTCOME_COUNT] = {};
+  unsigned long deltas = 0;
+  std::vector<std::pair<int, unsigned long>> errorStatuses;
+  unsigned long responses = 0;
+  unsigned long failures = 0;
+  unsigned reported = 0;
+  double clockHours = 0;
+  double polls = 0, received = 0, sent = 0, connections = 0;
+
+  Record record;
+  ssize_t n;
+  while ((n = read(pipeFds[0], &record, sizeof(record))) != 0) {
+    if (n < 0 && errno == EINTR) continue;
+    if (n != (ssize_t)sizeof(record)) break;
+
+    if (record.kind == RECORD_CLOCK) {
+      reported++;
+      clockHours += record.elapsedMs / 1000.0 / SECONDS_PER_HOUR;
+      polls += record.polls;
+      received += record.bytesReceived;
+      sent += record.bytesSent;
+      connections += record.connects;
+      continue;
+    }
+
+    responses++;
+    outcomes[record.outcome]++;
+    if (record.delta) deltas++;
+    if (isFailure(record.outcome)) failures++;
+
+    if (record.outcome == OUTCOME_TRANSPORT || record.outcome == OUTCOME_HTTP_STATUS) {
+      auto found = std::find_if(errorStatuses.begin(), errorStatuses.end(),
+                                [&](const std::pair<int, unsigned long>& entry) {
+                                  return entry.first == record.status;
+                                });
+      if (found == errorStatuses.end()) {
+        errorStatuses.emplace_back(record.status, 1);
+      } else {
+        found->second++;
+      }
+    }
+    if (record.status <= 0) continue;
+
+    latencyAll.push_back(record.latencyUs);
+    if (record.firstByteUs > 0) firstByte.push_back(record.firstByteUs);
+    if (record.status == HTTP_CODE_OK) latencyOk.push_back(record.latencyUs);
+    if (record.status == HTTP_CODE_NOT_MODIFIED) {
+      latencyNotModified.push_back(record.latencyUs);
+    }
+  }
+  close(pipeFds[0]);
+  for (pid_t pid : clocks) waitpid(pid, nullptr, 0);
+
+  if (reported < clocks.size()) {
+    printf("Note: %u of %zu clocks exited without reporting totals\n",
+           (unsigned)(clocks.size() - reported), clocks.size());
+  }
+
+  printf("\n%lu responses (%lu deltas) from %u clocks\n", responses, deltas, reported);
+  printf("  %-12s %8s %9s %9s %9s %9s\n", "latency ms", "count", "p50", "p90",
+         "p99", "max");
+  printLatency("all", latencyAll);
+  printLatency("200", latencyOk);
+  printLatency("304", latencyNotModified);
+  printLatency("first byte", firstByte);
+
+  if (clockHours > 0) {
+    printf("\nPer clock-hour: %.1f polls, %.1f KB received, %.1f KB sent, "
+           "%.1f connections\n", polls / clockHours, received / clockHours / 1024,
+           sent / clockHours / 1024, connections / clockHours);
+  }
+
+  printf("\nOutcomes\n");
+  for (int i = 0; i < OUTCOME_COUNT; i++) {
+    if (outcomes[i] > 0) printf("  %-20s %8lu\n", OUTCOME_NAMES[i], outcomes[i]);
+  }
+  std::sort(errorStatuses.begin(), errorStatuses.end());
+  for (const auto& entry : errorStatuses) {
+    if (entry.first < 0) {
+      printf("    %-18s %8lu\n", HttpSession::errorToString(entry.first), entry.second);
+    } else {
+      printf("    HTTP %-13d %8lu\n", entry.first, entry.second);
+    }
+  }
+
+  double errorPercent = responses > 0 ? 100.0 * failures / responses : 0;
+  printf("\nError rate: %.2f%% (%lu of %lu responses)\n", errorPercent, failures,
+         responses);
+
+  if (options.maxErrorPercent >= 0 && errorPercent > options.maxErrorPercent) {
+    printf("Above --max-errors %.2f%%\n", options.maxErrorPercent);
+    return 1;
+  }
+  return responses > 0 ? 0 : 1;
+}
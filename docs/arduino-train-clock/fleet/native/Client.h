@@ -0,0 +1,26 @@
+/**
+ * Client Shim for the native fleet build
+ *
+ * The part of the Arduino core's Client interface HttpSession reads and
+ * writes through; WiFi.h has the one implementation, over a POSIX socket.
+ */
+
+#ifndef FLEET_CLIENT_H
+#define FLEET_CLIENT_H
+
+#include <Arduino.h>
+
+class Client : public Stream {
+ public:
+  using Print::write;
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t* data, size_t size) override = 0;
+
+  using Stream::read;
+  virtual int read(uint8_t* buffer, size_t size) = 0;
+
+  virtual uint8_t connected() = 0;
+  virtual void stop() = 0;
+};
+
+#endif // FLEET_CLIENT_H
@@ -0,0 +1,19 @@
+/**
+ * HTTPClient Shim for the native fleet build
+ *
+ * Only the t_http_codes status constants, which is all HttpSession takes
+ * from the Arduino core's HTTPClient.
+ */
+
+#ifndef FLEET_HTTPCLIENT_H
+#define FLEET_HTTPCLIENT_H
+
+enum t_http_codes {
+  HTTP_CODE_OK = 200,
+  HTTP_CODE_NO_CONTENT = 204,
+  HTTP_CODE_NOT_MODIFIED = 304,
+  HTTP_CODE_TOO_MANY_REQUESTS = 429,
+  HTTP_CODE_SERVICE_UNAVAILABLE = 503,
+};
+
+#endif // FLEET_HTTPCLIENT_H
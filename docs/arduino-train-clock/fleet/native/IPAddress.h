@@ -0,0 +1,33 @@
+/**
+ * IPAddress Shim for the native fleet build
+ *
+ * An IPv4 address as four bytes, as the Arduino core's IPAddress holds it,
+ * for HttpSession and host_resolver.h on a desktop (see fleet/fleet.cpp).
+ */
+
+#ifndef FLEET_IPADDRESS_H
+#define FLEET_IPADDRESS_H
+
+#include <stdint.h>
+#include <string.h>
+
+class IPAddress {
+ public:
+  IPAddress() {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : bytes{a, b, c, d} {}
+
+  uint8_t operator[](int index) const { return bytes[index]; }
+  uint8_t& operator[](int index) { return bytes[index]; }
+
+  // Network byte order, as in a sockaddr_in
+  operator uint32_t() const {
+    uint32_t value;
+    memcpy(&value, bytes, sizeof(value));
+    return value;
+  }
+
+ private:
+  uint8_t bytes[4] = {0, 0, 0, 0};
+};
+
+#endif // FLEET_IPADDRESS_H
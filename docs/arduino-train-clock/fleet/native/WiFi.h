@@ -0,0 +1,55 @@
+/**
+ * WiFi Shim for the native fleet build
+ *
+ * WiFiClient over a non-blocking POSIX TCP socket, so HttpSession runs on
+ * a desktop unchanged: connect with a timeout, TCP_NODELAY, buffered reads
+ * that never block, and the connection state as the ESP32 core reports it
+ * (still connected while unread bytes remain).
+ *
+ * Every byte sent and received is counted in WiFiClient::bytesSent /
+ * bytesReceived, which is how fleet.cpp knows what a simulated clock
+ * costs on the wire; the counts include headers. Each simulated clock is
+ * its own process, so the counts are per clock.
+ */
+
+#ifndef FLEET_WIFI_H
+#define FLEET_WIFI_H
+
+#include <Arduino.h>
+#include <Client.h>
+#include <IPAddress.h>
+
+class WiFiClient : public Client {
+ public:
+  ~WiFiClient() override { stop(); }
+
+  // True once connected within timeoutMs
+  bool connect(IPAddress address, uint16_t port, int32_t timeoutMs);
+  void setNoDelay(bool noDelay);
+
+  using Client::write;
+  size_t write(const uint8_t* data, size_t size) override;
+
+  int available() override;
+  int read() override;
+  int read(uint8_t* buffer, size_t size) override;
+  int peek() override;
+
+  uint8_t connected() override;
+  void stop() override;
+
+  static unsigned long long bytesSent;
+  static unsigned long long bytesReceived;
+
+ private:
+  // Move whatever the socket has into the buffer, without waiting
+  void fill();
+
+  int fd = -1;
+  bool peerClosed = false;
+  uint8_t buffer[1460];
+  size_t head = 0;
+  size_t tail = 0;
+};
+
+#endif // FLEET_WIFI_H
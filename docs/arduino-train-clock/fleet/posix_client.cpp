@@ -0,0 +1,149 @@
+/**
+ * POSIX Sockets for the native fleet build
+ *
+ * WiFiClient (fleet/native/WiFi.h) and host_resolver.h on top of the
+ * host's sockets and resolver, so fleet.cpp drives the firmware's own
+ * HttpSession. resolveHost() asks getaddrinfo() every time: caching is
+ * left to the host, whose resolver is not the one being measured.
+ */
+
+#include <WiFi.h>
+
+#include "host_resolver.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0 // macOS: fleet.cpp ignores SIGPIPE instead
+#endif
+
+unsigned long long WiFiClient::bytesSent = 0;
+unsigned long long WiFiClient::bytesReceived = 0;
+
+bool WiFiClient::connect(IPAddress address, uint16_t port, int32_t timeoutMs) {
+  stop();
+
+  fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) return false;
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+  struct sockaddr_in peer = {};
+  peer.sin_family = AF_INET;
+  peer.sin_port = htons(port);
+  peer.sin_addr.s_addr = (uint32_t)address;
+
+  int result = ::connect(fd, (struct sockaddr*)&peer, sizeof(peer));
+  if (result < 0 && errno == EINPROGRESS) {
+    struct pollfd waiting = {fd, POLLOUT, 0};
+    int error = 0;
+    socklen_t length = sizeof(error);
+    if (poll(&waiting, 1, timeoutMs > 0 ? timeoutMs : 0) == 1 &&
+        getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length) == 0 && error == 0) {
+      result = 0;
+    }
+  }
+  if (result < 0) {
+    stop();
+    return false;
+  }
+  return true;
+}
+
+void WiFiClient::setNoDelay(bool noDelay) {
+  int value = noDelay ? 1 : 0;
+  if (fd >= 0) setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &value, sizeof(value));
+}
+
+size_t WiFiClient::write(const uint8_t* data, size_t size) {
+  size_t written = 0;
+  while (fd >= 0 && written < size) {
+    ssize_t n = send(fd, data + written, size - written, MSG_NOSIGNAL);
+    if (n > 0) {
+      written += n;
+      continue;
+    }
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      // Send buffer full: wait for room, as lwIP's write does
+      struct pollfd waiting = {fd, POLLOUT, 0};
+      if (poll(&waiting, 1, 1000) == 1) continue;
+    }
+    break;
+  }
+  bytesSent += written;
+  return written;
+}
+
+void WiFiClient::fill() {
+  if (fd < 0 || peerClosed) return;
+  if (head == tail) head = tail = 0;
+  if (tail == sizeof(buffer)) return;
+
+  ssize_t n = recv(fd, buffer + tail, sizeof(buffer) - tail, MSG_DONTWAIT);
+  if (n > 0) {
+    tail += n;
+    bytesReceived += n;
+  } else if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+    peerClosed = true;
+  }
+}
+
+int WiFiClient::available() {
+  fill();
+  return (int)(tail - head);
+}
+
+int WiFiClient::read() {
+  uint8_t c;
+  return read(&c, 1) == 1 ? c : -1;
+}
+
+int WiFiClient::read(uint8_t* data, size_t size) {
+  if (head == tail) fill();
+  size_t count = tail - head < size ? tail - head : size;
+  if (count == 0) return -1;
+  memcpy(data, buffer + head, count);
+  head += count;
+  return (int)count;
+}
+
+int WiFiClient::peek() {
+  if (head == tail) fill();
+  return head < tail ? buffer[head] : -1;
+}
+
+uint8_t WiFiClient::connected() {
+  if (head < tail) return 1;
+  fill();
+  return head < tail || (fd >= 0 && !peerClosed);
+}
+
+void WiFiClient::stop() {
+  if (fd >= 0) ::close(fd);
+  fd = -1;
+  peerClosed = false;
+  head = tail = 0;
+}
+
+bool resolveHost(const char* host, IPAddress& address) {
+  struct addrinfo hints = {};
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+
+  struct addrinfo* found = nullptr;
+  if (getaddrinfo(host, nullptr, &hints, &found) != 0 || found == nullptr) return false;
+
+  const uint8_t* bytes =
+      (const uint8_t*)&((struct sockaddr_in*)found->ai_addr)->sin_addr.s_addr;
+  address = IPAddress(bytes[0], bytes[1], bytes[2], bytes[3]);
+  freeaddrinfo(found);
+  return true;
+}
+
+void forgetHost(const char*) {}
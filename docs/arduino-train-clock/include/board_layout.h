@@ -0,0 +1,196 @@
+/**
+ * Compile-time Board Layouts for Metro-North Railroad Train Clock
+ *
+ * Where every field of a board goes, worked out by the compiler from the
+ * display's width instead of by column arithmetic per field and train:
+ *
+ *   - the fixed rows of the serial board (box borders, the title box, each
+ *     field's label up to its value slot) are built as constexpr strings
+ *     (LayoutText), so they sit in flash ready to be copied, and follow the
+ *     box width when it changes
+ *   - a panel's rows (GridLayout) are column offsets and widths derived
+ *     from its width by gridLayout(), checked with static_assert for the
+ *     panels the firmware drives (20x4 LCD, 53x30 TFT)
+ *
+ * At runtime only the slots are filled, each clipped to its width, so a
+ * long destination or a delay of 100+ minutes cannot push a border out.
+ *
+ * The builders use C++14 constexpr (loops, member updates), so every env
+ * in platformio.ini builds as gnu++17, the ESP32 one included.
+ *
+ * Usage:
+ *   static constexpr auto TOP = borderRow<192>(61, "┌", "─", "┐");
+ *   frame.appendSized(TOP.text, TOP.length, TOP.columns);
+ *
+ *   constexpr GridLayout lcd = gridLayout(20);
+ *   grid.put(lcd.trackAt, row, train.track, GRID_TRACK_WIDTH, true);
+ */
+
+#ifndef BOARD_LAYOUT_H
+#define BOARD_LAYOUT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Display columns of a UTF-8 string, at compile time (one per code point,
+ * as displayWidth() counts them)
+ */
+constexpr size_t layoutWidth(const char* text) {
+  size_t columns = 0;
+  for (; *text != '\0'; text++) {
+    if (((uint8_t)*text & 0xC0) != 0x80) columns++;
+  }
+  return columns;
+}
+
+/**
+ * A row of fixed text built at compile time, with its length in bytes and
+ * its width in columns, so it is copied without being scanned
+ *
+ * Building more than Capacity - 1 bytes is not a constant expression, so
+ * a layout that outgrows its rows fails to compile.
+ */
+template <size_t Capacity>
+struct LayoutText {
+  char text[Capacity] = {};
+  size_t length = 0;
+  size_t columns = 0;
+
+  // Append `glyph` count times
+  constexpr void add(const char* glyph, size_t count = 1) {
+    for (size_t i = 0; i < count; i++) {
+      for (const char* p = glyph; *p != '\0'; p++) text[length++] = *p;
+      columns += layoutWidth(glyph);
+    }
+  }
+
+  // Pad with spaces up to `column`
+  constexpr void padTo(size_t column) {
+    while (columns < column) add(" ");
+  }
+};
+
+/**
+ * left, `fill` up to `columns` wide, right: a box border
+ */
+template <size_t Capacity>
+constexpr LayoutText<Capacity> borderRow(size_t columns, const char* left,
+                                         const char* fill, const char* right) {
+  LayoutText<Capacity> row;
+  row.add(left);
+  row.add(fill, columns - layoutWidth(left) - layoutWidth(right));
+  row.add(right);
+  return row;
+}
+
+/**
+ * left, `title` centred (an odd space goes on the left), right
+ */
+template <size_t Capacity>
+constexpr LayoutText<Capacity> centredRow(size_t columns, const char* left,
+                                          const char* title, const char* right) {
+  size_t inner = columns - layoutWidth(left) - layoutWidth(right);
+  size_t spare = inner - layoutWidth(title);
+  LayoutText<Capacity> row;
+  row.add(left);
+  row.add(" ", spare - spare / 2);
+  row.add(title);
+  row.add(" ", spare / 2);
+  row.add(right);
+  return row;
+}
+
+/**
+ * left and `label`, padded to `slotColumn`: the start of a row whose value
+ * slot follows
+ */
+template <size_t Capacity>
+constexpr LayoutText<Capacity> labelRow(const char* left, const char* label,
+                                        size_t slotColumn) {
+  LayoutText<Capacity> row;
+  row.add(left);
+  row.add(label);
+  row.padTo(slotColumn);
+  return row;
+}
+
+// The serial monitor board: a box per train, SERIAL_BOX_ROWS lines of
+// SERIAL_BOX_COLUMNS columns. A line takes at most 3 bytes per column (the
+// box glyphs and "…" are 3-byte UTF-8; feed text of 4-byte code points is
+// the only thing that can go over) plus its newline.
+constexpr size_t SERIAL_BOX_COLUMNS = 61;
+constexpr size_t SERIAL_BOX_ROWS = 10; // Top, title, rule, 5 fields, bottom, blank
+constexpr size_t SERIAL_ROW_BYTES = SERIAL_BOX_COLUMNS * 3 + 1;
+constexpr size_t SERIAL_BOX_BYTES = SERIAL_BOX_ROWS * SERIAL_ROW_BYTES;
+
+// The board's header (title box and blank lines) and footer (totals, flags,
+// age), as many lines again at most
+constexpr size_t SERIAL_FRAME_EXTRA_BYTES = 8 * SERIAL_ROW_BYTES;
+
+// Panels this wide show departure time and status in each train row, and
+// from this width on the header names the railroad in full
+constexpr uint8_t GRID_WIDE_MIN_COLUMNS = 40;
+constexpr uint8_t GRID_LONG_TITLE_MIN_COLUMNS = 18;
+
+// Field widths of a panel's rows
+constexpr uint8_t GRID_TIME_WIDTH = 5;      // "14:30"
+constexpr uint8_t GRID_STATUS_WIDTH = 10;   // "Delayed +3"
+constexpr uint8_t GRID_TRACK_WIDTH = 3;
+constexpr uint8_t GRID_COUNTDOWN_WIDTH = 5; // "12m", or "14:30" until synced
+constexpr uint8_t GRID_MORE_WIDTH = 9;      // "+12 more"
+
+/**
+ * Where the fields of a panel's header, train rows and footer go
+ *
+ * Train rows, narrow panels (e.g. 20x4):
+ *   Stamford    7    12m
+ * and from GRID_WIDE_MIN_COLUMNS on, with the departure time and status:
+ *   14:30 Stamford               Delayed +3  7    12m
+ */
+struct GridLayout {
+  bool wide;             // Departure time and status in train rows
+  bool longTitle;        // "Metro-North" rather than "MNR"
+  uint8_t titleWidth;    // Header: title, from column 0
+  uint8_t clockAt;       // Header: time of day
+  uint8_t timeAt;        // Departure time (wide only)
+  uint8_t destinationAt;
+  uint8_t destinationWidth;
+  uint8_t statusAt;      // Status and delay (wide only)
+  uint8_t trackAt;       // Right-aligned
+  uint8_t countdownAt;   // Right-aligned, at the right edge
+  uint8_t moreAt;        // Footer: "+N more", right-aligned
+};
+
+/**
+ * `at` less `width`, or 0 on a panel too narrow for it
+ */
+constexpr uint8_t layoutBefore(uint8_t at, uint8_t width) {
+  return at > width ? at - width : 0;
+}
+
+/**
+ * The layout of a panel `columns` cells wide, fields right to left
+ */
+constexpr GridLayout gridLayout(uint8_t columns) {
+  GridLayout layout = {};
+  layout.wide = columns >= GRID_WIDE_MIN_COLUMNS;
+  layout.longTitle = columns >= GRID_LONG_TITLE_MIN_COLUMNS;
+  layout.clockAt = layoutBefore(columns, GRID_TIME_WIDTH);
+  layout.titleWidth = layoutBefore(layout.clockAt, 1);
+  layout.moreAt = layoutBefore(columns, GRID_MORE_WIDTH);
+
+  layout.countdownAt = layoutBefore(columns, GRID_COUNTDOWN_WIDTH);
+  layout.trackAt = layoutBefore(layout.countdownAt, 1 + GRID_TRACK_WIDTH);
+  uint8_t destinationEnd = layoutBefore(layout.trackAt, 1);
+  if (layout.wide) {
+    layout.timeAt = 0;
+    layout.destinationAt = GRID_TIME_WIDTH + 1;
+    layout.statusAt = layoutBefore(layout.trackAt, 1 + GRID_STATUS_WIDTH);
+    destinationEnd = layoutBefore(layout.statusAt, 1);
+  }
+  layout.destinationWidth = layoutBefore(destinationEnd, layout.destinationAt);
+  return layout;
+}
+
+#endif // BOARD_LAYOUT_H
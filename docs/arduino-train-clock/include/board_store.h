@@ -0,0 +1,43 @@
+/**
+ * Persisted Last-good Board for Metro-North Railroad Train Clock
+ *
+ * Saves the last good TrainTable to NVS in a compact binary form (header,
+ * the valid Train structs, then the pool strings), so after a power cycle
+ * the clock can show the board it had right away, marked stale, instead of
+ * a blank screen until WiFi and the first fetch are done. It also keeps
+ * the board up if the server is down at boot.
+ *
+ * Writes are wear-aware: nothing is written unless the board's content
+ * changed (fetch times alone do not count), and at most once every
+ * BOARD_SAVE_INTERVAL_MS. A board that changed in between is written at
+ * the first save() after the interval.
+ *
+ * Usage:
+ *   BoardStore store;
+ *   if (store.load(board)) ...render board as stale...
+ *   store.save(board);   // after every fetch
+ */
+
+#ifndef BOARD_STORE_H
+#define BOARD_STORE_H
+
+#include "train_table.h"
+
+class BoardStore {
+ public:
+  // Load the saved board into table; false if there is none or it is
+  // from an incompatible firmware
+  bool load(TrainTable& table);
+
+  // Persist table if its content changed and the write interval allows
+  void save(const TrainTable& table);
+
+ private:
+  size_t serialize(const TrainTable& table, uint8_t* out, size_t size) const;
+
+  uint32_t savedChecksum = 0;  // Of the board in NVS (0 = unknown)
+  unsigned long savedAtMs = 0;
+  bool savedThisBoot = false;
+};
+
+#endif // BOARD_STORE_H
@@ -15,6 +15,13 @@
 #define WIFI_SSID "Your_WiFi_SSID"
 #define WIFI_PASSWORD "Your_WiFi_Password"
 
+// Optional: Static IP (skips DHCP for a faster connect)
+// Uncomment all four lines to use a fixed address
+// #define WIFI_STATIC_IP "192.168.1.150"
+// #define WIFI_GATEWAY   "192.168.1.1"
+// #define WIFI_SUBNET    "255.255.255.0"
+// #define WIFI_DNS       "192.168.1.1"
+
 // API Endpoint Configuration
 // Replace with the URL of your MNR GTFS-RT web service
 // 
@@ -40,6 +47,121 @@
 // }
 #define API_ENDPOINT "http://192.168.1.100:5000/api/trains"
 
+// Optional: Payload format
+// The clock asks for MessagePack and falls back to JSON if the server only
+// offers JSON. Set to 0 to always request JSON.
+// #define ACCEPT_MSGPACK 1
+
+// Optional: Compression
+// The clock accepts gzip/deflate responses and inflates them while parsing,
+// keeping only a 2^INFLATE_WINDOW_BITS byte window in RAM. The server must
+// compress with a window no larger than that (the example servers use 4 KB);
+// use 15 (32 KB) for servers you do not control. Set ACCEPT_COMPRESSION to 0
+// to request uncompressed responses.
+// #define ACCEPT_COMPRESSION 1
+// #define INFLATE_WINDOW_BITS 12
+
+// Optional: Delta updates
+// After the first full board the clock asks for changes only
+// (?since=<seq>), which servers that version their boards (see
+// mock_train_server.py) answer with just the changed trains. Other servers
+// ignore the parameter. Set to 0 to always fetch the full board.
+// #define DELTA_SYNC 1
+
+// Optional: Time
+// Arrival times are read as local time in TIME_ZONE (POSIX TZ format, default
+// US Eastern), and the clock is set over SNTP so countdowns can tick between
+// fetches.
+// #define TIME_ZONE "EST5EDT,M3.2.0,M11.1.0"
+// #define NTP_SERVER "pool.ntp.org"
+
+// Optional: Power saving
+// 0 = always on (default), 1 = modem sleep (radio sleeps between beacons,
+// CPU at 80 MHz), 2 = automatic light sleep between fetches and countdown
+// ticks, for battery clocks; build it with the arduino_nano_esp32_light_sleep
+// env (see power_mode.h). Light sleep suspends the USB serial monitor.
+// #define POWER_MODE 0
+
+// Optional: Several views on one board
+// Each entry is a query (URL-encoded) added to API_ENDPOINT, e.g. both
+// directions and a connecting line. The boards of all views are fetched
+// together over one connection (HTTP/1.1 pipelining), so a cycle takes about
+// as long as a single fetch, and merged into one board sorted by departure.
+// Up to 4 views. Server push (below) is used with a single view only.
+// #define API_VIEWS { "route=Hudson%20Line", "route=Harlem%20Line" }
+
+// Optional: Station and direction
+// Every request also asks for only the fields the clock keeps and only as
+// many trains as the display has rows for (fields= and limit=), so a busy
+// station costs no more than a quiet one. These narrow every view to the
+// trains calling at a station (origin_station=) and ending their trip at a
+// terminal (destination_station=). Both are GTFS stop IDs, as listed by
+// web_server.py's GET /stations; "1" is Grand Central Terminal.
+// #define API_STATION "your-stop-id"
+// #define API_DESTINATION "1"
+
+// Optional: Server push
+// With a Server-Sent Events endpoint, the server pushes each change as it
+// happens, e.g. a track assignment, instead of waiting for the next poll.
+// The clock polls API_ENDPOINT only while the stream is down.
+// web_server.py serves one at /trains/stream, which refetches the feed
+// every 15 s and sends full boards; the stream sends only `since=` itself,
+// so give it the view's query (fields=, limit=, origin_station=...) in the
+// URL. mock_train_server.py serves /api/trains/stream, with deltas.
+// #define PUSH_ENDPOINT "http://192.168.1.100:5000/trains/stream?origin_station=1&limit=10"
+
+// Optional: Display
+// 0 = serial monitor (default), 1 = HD44780 character LCD on a PCF8574 I2C
+// backpack, 2 = SPI TFT or colour OLED driven by TFT_eSPI (panel type and
+// pins are set with TFT_eSPI build flags in platformio.ini). Panels are
+// updated in place: only characters that changed are sent.
+// #define DISPLAY_BACKEND 0
+// #define LCD_I2C_ADDRESS 0x27
+// #define LCD_COLUMNS 20
+// #define LCD_ROWS 4
+// #define TFT_TEXT_SIZE 2
+// #define TFT_ROTATION 1
+
+// Optional: Metrics endpoint
+// Per-phase fetch timings (DNS, connect, TLS, first byte, body, parse,
+// render), heap and WiFi health are always collected; type "metrics" in the
+// serial monitor to see them. Set a port to also serve them in Prometheus
+// text format at http://<clock-ip>:<port>/metrics.
+// #define METRICS_PORT 9100
+
+// Optional: JSON arena size
+// Each train record is parsed into a fixed arena, in PSRAM if the board has
+// it, so fetching never allocates from the heap. Raise it if the serial
+// monitor reports requests that did not fit (type "metrics").
+// #define JSON_ARENA_BYTES 4096
+
+// Optional: Timetable in flash
+// With the station's timetable flashed to the schedule partition (see
+// README, "Timetable in Flash"), the clock builds the board itself and asks
+// the server only for delays, tracks and status. Set to 0 to fetch full
+// boards all the same; SCHEDULE_LOOKBACK is how far back (in seconds) a
+// late train is looked for.
+// #define SCHEDULE_COMPACT_FETCH 1
+// #define SCHEDULE_LOOKBACK 3600
+
+// Optional: Find the server on the LAN
+// Servers that advertise _mnr-trains._tcp over mDNS (example_web_server.py
+// and mock_train_server.py do, with `pip install zeroconf`) are found at
+// boot, so a server that moves needs no reflash. The server found is saved
+// and polled from the next boot on; API_ENDPOINT is used until one is found.
+// #define SERVICE_DISCOVERY 1
+
+// Optional: Server checks for https:// endpoints
+// By default the connection is encrypted but any certificate is accepted.
+// Pin the server's certificate by its SHA-256 fingerprint (cheapest: no CA
+// is loaded, and it works before the clock has synced), or check it against
+// the one CA that issued it (keeps working when the certificate is renewed
+// by the same CA). Either way the TLS session is resumed on reconnects, so
+// only the first connection pays for a full handshake.
+//   openssl s_client -connect host:443 </dev/null | openssl x509 -noout -fingerprint -sha256
+// #define TLS_FINGERPRINT "AB:CD:EF:01:23:45:67:89:AB:CD:EF:01:23:45:67:89:AB:CD:EF:01:23:45:67:89:AB:CD:EF:01:23:45:67:89"
+// #define TLS_CA_CERT "-----BEGIN CERTIFICATE-----\nMIIF...\n-----END CERTIFICATE-----\n"
+
 // Optional: API Key (if your service requires authentication)
 // Uncomment and set if needed
 // #define API_KEY "your-api-key-here"
@@ -0,0 +1,134 @@
+/**
+ * Configuration Defaults for Metro-North Railroad Train Clock
+ *
+ * Fallback values for the optional settings in config.h, so an existing
+ * config.h keeps working when new options are added. Include this right
+ * after config.h; anything defined there takes precedence.
+ */
+
+#ifndef CONFIG_DEFAULTS_H
+#define CONFIG_DEFAULTS_H
+
+// Ask the server for MessagePack (smaller and faster to parse than JSON).
+// Servers that only speak JSON keep working: the reply's Content-Type
+// decides which decoder is used.
+#ifndef ACCEPT_MSGPACK
+#define ACCEPT_MSGPACK 1
+#endif
+
+// Ask for gzip/deflate-compressed responses, decoded on the fly
+#ifndef ACCEPT_COMPRESSION
+#define ACCEPT_COMPRESSION 1
+#endif
+
+// Inflate window: 2^bits bytes of RAM. Must be at least the window the
+// server compresses with (the example servers use 12 = 4 KB; generic
+// servers such as nginx need 15 = 32 KB).
+#ifndef INFLATE_WINDOW_BITS
+#define INFLATE_WINDOW_BITS 12
+#endif
+
+// Request only the trains that changed since the board the clock holds
+#ifndef DELTA_SYNC
+#define DELTA_SYNC 1
+#endif
+
+// Local time zone (POSIX TZ string) the server's arrival times are in
+#ifndef TIME_ZONE
+#define TIME_ZONE "EST5EDT,M3.2.0,M11.1.0"
+#endif
+
+// SNTP server for the wall clock
+#ifndef NTP_SERVER
+#define NTP_SERVER "pool.ntp.org"
+#endif
+
+// How the clock idles between fetches: 0 always on, 1 modem sleep,
+// 2 light sleep (see power_mode.h)
+#ifndef POWER_MODE
+#define POWER_MODE 0
+#endif
+
+// Queries for the views shown on one board, each added to API_ENDPOINT's
+// query string (e.g. { "route=Hudson%20Line", "route=Harlem%20Line" }).
+// Up to 4; the default is a single view of API_ENDPOINT as it is.
+#ifndef API_VIEWS
+#define API_VIEWS { "" }
+#endif
+
+// The board's station and the terminal its trains head for, both GTFS
+// stop IDs (e.g. "1", Grand Central Terminal), sent with every view as
+// origin_station= and destination_station=. Empty: whatever API_ENDPOINT
+// and API_VIEWS select.
+#ifndef API_STATION
+#define API_STATION ""
+#endif
+#ifndef API_DESTINATION
+#define API_DESTINATION ""
+#endif
+
+// Find the server on the LAN by DNS-SD (_mnr-trains._tcp) at boot, with
+// API_ENDPOINT as the fallback (see service_discovery.h)
+#ifndef SERVICE_DISCOVERY
+#define SERVICE_DISCOVERY 0
+#endif
+
+// Server-Sent Events stream of board changes (e.g.
+// "http://192.168.1.100:5000/api/trains/stream"). Empty: poll only.
+#ifndef PUSH_ENDPOINT
+#define PUSH_ENDPOINT ""
+#endif
+
+// Where the board is drawn: 0 serial monitor, 1 HD44780 LCD on an I2C
+// backpack, 2 SPI TFT/OLED via TFT_eSPI (see display.h)
+#ifndef DISPLAY_BACKEND
+#define DISPLAY_BACKEND 0
+#endif
+
+// I2C character LCD (DISPLAY_BACKEND 1)
+#ifndef LCD_I2C_ADDRESS
+#define LCD_I2C_ADDRESS 0x27
+#endif
+#ifndef LCD_COLUMNS
+#define LCD_COLUMNS 20
+#endif
+#ifndef LCD_ROWS
+#define LCD_ROWS 4
+#endif
+
+// SPI panel (DISPLAY_BACKEND 2): text size (1 = 6x8 pixel characters) and
+// rotation (1 = landscape)
+#ifndef TFT_TEXT_SIZE
+#define TFT_TEXT_SIZE 2
+#endif
+#ifndef TFT_ROTATION
+#define TFT_ROTATION 1
+#endif
+
+// Bytes of the arena one train record is parsed into (see json_arena.h),
+// taken from PSRAM when the board has it. A filtered record needs a few
+// hundred; "metrics" on the serial monitor shows the most used so far.
+#ifndef JSON_ARENA_BYTES
+#define JSON_ARENA_BYTES 4096
+#endif
+
+// With a timetable in flash (see schedule_index.h): 1 asks the server for
+// compact boards (trip_id, track, status and delay only, fields=), as
+// the clock has the rest; 0 fetches full boards and lays them over it
+#ifndef SCHEDULE_COMPACT_FETCH
+#define SCHEDULE_COMPACT_FETCH 1
+#endif
+
+// Seconds before now that the timetable is searched from, so a train that
+// is running late still shows when the server lists it
+#ifndef SCHEDULE_LOOKBACK
+#define SCHEDULE_LOOKBACK 3600
+#endif
+
+// TCP port of the GET /metrics endpoint (Prometheus text format, see
+// metrics_server.h). 0: off; the "metrics" serial command always works.
+#ifndef METRICS_PORT
+#define METRICS_PORT 0
+#endif
+
+#endif // CONFIG_DEFAULTS_H
@@ -0,0 +1,78 @@
+/**
+ * Display Backends for Metro-North Railroad Train Clock
+ *
+ * The render task draws every board through a Display, so the same firmware
+ * can show it on the serial monitor or on a panel. DISPLAY_BACKEND in
+ * config.h selects one:
+ *
+ *   DISPLAY_SERIAL   boxed board on the serial monitor (default; see
+ *                    serial_display.h)
+ *   DISPLAY_LCD_I2C  HD44780 character LCD (e.g. 20x4) on a PCF8574 I2C
+ *                    backpack (see lcd_display.h)
+ *   DISPLAY_TFT_SPI  SPI TFT or colour OLED driven by TFT_eSPI (see
+ *                    tft_display.h)
+ *
+ * Panels never clear and redraw: a backend diffs each frame against the one
+ * on the panel and sends only what changed, so the countdown ticking once a
+ * minute costs a few characters of bus time and does not flicker.
+ *
+ * Usage (render task only):
+ *   display.begin();
+ *   display.drawBoard(table, drawnBefore ? &previous : nullptr);
+ *   display.tick(table, countdownsMoved);   // every COUNTDOWN_TICK
+ */
+
+#ifndef DISPLAY_H
+#define DISPLAY_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "config_defaults.h"
+#include "train_table.h"
+
+#define DISPLAY_SERIAL 0
+#define DISPLAY_LCD_I2C 1
+#define DISPLAY_TFT_SPI 2
+
+// Countdown buckets besides whole minutes to go
+const int16_t COUNTDOWN_UNKNOWN = -3;
+const int16_t COUNTDOWN_DEPARTED = -2;
+const int16_t COUNTDOWN_DUE = -1;
+
+// What a train's countdown shows: minutes to go, or one of the states above
+int16_t countdownBucket(time_t arrival, time_t now);
+
+// "in 5 min", "due now", "departed" or "N/A"
+void formatCountdown(time_t arrival, time_t now, char* buffer, size_t size);
+
+// The same in at most 4 characters for small panels: "5m", "due", "dep"
+// or "--"
+void formatShortCountdown(time_t arrival, time_t now, char* buffer,
+                          size_t size);
+
+class Display {
+ public:
+  virtual ~Display() {}
+
+  // Initialise the output; false if no panel answers
+  virtual bool begin() = 0;
+
+  // Draw a newly published board. `previous` is the board drawn before it,
+  // or nullptr for the first one.
+  virtual void drawBoard(const TrainTable& table,
+                         const TrainTable* previous) = 0;
+
+  // Called every countdown tick between boards; `countdownsMoved` is true
+  // when a train's countdown changed since the last draw or tick
+  virtual void tick(const TrainTable& table, bool countdownsMoved) = 0;
+
+  // True if the display shows the time of day, so it has something new to
+  // draw at the start of every minute
+  virtual bool showsClock() const { return false; }
+
+  // Trains the display has room for (once begin() has run), so the server
+  // is asked for no more; default: as many as a board holds
+  virtual uint8_t trainRows() const { return MAX_TRAINS; }
+};
+
+#endif // DISPLAY_H
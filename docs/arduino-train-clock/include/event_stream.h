@@ -0,0 +1,68 @@
+/**
+ * Server-Sent Events Reader for Metro-North Railroad Train Clock
+ *
+ * Splits a text/event-stream body into events and presents the data of the
+ * current event as a Stream, so a pushed board is decoded in place by the
+ * same TrainDecoder as a polled one. Comment lines (the server's
+ * heartbeats) are skipped, and an event's data lines are joined with '\n'
+ * as the SSE format specifies. The `event:` and `id:` fields are expected
+ * before `data:`, as servers send them.
+ *
+ * Usage:
+ *   EventStream events;
+ *   events.begin(push.body());
+ *   if (events.next()) {
+ *     decoder.decode(events, PAYLOAD_JSON, table);
+ *     events.finish();
+ *   }
+ */
+
+#ifndef EVENT_STREAM_H
+#define EVENT_STREAM_H
+
+#include <Arduino.h>
+
+class EventStream : public Stream {
+ public:
+  // Start reading a new event stream from source
+  void begin(Stream& source);
+
+  // Move to the data of the next event. Returns false without blocking
+  // when no bytes are waiting, and once the source has ended.
+  bool next();
+
+  // Skip whatever is left of the current event's data
+  void finish();
+
+  // Type (`event:` field, "message" if none) and `id:` of the current event
+  const char* type() const { return eventType; }
+  const char* lastId() const { return eventId; }
+
+  // True once the source returned end of stream (connection closed or
+  // timed out mid-event)
+  bool ended() const { return sourceEnded; }
+
+  int available() override;
+  int read() override;
+  int peek() override;
+  size_t readBytes(char* buffer, size_t length) override;
+  size_t write(uint8_t) override { return 0; }
+
+ private:
+  int readField(char* name, size_t size);
+  void readValue(char* buffer, size_t size);
+  int nextByte();
+  int dataByte();
+
+  Stream* source = nullptr;
+  bool inData = false;     // Between `data:` and the event's blank line
+  bool eventDone = false;  // Blank line read: fields belong to a new event
+  bool sourceEnded = false;
+  bool pendingCr = false;  // Last line ended in CR; skip a following LF
+  int lookahead = -1;      // Byte read past a field's `:`, not yet used
+  int peeked = -1;         // Data byte returned by peek()
+  char eventType[16] = "message";
+  char eventId[16] = "";
+};
+
+#endif // EVENT_STREAM_H
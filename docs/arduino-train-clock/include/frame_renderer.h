@@ -0,0 +1,87 @@
+/**
+ * Frame-buffered Text Renderer for Metro-North Railroad Train Clock
+ *
+ * Composes a whole display frame in a fixed static buffer and sends it with
+ * a single write, instead of one Serial.print per field and per padding
+ * space. Besides cutting thousands of tiny USB-CDC writes per board down to
+ * one, this keeps frames from tearing when several tasks log at once.
+ *
+ * The renderer tracks the display column of the current line, counting
+ * UTF-8 code points rather than bytes, so box-drawing glyphs (│, ─, →) do
+ * not throw off padding.
+ *
+ * Usage:
+ *   FrameRenderer frame(Serial);
+ *   frame.begin();
+ *   frame.append("│ Route: ");
+ *   frame.appendClipped(route, 40);
+ *   frame.padTo(60);
+ *   frame.appendLine("│");
+ *   frame.flush();
+ */
+
+#ifndef FRAME_RENDERER_H
+#define FRAME_RENDERER_H
+
+#include <Arduino.h>
+#include "board_layout.h"
+#include "train_table.h"
+
+// A whole serial board at its largest: header, MAX_TRAINS boxes and footer
+// (about 38 KB). Anything longer is still rendered, in several writes.
+#define FRAME_BUFFER_SIZE (SERIAL_FRAME_EXTRA_BYTES + MAX_TRAINS * SERIAL_BOX_BYTES)
+
+/**
+ * Number of display columns taken by a UTF-8 string
+ *
+ * Every code point counts as one column (true for the glyphs used here).
+ */
+size_t displayWidth(const char* text);
+
+class FrameRenderer {
+ public:
+  explicit FrameRenderer(Print& out) : out(out) {}
+
+  // Start a new frame
+  void begin();
+
+  void append(const char* text);
+  void appendf(const char* format, ...);
+
+  // Append at most maxColumns columns of text; longer text ends in "…"
+  void appendClipped(const char* text, size_t maxColumns);
+
+  // Exactly `columns` columns: text clipped as by appendClipped(), then
+  // padded with spaces (a fixed-width field slot)
+  void appendPadded(const char* text, size_t columns);
+
+  // Append text whose length in bytes and width are already known (a
+  // LayoutText row, see board_layout.h), without scanning it
+  void appendSized(const char* text, size_t length, size_t columns) {
+    appendBytes(text, length, columns);
+  }
+
+  // Append `glyph` count times (e.g. a border line)
+  void appendRepeat(const char* glyph, size_t count);
+
+  // Pad the current line with spaces up to display column `column`
+  void padTo(size_t column);
+
+  void appendLine(const char* text = "");
+
+  // Column of the next character on the current line
+  size_t column() const { return col; }
+
+  // Send the frame with a single write
+  void flush();
+
+ private:
+  void appendBytes(const char* data, size_t len, size_t columns);
+
+  Print& out;
+  char buffer[FRAME_BUFFER_SIZE];
+  size_t len = 0;
+  size_t col = 0;
+};
+
+#endif // FRAME_RENDERER_H
@@ -0,0 +1,91 @@
+/**
+ * Character-grid Displays for Metro-North Railroad Train Clock
+ *
+ * Base for the panel backends. A board is laid out as a grid of character
+ * cells (a header with the time, one row per train, and on taller panels a
+ * footer), composed into a CellGrid in RAM. The new grid is compared with
+ * the one on the panel, and only the runs of changed cells are handed to
+ * the backend's drawRun(), so a countdown moving from "12m" to "11m" sends
+ * two characters instead of a whole screen.
+ *
+ * Where each field goes comes from the panel's width (gridLayout() in
+ * board_layout.h), worked out once when the geometry is set; each row
+ * then only fills fixed-width slots.
+ *
+ * Text is ASCII: other characters (UTF-8 sequences) show as '?'.
+ */
+
+#ifndef GRID_DISPLAY_H
+#define GRID_DISPLAY_H
+
+#include "board_layout.h"
+#include "display.h"
+
+// Largest grid held (a 320x240 TFT at text size 1 is 53x30 cells)
+#define GRID_MAX_COLUMNS 64
+#define GRID_MAX_ROWS 30
+
+/**
+ * Fixed-size grid of character cells
+ */
+class CellGrid {
+ public:
+  // Set the size and blank every cell
+  void resize(uint8_t columns, uint8_t rows);
+  void clear();
+
+  // Write text into `width` cells from (column, row), clipped at the
+  // grid's edge. Shorter text is padded with spaces, on the left when
+  // alignRight is set.
+  void put(uint8_t column, uint8_t row, const char* text, uint8_t width,
+           bool alignRight = false);
+
+  const char* row(uint8_t index) const { return cells[index]; }
+  uint8_t columns() const { return columnCount; }
+  uint8_t rows() const { return rowCount; }
+
+ private:
+  char cells[GRID_MAX_ROWS][GRID_MAX_COLUMNS];
+  uint8_t columnCount = 0;
+  uint8_t rowCount = 0;
+};
+
+class GridDisplay : public Display {
+ public:
+  void drawBoard(const TrainTable& table, const TrainTable* previous) override;
+  void tick(const TrainTable& table, bool countdownsMoved) override;
+  bool showsClock() const override { return true; }
+  uint8_t trainRows() const override;
+
+ protected:
+  // `mergeGap`: changed runs separated by at most this many unchanged
+  // cells are sent as one (when moving the cursor costs about as much as
+  // resending a cell)
+  explicit GridDisplay(uint8_t mergeGap) : mergeGap(mergeGap) {}
+
+  // Set the panel's size in cells, once known (in begin())
+  void setGeometry(uint8_t columns, uint8_t rows);
+
+  // The panel now shows blank cells (after clearing it)
+  void panelCleared() { shown.clear(); }
+
+  // Draw `length` cells of `text` (not NUL-terminated) from (column, row)
+  virtual void drawRun(uint8_t column, uint8_t row, const char* text,
+                       uint8_t length) = 0;
+
+  // Called after the last run of a frame
+  virtual void endFrame() {}
+
+ private:
+  void compose(const TrainTable& table);
+  void composeTrain(const TrainTable& table, uint8_t index, uint8_t row,
+                    time_t now);
+  void present();
+
+  CellGrid next;  // Frame being composed
+  CellGrid shown; // What the panel shows
+  GridLayout layout = gridLayout(0);
+  uint8_t mergeGap;
+};
+
+#endif // GRID_DISPLAY_H
@@ -0,0 +1,38 @@
+/**
+ * Host Name Cache for Metro-North Railroad Train Clock
+ *
+ * Resolves server names for HttpSession and keeps the answers for as long
+ * as their DNS TTL says, so a poll only waits for a lookup when the record
+ * has expired (and not after every reconnect, as lwIP's small table often
+ * makes it). Queries go straight to the DHCP-assigned DNS servers over UDP,
+ * which is how the TTL becomes known; lwIP's resolver is the fallback, and
+ * handles .local names (mDNS).
+ *
+ * When a lookup fails, an expired address is still used for up to an hour
+ * (RFC 8767 "serve stale"): a consumer router that is slow or down for a
+ * moment does not stop the clock from reaching a server it knows.
+ *
+ * Network task only; the cache is a few entries in RAM and survives WiFi
+ * reconnects and light sleep.
+ *
+ * Usage:
+ *   IPAddress address;
+ *   if (resolveHost("trains.example.com", address)) client.connect(address, 443);
+ *   ...connect failed: forgetHost("trains.example.com");
+ */
+
+#ifndef HOST_RESOLVER_H
+#define HOST_RESOLVER_H
+
+#include <Arduino.h>
+#include <IPAddress.h>
+
+// Address of `host` (a name, or a dotted IPv4 address) from the cache, or
+// looked up if it has expired. False if it cannot be resolved.
+bool resolveHost(const char* host, IPAddress& address);
+
+// Drop the cached address of `host`, e.g. after connecting to it failed,
+// so the next resolveHost() asks again
+void forgetHost(const char* host);
+
+#endif // HOST_RESOLVER_H
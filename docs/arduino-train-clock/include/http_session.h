@@ -0,0 +1,294 @@
+/**
+ * Persistent HTTP/1.1 Session for Metro-North Railroad Train Clock
+ *
+ * Keeps one keep-alive connection to API_ENDPOINT open across fetch cycles,
+ * so a poll costs one request/response instead of a DNS lookup, a TCP
+ * handshake and (for https://) a TLS handshake every time. When the server
+ * has closed the idle socket, the request is re-sent once on a fresh
+ * connection without the caller noticing; over https:// that connection
+ * resumes the last TLS session (see tls_client.h).
+ *
+ * The response body is exposed as a Stream that understands Content-Length
+ * and chunked framing, so it can be parsed in place and the connection
+ * stays in sync for the next request. Validators of the last accepted
+ * response are sent back so unchanged data costs only a 304 reply.
+ *
+ * DNS lookup, connect / TLS handshake, time to first byte and waits for
+ * body bytes are recorded in metrics.h.
+ *
+ * Each of those waits has a budget of its own (setTimeouts()): connect,
+ * first byte, and every further wait for bytes, so a body that stalls is
+ * given up after the read budget rather than after the whole timeout. On
+ * top, setDeadline() bounds a whole fetch cycle: every wait ends by then,
+ * and requests not answered by then fail with HTTP_SESSION_ERROR_DEADLINE.
+ * A body cut off that way simply ends early; what was read of it stays
+ * usable (see bodyTimedOut()).
+ *
+ * Several resources on the same server can be fetched in one round trip:
+ * pipeline() sends their requests back to back and nextResponse() reads the
+ * answers in order, so N queries cost about one request's latency instead
+ * of N.
+ *
+ * Usage:
+ *   HttpSession api;
+ *   api.begin("http://192.168.1.100:5000/api/trains");
+ *   int code = api.get();
+ *   if (code == HTTP_CODE_OK) deserializeJson(doc, api.body());
+ *   api.end();
+ *
+ *   const char* queries[] = { "route=Hudson%20Line", "route=Harlem%20Line" };
+ *   HttpValidators hudson, harlem;
+ *   HttpValidators* validators[] = { &hudson, &harlem };
+ *   api.pipeline(queries, validators, 2);
+ *   for (int i = 0; i < 2; i++) {
+ *     int code = api.nextResponse();
+ *     ...read api.body()...
+ *     api.end();
+ *   }
+ */
+
+#ifndef HTTP_SESSION_H
+#define HTTP_SESSION_H
+
+#include <WiFi.h>
+#include <HTTPClient.h> // t_http_codes status constants
+
+// 0 builds the session without https:// support, for hosts that have no
+// TlsClient (the native fleet build, see fleet/fleet.cpp)
+#ifndef HTTP_SESSION_TLS
+#define HTTP_SESSION_TLS 1
+#endif
+
+#if HTTP_SESSION_TLS
+#include "tls_client.h"
+#endif
+
+// Negative results of HttpSession::get()
+enum HttpSessionError {
+  HTTP_SESSION_ERROR_BAD_URL = -1,
+  HTTP_SESSION_ERROR_CONNECT = -2,
+  HTTP_SESSION_ERROR_SEND = -3,
+  HTTP_SESSION_ERROR_NO_RESPONSE = -4,
+  HTTP_SESSION_ERROR_BAD_RESPONSE = -5,
+  HTTP_SESSION_ERROR_DEADLINE = -6,
+  HTTP_SESSION_ERROR_REQUEST_TOO_LONG = -7,
+};
+
+// Longest query get() / pipeline() take, with its NUL; a longer one fails
+// with HTTP_SESSION_ERROR_REQUEST_TOO_LONG
+const size_t HTTP_SESSION_QUERY_CAPACITY = 256;
+
+/**
+ * Response body reader bounded by the message framing
+ *
+ * Reads return -1 / short counts once the body is exhausted, never bytes
+ * belonging to the next response on the connection.
+ */
+class HttpBodyStream : public Stream {
+ public:
+  void reset(Client* client, long contentLength, bool chunked,
+             unsigned long timeoutMs);
+
+  // Stop reading at millis() == deadlineMs as well (if `bounded`)
+  void setDeadline(bool bounded, unsigned long deadlineMs);
+
+  // True once every byte of the body has been consumed
+  bool complete() const { return done; }
+
+  // True if reading stopped short of the end with the connection still
+  // open: the read budget or the deadline ran out
+  bool timedOut() const { return expired; }
+
+  // Consume whatever is left of the body; false if the connection broke
+  bool drain();
+
+  // Total time spent waiting for body bytes to arrive, in microseconds
+  unsigned long waitMicros() const { return waitUs; }
+
+  int available() override;
+  int read() override;
+  int peek() override;
+  size_t readBytes(char* buffer, size_t length) override;
+  size_t write(uint8_t) override { return 0; }
+
+ private:
+  bool nextChunk();
+  unsigned long waitLimit() const;
+
+  Client* client = nullptr;
+  long remaining = 0;      // Bytes left in the body (or current chunk)
+  bool chunked = false;
+  bool untilClose = false; // No framing given: body ends when socket closes
+  bool chunkOpen = false;  // Inside a chunk whose trailing CRLF is pending
+  bool done = true;
+  int peeked = -1;
+  bool expired = false;
+  bool bounded = false;
+  unsigned long deadlineMs = 0;
+  unsigned long timeoutMs = 10000;
+  unsigned long waitUs = 0;
+};
+
+/**
+ * ETag / Last-Modified of the last accepted response for one resource
+ */
+struct HttpValidators {
+  char etag[72] = "";
+  char lastModified[40] = "";
+
+  void clear() {
+    etag[0] = '\0';
+    lastModified[0] = '\0';
+  }
+};
+
+class HttpSession {
+ public:
+  // Parse the endpoint URL; no network traffic until the first get()
+  bool begin(const char* url);
+
+  // Add a header sent with every request (e.g. an API key)
+  bool addHeader(const char* name, const char* value);
+
+  // Media types offered in the Accept header (default "application/json")
+  void setAccept(const char* mediaTypes);
+
+  // Content codings offered in Accept-Encoding (default: none, identity)
+  void setAcceptEncoding(const char* codings);
+
+  // Send a GET for the configured path and read the response headers.
+  // `query` (e.g. "since=42") is appended to the path's query string.
+  // Returns the HTTP status code, or a negative HttpSessionError.
+  int get(const char* query = nullptr);
+
+  // Queue a GET for each query (as for get()); they are written back to back
+  // when the first response is requested. validators[i] holds query i's
+  // validators (see acceptValidators()). Both arrays must stay valid until
+  // the last response has been read.
+  void pipeline(const char* const* queries, HttpValidators* const* validators,
+                uint8_t count);
+
+  // Read the headers of the next pipelined response; returns like get().
+  // Requests the server did not answer before closing the connection are
+  // re-sent on a new one. After a connection error every remaining
+  // response reports that error, without further waits.
+  int nextResponse();
+
+  // Body of the response returned by the last get() or nextResponse()
+  Stream& body() { return bodyStream; }
+
+  // Content-Type of that response ("" if none was sent)
+  const char* contentType() const { return responseContentType; }
+
+  // Content-Encoding of that response ("" for identity)
+  const char* contentEncoding() const { return responseContentEncoding; }
+
+  // Cache-Control max-age and Retry-After of that response in seconds, or
+  // -1 if absent (or, for Retry-After, given as an HTTP date)
+  long maxAge() const { return responseMaxAge; }
+  long retryAfter() const { return responseRetryAfter; }
+
+  // Finish the current response. The connection is kept open for the next
+  // get() unless the server asked to close it or the body was not framed.
+  void end();
+
+  // Drop the connection (e.g. after WiFi loss)
+  void close();
+
+  // True while the connection is open (the server has not closed it)
+  bool isOpen() const { return connected && client->connected(); }
+
+  // Remember the ETag / Last-Modified of the current response (in the
+  // session for get(), in the request's HttpValidators for pipeline()).
+  // Later requests send them back (If-None-Match / If-Modified-Since), so
+  // the server can answer 304 Not Modified when nothing has changed.
+  void acceptValidators();
+  void clearValidators() { ownValidators.clear(); }
+
+  // True when the last get() was served on an already open connection
+  bool reusedConnection() const { return reused; }
+
+  // Time spent waiting for body bytes, in microseconds, accumulated over
+  // the session (take the difference around a read to time one body)
+  unsigned long bodyWaitMicros() const { return bodyStream.waitMicros(); }
+
+  // Budgets of the waits of a request: TCP connect (with the TLS
+  // handshake), the status line after sending (time to first byte), and
+  // each later wait for bytes (headers, body). setTimeout() sets all three.
+  void setTimeouts(unsigned long connectMs, unsigned long firstByteMs,
+                   unsigned long readMs);
+  void setTimeout(unsigned long ms) { setTimeouts(ms, ms, ms); }
+
+  // End every wait by millis() == deadlineMs, until clearDeadline(): a
+  // fetch cycle of several requests then takes no longer than that
+  void setDeadline(unsigned long deadlineMs);
+  void clearDeadline();
+
+  // True if the current response's body stopped short at a budget or the
+  // deadline; what was read of it before is intact
+  bool bodyTimedOut() const { return bodyStream.timedOut(); }
+
+#if HTTP_SESSION_TLS
+  // How https:// servers are checked (setCACert(), setFingerprint());
+  // any certificate is accepted unless one is set
+  TlsClient& tls() { return tlsClient; }
+#endif
+
+  static const char* errorToString(int error);
+
+ private:
+  bool connect();
+  bool pastDeadline() const;
+  unsigned long budget(unsigned long phaseMs) const;
+  int sendRequest(uint8_t index);
+  int readResponseHead();
+  int readLine(char* buffer, size_t size);
+
+  WiFiClient plainClient;
+#if HTTP_SESSION_TLS
+  TlsClient tlsClient;
+#endif
+  Client* client = nullptr;
+  HttpBodyStream bodyStream;
+
+  char host[64] = "";
+  char path[160] = "/";
+  char extraHeaders[160] = "";
+  char accept[80] = "application/json";
+  char acceptEncoding[32] = "";
+
+  // Validators of the last accepted response of get(), and of the current
+  // response
+  HttpValidators ownValidators;
+  char responseEtag[72] = "";
+  char responseLastModified[40] = "";
+  char responseContentType[48] = "";
+  char responseContentEncoding[16] = "";
+  long responseMaxAge = -1;
+  long responseRetryAfter = -1;
+  uint16_t port = 80;
+  bool secure = false;
+  bool configured = false;
+
+  // Requests of the current pipeline
+  const char* const* queries = nullptr;
+  HttpValidators* const* validators = nullptr;
+  const char* singleQuery = nullptr; // get()'s one-entry lists
+  HttpValidators* singleValidators = &ownValidators;
+  uint8_t queryCount = 0;
+  uint8_t nextIndex = 0;       // Next response to read
+  uint8_t responseIndex = 0;   // Response being read
+  bool requestsSent = false;   // Requests from nextIndex on are on the wire
+  int pipelineError = 0;       // Reported for the rest after a failure
+
+  bool connected = false;
+  bool reused = false;
+  bool keepAlive = false;
+  unsigned long connectMs = 10000;
+  unsigned long firstByteMs = 10000;
+  unsigned long readMs = 10000;
+  bool bounded = false; // A deadline is set
+  unsigned long deadlineMs = 0;
+};
+
+#endif // HTTP_SESSION_H
@@ -0,0 +1,75 @@
+/**
+ * Streaming gzip / deflate Decoder for Metro-North Railroad Train Clock
+ *
+ * Wraps a compressed response body and presents the decompressed bytes as a
+ * Stream, so the parser reads plain text while only compressed bytes cross
+ * the air. Decompression uses the miniz inflater in the ESP32 ROM with a
+ * small ring-buffer window: the decompressed text is never held in full,
+ * only the last 2^INFLATE_WINDOW_BITS bytes of it.
+ *
+ * The window must be at least as large as the one the server compressed
+ * with. zlib ("deflate") streams declare their window and are rejected if it
+ * is too large; gzip streams do not, so the server has to be configured to
+ * match (the example servers compress with a 4 KB window).
+ *
+ * Usage:
+ *   InflateStream inflater;
+ *   inflater.begin(api.body(), INFLATE_GZIP);
+ *   deserializeJson(doc, inflater);
+ */
+
+#ifndef INFLATE_STREAM_H
+#define INFLATE_STREAM_H
+
+#include <Arduino.h>
+#include <rom/miniz.h>
+#include "config_defaults.h"
+
+enum InflateFormat {
+  INFLATE_GZIP,   // Content-Encoding: gzip (RFC 1952)
+  INFLATE_ZLIB,   // Content-Encoding: deflate (RFC 1950)
+};
+
+class InflateStream : public Stream {
+ public:
+  // Start decoding a new compressed stream read from source
+  void begin(Stream& source, InflateFormat format);
+
+  // True if the compressed data was malformed or truncated
+  bool failed() const { return error; }
+
+  int available() override;
+  int read() override;
+  int peek() override;
+  size_t readBytes(char* buffer, size_t length) override;
+  size_t write(uint8_t) override { return 0; }
+
+ private:
+  static const size_t WINDOW_SIZE = (size_t)1 << INFLATE_WINDOW_BITS;
+
+  bool readHeader();
+  bool skipZeroTerminated();
+  bool readInput(uint8_t* dest, size_t count);
+  bool refill();
+  void checkTrailer();
+
+  Stream* source = nullptr;
+  InflateFormat format = INFLATE_GZIP;
+  bool headerDone = false;
+  bool finished = false;   // End of the deflate stream reached
+  bool sourceDone = false; // No more compressed input
+  bool error = false;
+
+  tinfl_decompressor inflator;
+  uint8_t window[WINDOW_SIZE];
+  size_t windowPos = 0;    // Where tinfl writes next
+  size_t outStart = 0;     // Decoded bytes not yet handed out:
+  size_t outEnd = 0;       //   window[outStart, outEnd)
+  uint32_t totalOut = 0;
+
+  uint8_t input[512];
+  size_t inputPos = 0;
+  size_t inputLen = 0;
+};
+
+#endif // INFLATE_STREAM_H
@@ -0,0 +1,61 @@
+/**
+ * JSON Arena Allocator for Metro-North Railroad Train Clock
+ *
+ * ArduinoJson Allocator that hands out memory from one fixed region,
+ * taken once at boot and never given back: in PSRAM on boards that have
+ * it, in internal SRAM otherwise. Allocation bumps a pointer; freeing
+ * does nothing (except for the most recent block, so a string growing by
+ * realloc stays in place), and reset() empties the whole region at once.
+ *
+ * The decoder resets the arena before each train record, so parsing never
+ * touches the system heap: no malloc cost per record, and no heap
+ * fragmentation from a pool of slightly different sizes every fetch.
+ *
+ * If the region cannot be had at boot, the arena falls back to malloc and
+ * free, so the clock still works (and says so on the serial monitor).
+ *
+ * Usage:
+ *   JsonArena arena;
+ *   arena.begin(JSON_ARENA_BYTES);
+ *   JsonDocument doc(&arena);
+ *   doc.clear();
+ *   arena.reset();          // nothing may point into the arena any more
+ *   deserializeJson(doc, input);
+ */
+
+#ifndef JSON_ARENA_H
+#define JSON_ARENA_H
+
+#include <ArduinoJson.h>
+
+class JsonArena : public ArduinoJson::Allocator {
+ public:
+  // Take the region (PSRAM first). False if neither heap has `bytes`.
+  bool begin(size_t bytes);
+
+  // Forget every block handed out, in O(1)
+  void reset();
+
+  void* allocate(size_t size) override;
+  void deallocate(void* block) override;
+  void* reallocate(void* block, size_t size) override;
+
+  size_t capacity() const { return size; }
+  size_t highWater() const { return peak; } // Most bytes in use after a reset
+  uint32_t failures() const { return failed; } // Requests that did not fit
+  bool inPsram() const { return psram; }
+
+ private:
+  // Size of the block at `offset` (stored just in front of it)
+  size_t blockSize(size_t offset) const;
+
+  uint8_t* region = nullptr;
+  size_t size = 0;
+  size_t used = 0;
+  size_t last = 0;   // Offset of the most recent block; 0 if none
+  size_t peak = 0;
+  uint32_t failed = 0;
+  bool psram = false;
+};
+
+#endif // JSON_ARENA_H
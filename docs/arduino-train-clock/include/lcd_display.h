@@ -0,0 +1,37 @@
+/**
+ * HD44780 Character LCD Display for Metro-North Railroad Train Clock
+ *
+ * Draws the board on a 16x2 / 20x4 character LCD behind a PCF8574 I2C
+ * backpack (the LiquidCrystal_I2C library). Every character goes through
+ * the I/O expander as two 4-bit halves, several I2C writes each, so a full
+ * 20x4 redraw takes tens of milliseconds and blanks the panel visibly.
+ * Here the panel is cleared once at start-up and then only changed cells
+ * are written.
+ *
+ * Settings (config.h): LCD_I2C_ADDRESS, LCD_COLUMNS, LCD_ROWS.
+ */
+
+#ifndef LCD_DISPLAY_H
+#define LCD_DISPLAY_H
+
+#include <LiquidCrystal_I2C.h>
+#include "grid_display.h"
+
+class Hd44780Display : public GridDisplay {
+ public:
+  Hd44780Display(uint8_t address, uint8_t columns, uint8_t rows);
+
+  bool begin() override;
+
+ protected:
+  void drawRun(uint8_t column, uint8_t row, const char* text,
+               uint8_t length) override;
+
+ private:
+  LiquidCrystal_I2C lcd;
+  uint8_t address;
+  uint8_t columns;
+  uint8_t rows;
+};
+
+#endif // LCD_DISPLAY_H
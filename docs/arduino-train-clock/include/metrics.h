@@ -0,0 +1,76 @@
+/**
+ * Runtime Metrics for Metro-North Railroad Train Clock
+ *
+ * Always-on timing of each phase of a fetch and of drawing, so a slow clock
+ * can be diagnosed in the field: DNS lookup, TCP connect, TLS handshake,
+ * time to first byte, waiting for the body, parsing and rendering. Every
+ * sample goes into a histogram of its phase (four buckets per power of
+ * two, so percentiles are within about 20%), giving count, min, average,
+ * p95, max and the last value since boot.
+ *
+ * Alongside them: free heap, largest free block, minimum free heap ever,
+ * WiFi RSSI, and counts of WiFi connects, HTTP connections opened and
+ * failed fetches.
+ *
+ * Recording takes a few microseconds (two micros() calls and a short
+ * critical section), cheap enough to leave on. Samples can be recorded
+ * from either task.
+ *
+ * Usage:
+ *   { PhaseTimer timer(PHASE_PARSE); decoder.decode(...); }
+ *   countEvent(COUNTER_FETCH_FAILURES);
+ *   printMetrics(Serial);          // "metrics" serial command
+ *   writeMetricsText(client);      // GET /metrics (see metrics_server.h)
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <Arduino.h>
+
+enum MetricPhase : uint8_t {
+  PHASE_DNS,
+  PHASE_CONNECT,     // TCP connect (http://)
+  PHASE_TLS,         // TCP connect and TLS handshake (https://)
+  PHASE_FIRST_BYTE,  // Request sent until the status line arrived
+  PHASE_BODY,        // Waiting for body bytes while parsing
+  PHASE_PARSE,       // Decoding the body, without the waits above
+  PHASE_RENDER,      // Drawing a board or a countdown change
+  PHASE_COUNT
+};
+
+enum MetricCounter : uint8_t {
+  COUNTER_WIFI_CONNECTS,
+  COUNTER_HTTP_CONNECTS,
+  COUNTER_FETCH_FAILURES,
+  COUNTER_COUNT
+};
+
+// Add one duration sample to a phase's histogram
+void recordPhase(MetricPhase phase, uint32_t micros);
+
+void countEvent(MetricCounter counter);
+
+// Forget every sample and count (the "metrics reset" serial command)
+void resetMetrics();
+
+// Human-readable table, for the serial monitor
+void printMetrics(Print& out);
+
+// Prometheus text exposition format, for GET /metrics
+void writeMetricsText(Print& out);
+
+/**
+ * Records the time from construction to destruction as one sample
+ */
+class PhaseTimer {
+ public:
+  explicit PhaseTimer(MetricPhase phase) : phase(phase), start(micros()) {}
+  ~PhaseTimer() { recordPhase(phase, micros() - start); }
+
+ private:
+  MetricPhase phase;
+  unsigned long start;
+};
+
+#endif // METRICS_H
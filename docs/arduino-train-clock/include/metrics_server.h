@@ -0,0 +1,35 @@
+/**
+ * Metrics HTTP Endpoint for Metro-North Railroad Train Clock
+ *
+ * Optional tiny HTTP server on METRICS_PORT answering GET /metrics with
+ * the metrics in Prometheus text format (see metrics.h), so a fleet of
+ * clocks can be scraped. One connection is served at a time, from the
+ * network task's loop, and closed after the reply. Not reachable while
+ * the SoC is in light sleep (POWER_MODE 2).
+ *
+ * Usage:
+ *   MetricsServer metricsServer;
+ *   metricsServer.begin(METRICS_PORT);   // once WiFi is up; 0 = off
+ *   metricsServer.poll();                // every network task tick
+ */
+
+#ifndef METRICS_SERVER_H
+#define METRICS_SERVER_H
+
+#include <WiFi.h>
+
+class MetricsServer {
+ public:
+  // Start listening; port 0 leaves the server off. Safe to call again.
+  void begin(uint16_t port);
+
+  // Serve a waiting request, if any (waits at most a fraction of a second
+  // for a slow client)
+  void poll();
+
+ private:
+  WiFiServer server;
+  bool listening = false;
+};
+
+#endif // METRICS_SERVER_H
@@ -0,0 +1,65 @@
+/**
+ * Adaptive Poll Scheduler for Metro-North Railroad Train Clock
+ *
+ * Decides when the next fetch happens instead of polling at a fixed rate:
+ *   - faster while a departure is a few minutes away or a train is delayed,
+ *     since that is when the board changes
+ *   - slower when the board is empty or the next departure is far off
+ *     (overnight), waking up again ahead of that departure
+ *   - never sooner than the server's Cache-Control max-age, and exactly
+ *     when its Retry-After says after a 429 / 503
+ *   - exponential backoff after failed fetches
+ * Every interval is jittered, so clocks powered on together drift apart
+ * instead of hitting the server in lockstep.
+ *
+ * Usage (from the network task):
+ *   poller.begin();
+ *   for (;;) {
+ *     if (poller.due()) {
+ *       ...fetch...
+ *       ok ? poller.succeeded(board, api.maxAge())
+ *          : poller.failed(api.retryAfter());
+ *     }
+ *   }
+ */
+
+#ifndef POLL_SCHEDULER_H
+#define POLL_SCHEDULER_H
+
+#include <Arduino.h>
+#include "train_table.h"
+
+class PollScheduler {
+ public:
+  // Schedule the first poll, a small random moment from now
+  void begin();
+
+  // True once the next poll is due
+  bool due() const;
+
+  // A fetch went through (new board or 304). `board` is the board now held;
+  // maxAgeSeconds is the response's Cache-Control max-age, or -1.
+  void succeeded(const TrainTable& board, long maxAgeSeconds);
+
+  // A fetch failed. retryAfterSeconds is the response's Retry-After, or -1.
+  void failed(long retryAfterSeconds);
+
+  // Time until the next poll, and why it was chosen (for logging)
+  unsigned long remainingMs() const;
+  const char* reason() const { return why; }
+
+  // Current failure backoff (0 after a success), kept across resets by
+  // retained_state.h. A restored backoff applies to the next failure and
+  // stretches the first poll after boot.
+  unsigned long backoff() const { return backoffMs; }
+  void restoreBackoff(unsigned long ms);
+
+ private:
+  void scheduleIn(unsigned long intervalMs, const char* reason);
+
+  unsigned long nextPollMs = 0;
+  unsigned long backoffMs = 0; // 0 while fetches succeed
+  const char* why = "startup";
+};
+
+#endif // POLL_SCHEDULER_H
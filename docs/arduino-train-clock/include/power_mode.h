@@ -0,0 +1,47 @@
+/**
+ * Low-power Modes for Metro-North Railroad Train Clock
+ *
+ * POWER_MODE in config.h selects how the clock idles between fetches:
+ *
+ *   POWER_ALWAYS_ON    radio and CPU fully awake (default; lowest latency)
+ *   POWER_MODEM_SLEEP  the radio sleeps between AP beacons while staying
+ *                      associated, and the CPU runs at 80 MHz
+ *   POWER_LIGHT_SLEEP  modem sleep, plus automatic light sleep: whenever
+ *                      every task is blocked (the network task in idleFor()
+ *                      until the next fetch or countdown tick), the power
+ *                      manager puts the SoC to sleep and the WiFi driver
+ *                      wakes it for each DTIM beacon, so the AP keeps the
+ *                      association however long the clock idles. RAM is
+ *                      kept, so nothing has to be reloaded on wake-up.
+ *
+ * Automatic light sleep needs an Arduino core built with CONFIG_PM_ENABLE
+ * and CONFIG_FREERTOS_USE_TICKLESS_IDLE, which the stock core is not:
+ * build POWER_MODE 2 with the arduino_nano_esp32_light_sleep env in
+ * platformio.ini (any other env stops with an #error). The render task
+ * blocks until a new board or the next countdown change, so nothing wakes
+ * the SoC in between but the fetch schedule and the radio's beacons.
+ *
+ * Light sleep suspends the USB serial port on the Nano ESP32, so use it for
+ * clocks running on battery with their own display, not while debugging
+ * over the serial monitor.
+ */
+
+#ifndef POWER_MODE_H
+#define POWER_MODE_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "config_defaults.h"
+
+#define POWER_ALWAYS_ON 0
+#define POWER_MODEM_SLEEP 1
+#define POWER_LIGHT_SLEEP 2
+
+// Apply POWER_MODE; call once WiFi is in station mode
+void beginPowerMode();
+
+// Idle the calling task for about `ms` (vTaskDelay). In POWER_LIGHT_SLEEP
+// the SoC sleeps through it whenever no other task has work.
+void idleFor(unsigned long ms);
+
+#endif // POWER_MODE_H
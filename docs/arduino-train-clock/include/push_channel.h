@@ -0,0 +1,72 @@
+/**
+ * Server Push Channel for Metro-North Railroad Train Clock
+ *
+ * Holds one long-lived Server-Sent Events connection to PUSH_ENDPOINT, so
+ * board changes (a track going from "TBD" to a number, a new delay) reach
+ * the clock seconds after the server has them, with no polling in between.
+ * Pushed events carry the same JSON as a poll: a full board or a delta
+ * against the previous version, so they are applied by the same decoder
+ * and delta logic.
+ *
+ * The stream is opened with ?since=<seq> of the board the clock holds; the
+ * server answers with the changes since then (or the full board if it no
+ * longer has that version), then one event per change. While the channel
+ * is open the clock does not poll. A stream that closes, stops sending
+ * (the server sends a heartbeat comment every 15 s) or fails to open is
+ * retried with exponential backoff, and polling takes over meanwhile.
+ *
+ * Usage (from the network task):
+ *   push.begin(PUSH_ENDPOINT);
+ *   if (!push.isOpen() && push.connectDue()) push.connect(board.seq);
+ *   if (push.next()) { ...decode push.event()...; push.event().finish(); }
+ */
+
+#ifndef PUSH_CHANNEL_H
+#define PUSH_CHANNEL_H
+
+#include "event_stream.h"
+#include "http_session.h"
+
+class PushChannel {
+ public:
+  // Set up the stream URL; false (the channel stays off) if it is empty
+  // or invalid
+  bool begin(const char* url);
+
+  // For request headers (e.g. an API key)
+  HttpSession& session() { return http; }
+
+  bool enabled() const { return configured; }
+  bool isOpen() const { return open; }
+
+  // True once a (re)connect attempt is due
+  bool connectDue() const;
+
+  // Open the stream for the changes since board `since` (0: the full
+  // board). On failure a retry is scheduled with backoff.
+  bool connect(uint32_t since);
+
+  // Start of the next pushed event, if one is arriving; its data is read
+  // from event(). Also notices a closed or silent stream and drops it.
+  bool next();
+
+  EventStream& event() { return events; }
+
+  // Drop the stream (lost WiFi, or a pushed event the clock cannot
+  // apply). The next connect() resyncs from the board then held, right
+  // away or, with backOff, after the retry backoff.
+  void close(bool backOff = false);
+
+ private:
+
+  HttpSession http;
+  EventStream events;
+  bool configured = false;
+  bool open = false;
+  unsigned long openedAtMs = 0;
+  unsigned long lastActivityMs = 0;
+  unsigned long retryAtMs = 0;
+  unsigned long backoffMs = 0;
+};
+
+#endif // PUSH_CHANNEL_H
@@ -0,0 +1,62 @@
+/**
+ * Request Query Builder for Metro-North Railroad Train Clock
+ *
+ * Composes the query string of a view's request in a fixed buffer: the
+ * view's own API_VIEWS entry, then the parameters the firmware derives from
+ * its configuration, so the server does the trimming instead of the clock:
+ *
+ *   fields=   the keys the clock stores (TRAIN_FIELD_KEYS), or only the
+ *             realtime ones while a timetable supplies the rest
+ *   limit=    the train rows the display has (Display::trainRows())
+ *   origin_station=, destination_station=
+ *             the board's station and the terminal it heads for, as
+ *             GTFS stop IDs (API_STATION, API_DESTINATION), applied to
+ *             every view
+ *
+ * A busy station at rush hour then costs the same few hundred bytes as a
+ * quiet one. Values are percent-encoded; a parameter that does not fit is
+ * left out whole rather than cut, so the server never sees half of one.
+ *
+ * Usage:
+ *   char query[QUERY_CAPACITY];
+ *   QueryBuilder builder(query, sizeof(query));
+ *   builder.append(apiViews[view]);
+ *   builder.add("fields", TRAIN_FIELD_KEYS);
+ *   builder.add("limit", display.trainRows());
+ *   if (!builder.complete()) ...something was left out
+ */
+
+#ifndef QUERY_BUILDER_H
+#define QUERY_BUILDER_H
+
+#include <stddef.h>
+
+class QueryBuilder {
+ public:
+  QueryBuilder(char* buffer, size_t size);
+
+  // Parameters already in query form ("route=Hudson%20Line&since=12")
+  void append(const char* query);
+
+  // key=value, with value percent-encoded; nothing for an empty value
+  void add(const char* key, const char* value);
+  void add(const char* key, unsigned long value);
+
+  // False if a parameter was left out for want of room
+  bool complete() const { return !overflowed; }
+
+  size_t length() const { return used; }
+
+ private:
+  bool put(char c);
+  bool put(const char* text);
+  void separate();
+  void commit(size_t start, bool fits);
+
+  char* buffer;
+  size_t size;
+  size_t used = 0;
+  bool overflowed = false;
+};
+
+#endif // QUERY_BUILDER_H
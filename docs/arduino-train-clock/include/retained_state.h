@@ -0,0 +1,30 @@
+/**
+ * RTC-retained State for Metro-North Railroad Train Clock
+ *
+ * Keeps a copy of the network task's board and the poll scheduler's
+ * backoff in RTC memory, which survives software resets, watchdog resets,
+ * panics and sleep (but not power loss). After such a reset the clock
+ * restarts with the board it had, so delta sync resumes instead of
+ * fetching the full board, and a crash loop keeps backing off instead of
+ * hitting the server at every boot.
+ *
+ * The copy carries a checksum; whatever RTC memory holds after a power-on
+ * fails it and is ignored.
+ *
+ * Usage:
+ *   restoreRetainedState(board, poller);     // once, at boot
+ *   saveRetainedState(board, poller);        // after every fetch
+ */
+
+#ifndef RETAINED_STATE_H
+#define RETAINED_STATE_H
+
+#include "poll_scheduler.h"
+#include "train_table.h"
+
+void saveRetainedState(const TrainTable& board, const PollScheduler& poller);
+
+// True if a valid copy was found and loaded into board and poller
+bool restoreRetainedState(TrainTable& board, PollScheduler& poller);
+
+#endif // RETAINED_STATE_H
@@ -0,0 +1,77 @@
+/**
+ * Flash Timetable for Metro-North Railroad Train Clock
+ *
+ * The static GTFS timetable of the clock's station, packed on the desktop
+ * by tools/pack_schedule.py and flashed to the "schedule" partition (see
+ * partitions.csv). The image is mapped into the address space once at boot
+ * and read in place, so it costs no RAM however many days it covers.
+ *
+ * Departures are sorted by time of day, and each names a service whose
+ * bitmap says which days it runs; a lookup is a binary search per service
+ * day plus a walk forward. With a timetable the clock builds its board
+ * itself: the server only has to send what it knows beyond the timetable
+ * (delays, tracks, status, see SCHEDULE_COMPACT_FETCH), which is laid
+ * over the scheduled trains with TrainTable::overlay(), and the board
+ * keeps moving on its own when the server is out of reach.
+ *
+ * An image that is missing or corrupt, a clock that is not synced yet, or
+ * a date outside the image's days leaves the clock on the server's board
+ * alone.
+ *
+ * Usage:
+ *   ScheduleIndex schedule;
+ *   schedule.begin();
+ *   if (schedule.ready(now)) schedule.departures(now, now, realtime, table);
+ */
+
+#ifndef SCHEDULE_INDEX_H
+#define SCHEDULE_INDEX_H
+
+#include "json_arena.h"
+#include "train_table.h"
+
+// What the server still has to send with a timetable in flash (the fields=
+// of a compact fetch): the rest of each train comes from the timetable
+#define SCHEDULE_REALTIME_FIELDS "trip_id,track,status,delay_seconds"
+
+struct ScheduleHeader;
+struct ScheduleDeparture;
+
+class ScheduleIndex {
+ public:
+  // Map the schedule partition and check its image. False (the clock
+  // carries on without a timetable) if there is none or it is corrupt.
+  bool begin();
+
+  // True if the timetable covers the local date of `now` (and the clock
+  // is synced, so there is a date)
+  bool ready(time_t now) const;
+
+  // Fill table with the first MAX_TRAINS departures from `from` on,
+  // sorted by time, status "Scheduled". Those leaving before `keepAfter`
+  // are only taken if realtime lists them (a delayed train is still to
+  // come). Returns the number of trains added.
+  uint8_t departures(time_t from, time_t keepAfter, const TrainTable& realtime,
+                     TrainTable& table);
+
+  const char* station() const;
+  time_t builtAt() const;
+  uint16_t dayCount() const;
+  uint32_t departureCount() const;
+
+ private:
+  const char* text(uint32_t offset) const;
+  bool runs(uint16_t service, int32_t day) const;
+
+  // First departure at or after `seconds` into the service day
+  uint32_t lowerBound(int32_t seconds) const;
+
+  const uint8_t* image = nullptr;
+  const ScheduleHeader* header = nullptr;
+  const ScheduleDeparture* rows = nullptr;
+
+  JsonArena arena;                // One scheduled train at a time
+  JsonDocument row{&arena};
+};
+
+#endif // SCHEDULE_INDEX_H
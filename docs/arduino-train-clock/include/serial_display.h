@@ -0,0 +1,35 @@
+/**
+ * Serial Monitor Display for Metro-North Railroad Train Clock
+ *
+ * The default backend: each board as a column of boxed trains, composed in
+ * a FrameRenderer and written to the serial port at once. The serial
+ * monitor only scrolls, so instead of diffing cells this backend prints
+ * just the trains that changed when a board lists the same trips as the
+ * one before, and a compact list of countdowns when one of them moves.
+ */
+
+#ifndef SERIAL_DISPLAY_H
+#define SERIAL_DISPLAY_H
+
+#include "display.h"
+#include "frame_renderer.h"
+
+class SerialDisplay : public Display {
+ public:
+  explicit SerialDisplay(Print& out) : frame(out) {}
+
+  bool begin() override { return true; }
+  void drawBoard(const TrainTable& table, const TrainTable* previous) override;
+  void tick(const TrainTable& table, bool countdownsMoved) override;
+
+ private:
+  void drawAll(const TrainTable& table);
+  void drawChanged(const TrainTable& table, const TrainTable& previous);
+  void drawCountdowns(const TrainTable& table);
+  void drawTrainBox(const TrainTable& table, uint8_t index);
+  void drawFooter(const TrainTable& table);
+
+  FrameRenderer frame;
+};
+
+#endif // SERIAL_DISPLAY_H
@@ -0,0 +1,38 @@
+/**
+ * Server Discovery for Metro-North Railroad Train Clock
+ *
+ * With SERVICE_DISCOVERY 1 the clock finds its server on the LAN by DNS-SD
+ * over mDNS instead of relying on the API_ENDPOINT it was flashed with:
+ * the server advertises _mnr-trains._tcp (example_web_server.py and
+ * mock_train_server.py do, with the zeroconf package), with its API path
+ * in the TXT record "path" (default /api/trains).
+ *
+ * Browsing takes a few seconds, so it runs once per boot, and the endpoint
+ * found is saved to NVS: the next boot polls that server right away, and
+ * the browse only changes it if the server has moved. API_ENDPOINT stays
+ * the fallback for as long as nothing has been found.
+ *
+ * Usage:
+ *   char url[160];
+ *   if (loadDiscoveredEndpoint(url, sizeof(url))) api.begin(url);   // boot
+ *   if (discoverEndpoint(url, sizeof(url))) api.begin(url);         // online
+ */
+
+#ifndef SERVICE_DISCOVERY_H
+#define SERVICE_DISCOVERY_H
+
+#include <stddef.h>
+
+// DNS-SD service type the server advertises (without the leading '_')
+#define DISCOVERY_SERVICE "mnr-trains"
+#define DISCOVERY_PROTOCOL "tcp"
+
+// The endpoint found at an earlier boot; false if there is none
+bool loadDiscoveredEndpoint(char* url, size_t size);
+
+// Browse for the service (blocks for a few seconds). On an answer, fill
+// url with http://<address>:<port><path>, save it for the next boot and
+// return true.
+bool discoverEndpoint(char* url, size_t size);
+
+#endif // SERVICE_DISCOVERY_H
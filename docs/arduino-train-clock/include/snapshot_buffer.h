@@ -0,0 +1,69 @@
+/**
+ * Lock-free Snapshot Handoff for Metro-North Railroad Train Clock
+ *
+ * Single-producer / single-consumer triple buffer. The network task fills
+ * the back buffer with write() and hands it over with publish(); the render
+ * task picks up the newest published snapshot with acquire() and reads it
+ * via front(). Neither side ever blocks or waits for the other: the producer
+ * always has a free buffer to write into, and the consumer keeps a stable
+ * copy for as long as it needs it. Intermediate snapshots the consumer never
+ * got to are simply overwritten.
+ *
+ * Usage:
+ *   SnapshotBuffer<TrainTable> snapshots;
+ *
+ *   // Producer (network task)
+ *   TrainTable& next = snapshots.write();
+ *   ...fill next...
+ *   snapshots.publish();
+ *
+ *   // Consumer (render task)
+ *   if (snapshots.acquire()) render(snapshots.front());
+ */
+
+#ifndef SNAPSHOT_BUFFER_H
+#define SNAPSHOT_BUFFER_H
+
+#include <atomic>
+#include <stdint.h>
+
+template <typename T>
+class SnapshotBuffer {
+ public:
+  // Producer: buffer to fill. Stays owned by the producer until publish().
+  T& write() { return slots[back]; }
+
+  // Producer: make the buffer returned by write() the newest snapshot
+  void publish() {
+    uint8_t previous = middle.exchange(back | FRESH, std::memory_order_acq_rel);
+    back = previous & INDEX_MASK;
+  }
+
+  // Producer: true while the last publish() has not been picked up yet
+  bool pending() const {
+    return (middle.load(std::memory_order_relaxed) & FRESH) != 0;
+  }
+
+  // Consumer: switch front() to the newest snapshot, if one was published
+  // since the last call. Returns false when there is nothing new.
+  bool acquire() {
+    if ((middle.load(std::memory_order_relaxed) & FRESH) == 0) return false;
+    uint8_t previous = middle.exchange(frontIndex, std::memory_order_acq_rel);
+    frontIndex = previous & INDEX_MASK;
+    return true;
+  }
+
+  // Consumer: the snapshot selected by the last successful acquire()
+  const T& front() const { return slots[frontIndex]; }
+
+ private:
+  static const uint8_t INDEX_MASK = 0x03;
+  static const uint8_t FRESH = 0x04;
+
+  T slots[3];
+  uint8_t back = 0;                  // Producer-owned
+  uint8_t frontIndex = 1;            // Consumer-owned
+  std::atomic<uint8_t> middle{2};    // Shared: index | FRESH
+};
+
+#endif // SNAPSHOT_BUFFER_H
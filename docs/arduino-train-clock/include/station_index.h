@@ -0,0 +1,118 @@
+/**
+ * Station Index for Metro-North Railroad Train Clock
+ *
+ * The server's station list (GET /stations) kept in a LittleFS file,
+ * sorted by name, for pickers that scroll through stations with buttons.
+ * The file holds fixed-width records (string offsets) followed by one
+ * blob of NUL-terminated strings, and is read through a small page cache:
+ * browsing the list costs a few hundred bytes of RAM however long it is,
+ * instead of three heap Strings per station.
+ *
+ * The list survives power cycles. refresh() sends the ETag it was built
+ * from, so the server answers 304 Not Modified until its stations change,
+ * and only then is the file rebuilt (in a temporary file, swapped in once
+ * complete, so a failed download keeps the old list).
+ *
+ * Usage:
+ *   StationIndex stations;
+ *   stations.begin();                       // mount, open the saved list
+ *   stations.refresh(stationsApi);          // HttpSession on /stations
+ *   uint16_t i = stations.lowerBound("Ha"); // first name from "Ha" on
+ *   StationEntry entry;
+ *   if (stations.read(i, entry)) lcd.print(entry.name);
+ */
+
+#ifndef STATION_INDEX_H
+#define STATION_INDEX_H
+
+#include <FS.h>
+#include "http_session.h"
+
+/**
+ * One station as read from the index (longer strings are truncated)
+ */
+struct StationEntry {
+  char id[16];
+  char name[48];
+  char code[8];
+};
+
+// Outcome of StationIndex::refresh()
+enum StationRefresh {
+  STATIONS_UPDATED,   // New list downloaded and saved
+  STATIONS_CURRENT,   // 304 Not Modified: the saved list is the server's
+  STATIONS_FAILED,    // Request or parsing failed; the saved list is kept
+};
+
+/**
+ * Read-through cache of a file in fixed pages, least recently used out
+ */
+class PageCache {
+ public:
+  static const size_t PAGE_SIZE = 128;
+  static const uint8_t PAGE_COUNT = 4;
+
+  // Cache `file` (kept open by the caller); drops what was cached
+  void attach(File* file);
+
+  // Copy length bytes at offset into out; false past the end of the file
+  bool read(uint32_t offset, void* out, size_t length);
+
+  // Copy the NUL-terminated string at offset (truncated to size - 1)
+  bool readString(uint32_t offset, char* out, size_t size);
+
+ private:
+  struct Page {
+    uint32_t number = UINT32_MAX;
+    uint32_t lastUse = 0;
+    uint16_t length = 0;
+    uint8_t data[PAGE_SIZE];
+  };
+
+  const Page* load(uint32_t number);
+
+  File* file = nullptr;
+  Page pages[PAGE_COUNT];
+  uint32_t uses = 0;
+};
+
+class StationIndex {
+ public:
+  // Mount LittleFS (formatting a blank partition) and open the saved
+  // list. False if there is none yet, or it is corrupt; refresh() makes one.
+  bool begin();
+
+  // Conditional GET on `session` (begun on the server's /stations URL),
+  // rebuilding the list if the server sends a new one
+  StationRefresh refresh(HttpSession& session);
+
+  // Stations in the list, 0 until one has been downloaded
+  uint16_t size() const { return count; }
+
+  // Station at `index` in name order; false if out of range
+  bool read(uint16_t index, StationEntry& out);
+
+  // Index of the first station whose name is not before `name` (ignoring
+  // case); size() if there is none. With a prefix, the stations that start
+  // with it follow from there on, while hasPrefix() holds.
+  uint16_t lowerBound(const char* name);
+
+  // True if the name of the station at `index` starts with `prefix`
+  bool hasPrefix(uint16_t index, const char* prefix);
+
+  // Index of the station with this stop_id, or -1
+  int find(const char* stopId);
+
+ private:
+  bool open();
+  bool rebuild(Stream& input, const HttpValidators& validators);
+  bool readName(uint16_t index, char* out, size_t size);
+
+  File file;
+  PageCache cache;
+  uint16_t count = 0;
+  uint32_t stringsOffset = 0;
+  HttpValidators validators; // Of the response the list was built from
+};
+
+#endif // STATION_INDEX_H
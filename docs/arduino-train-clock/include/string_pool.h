@@ -0,0 +1,55 @@
+/**
+ * String Intern Pool for Metro-North Railroad Train Clock
+ *
+ * Fixed-size pool for the small set of strings that repeat across a board
+ * (route names, destinations, statuses). Each distinct string is stored
+ * once and referred to by a one-byte StringId, so a board of 20 trains to
+ * "Grand Central Terminal" holds that name once, and filling the pool never
+ * touches the heap.
+ */
+
+#ifndef STRING_POOL_H
+#define STRING_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Capacity of one pool (characters including terminators, and strings)
+#define STRING_POOL_BYTES 1024
+#define STRING_POOL_MAX_STRINGS 64
+
+typedef uint8_t StringId;
+
+class StringPool {
+ public:
+  // Id of the empty string. Also returned when the pool is full.
+  static const StringId EMPTY = 0;
+
+  StringPool() { clear(); }
+
+  // Forget every string (ids handed out before are invalid afterwards)
+  void clear();
+
+  // Id of `text`, adding it if it is not in the pool yet
+  StringId intern(const char* text);
+
+  const char* get(StringId id) const {
+    return id < count ? data + offsets[id] : data;
+  }
+
+  uint8_t size() const { return count; }
+  size_t bytesUsed() const { return used; }
+
+  // True once intern() has turned a string away for lack of room (since
+  // clear())
+  bool overflowed() const { return overflow; }
+
+ private:
+  char data[STRING_POOL_BYTES];
+  uint16_t offsets[STRING_POOL_MAX_STRINGS];
+  uint8_t count;
+  uint16_t used;
+  bool overflow;
+};
+
+#endif // STRING_POOL_H
@@ -0,0 +1,47 @@
+/**
+ * SPI TFT / OLED Display for Metro-North Railroad Train Clock
+ *
+ * Draws the board as a text grid on any SPI panel TFT_eSPI drives (ST7789,
+ * ILI9341, ST7735 TFTs, SSD1351 colour OLEDs...). The panel, its pins and
+ * its SPI clock are set in TFT_eSPI's setup (build flags in platformio.ini).
+ *
+ * Each run of changed cells is rendered into a row-high framebuffer, copied
+ * out as one rectangle and sent with DMA, so the CPU is already rendering
+ * the next rectangle while the previous one is on the bus. Two DMA buffers
+ * take turns; TFT_eSPI waits for a transfer to finish before it starts the
+ * next one, so a buffer is never overwritten while it is being sent.
+ *
+ * Settings (config.h): TFT_TEXT_SIZE (1 = 6x8 pixel cells, 2 = 12x16...),
+ * TFT_ROTATION.
+ */
+
+#ifndef TFT_DISPLAY_H
+#define TFT_DISPLAY_H
+
+#include <TFT_eSPI.h>
+#include "grid_display.h"
+
+class TftDisplay : public GridDisplay {
+ public:
+  TftDisplay(uint8_t textSize, uint8_t rotation);
+
+  bool begin() override;
+
+ protected:
+  void drawRun(uint8_t column, uint8_t row, const char* text,
+               uint8_t length) override;
+  void endFrame() override;
+
+ private:
+  TFT_eSPI tft;
+  TFT_eSprite band;          // One text row, full width
+  uint16_t* dmaBuffers[2] = { nullptr, nullptr };
+  uint8_t nextBuffer = 0;
+  uint16_t cellWidth;
+  uint16_t cellHeight;
+  uint8_t textSize;
+  uint8_t rotation;
+  bool writing = false;      // Inside startWrite() for this frame
+};
+
+#endif // TFT_DISPLAY_H
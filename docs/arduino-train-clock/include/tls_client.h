@@ -0,0 +1,113 @@
+/**
+ * TLS Client for Metro-North Railroad Train Clock
+ *
+ * A Client for https:// endpoints on mbedTLS that keeps the session of its
+ * last handshake. Servers usually close an idle keep-alive connection
+ * between polls, so most fetches open a new one; offering the saved
+ * session (a session ticket, or a session ID the server remembers) turns
+ * the full handshake, an ECDHE key exchange plus certificate checks and
+ * two round trips, into an abbreviated one of a single round trip and some
+ * hashing. The session lives in RAM, so it survives light sleep and WiFi
+ * reconnects; the server decides how long it stays valid, and falls back
+ * to a full handshake once it has expired.
+ *
+ * Server checks:
+ *   setInsecure()      encrypt, but accept any certificate (the default,
+ *                      like HTTPClient's)
+ *   setCACert(pem)     the chain has to lead to this one root or
+ *                      intermediate CA: no certificate bundle is loaded
+ *   setFingerprint(h)  the server's own certificate has to have this
+ *                      SHA-256 fingerprint; no CA is parsed at all, and
+ *                      the check does not depend on the clock's time
+ *
+ * Before SNTP has synced, certificate dates are not checked (the clock
+ * would think every certificate is not valid yet).
+ *
+ * Usage:
+ *   TlsClient tls;
+ *   tls.setFingerprint("AB:CD:...");
+ *   if (tls.connect(address, 443, "trains.example.com", 10000)) { ... }
+ *   tls.stop();   // The session is kept for the next connect()
+ */
+
+#ifndef TLS_CLIENT_H
+#define TLS_CLIENT_H
+
+#include <Arduino.h>
+#include <Client.h>
+#include <IPAddress.h>
+#include <mbedtls/ctr_drbg.h>
+#include <mbedtls/entropy.h>
+#include <mbedtls/ssl.h>
+#include <mbedtls/x509_crt.h>
+
+class TlsClient : public Client {
+ public:
+  TlsClient();
+  ~TlsClient();
+
+  // Check the server against one CA certificate (PEM, kept by the
+  // caller). False if it does not parse.
+  bool setCACert(const char* pem);
+
+  // Check the server's certificate against its SHA-256 fingerprint, 64 hex
+  // digits, optionally separated by ':' or ' '. False if malformed.
+  bool setFingerprint(const char* sha256);
+
+  // Accept any certificate
+  void setInsecure();
+
+  // Connect to `address` and handshake as `host` (for SNI and the
+  // certificate's name), all within timeoutMs. 1 on success.
+  int connect(IPAddress address, uint16_t port, const char* host, int32_t timeoutMs);
+  int connect(const char* host, uint16_t port, int32_t timeoutMs);
+  int connect(IPAddress address, uint16_t port) override;
+  int connect(const char* host, uint16_t port) override;
+
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t* buffer, size_t size) override;
+  int available() override;
+  int read() override;
+  int read(uint8_t* buffer, size_t size) override;
+  int peek() override;
+  void flush() override {}
+  void stop() override;
+  uint8_t connected() override;
+  operator bool() override { return connected(); }
+
+  // Drop the saved session, so the next connect() does a full handshake
+  void forgetSession();
+
+  using Print::write;
+
+ private:
+  enum TrustMode { TRUST_ANY, TRUST_CA, TRUST_FINGERPRINT };
+
+  bool prepare();
+  bool waitFor(bool writable, unsigned long start, unsigned long limitMs);
+  static int verifyCertificate(void* context, mbedtls_x509_crt* certificate,
+                               int depth, uint32_t* flags);
+
+  mbedtls_entropy_context entropy;
+  mbedtls_ctr_drbg_context random;
+  mbedtls_ssl_config config;
+  mbedtls_x509_crt ca;            // Parsed CA, or empty for fingerprints
+  mbedtls_ssl_context ssl;
+  mbedtls_ssl_session session;    // Of the last full or resumed handshake
+
+  TrustMode trust = TRUST_ANY;
+  uint8_t fingerprint[32];
+  bool seeded = false;
+  bool prepared = false;          // config is set up for `trust`
+  bool hasSession = false;
+  char sessionHost[64] = "";      // Server the session belongs to
+  uint16_t sessionPort = 0;
+
+  int fd = -1;
+  bool active = false;            // ssl is set up on fd
+  bool peerClosed = false;
+  int peeked = -1;
+  unsigned long timeoutMs = 10000;
+};
+
+#endif // TLS_CLIENT_H
@@ -0,0 +1,88 @@
+/**
+ * Streaming Train Decoder for Metro-North Railroad Train Clock
+ *
+ * Decodes a { "trains": [ {...}, ... ] } response body, in JSON or
+ * MessagePack, straight into a TrainTable. The top level of the document is
+ * walked by a small scanner; only one train object at a time is handed to
+ * ArduinoJson (through the TRAIN_FIELDS filter) and copied into the table.
+ * Memory use is therefore bounded by a single filtered train, however many
+ * trains or extra top-level keys the server sends, and that train lives in
+ * a JsonArena (json_arena.h) that is reset before every record, so decoding
+ * does not allocate from the heap at all.
+ *
+ * Two body shapes are understood:
+ *   full   { "seq": 42, "trains": [ {...}, ... ] }
+ *   delta  { "seq": 43, "base": 42, "upserts": [ {...} ], "removes": ["id"] }
+ * A full body replaces the table; a delta patches it and is only valid if
+ * the table held board `base` beforehand, which the caller checks.
+ *
+ * Usage:
+ *   TrainDecoder decoder;
+ *   decoder.begin(JSON_ARENA_BYTES);
+ *   table.clear();
+ *   DeserializationError error = decoder.decode(body, PAYLOAD_JSON, table);
+ */
+
+#ifndef TRAIN_DECODER_H
+#define TRAIN_DECODER_H
+
+#include <Arduino.h>
+#include "json_arena.h"
+#include "train_table.h"
+
+enum PayloadFormat {
+  PAYLOAD_JSON,
+  PAYLOAD_MSGPACK,
+};
+
+class TrainDecoder {
+ public:
+  // Build the per-train filter from TRAIN_FIELDS and take the arena's
+  // region. False if the region could not be had (records then use the
+  // heap).
+  bool begin(size_t arenaBytes);
+
+  // Decode input into table, which holds the board a delta applies to.
+  // On error the table is left partly updated: it has every train record
+  // decoded before the error, but none of a record cut off part way.
+  DeserializationError decode(Stream& input, PayloadFormat format,
+                              TrainTable& table);
+
+  // Train records the last decode() kept in the table (not those dropped
+  // as later than a full table's), also when it failed part way
+  uint16_t recordCount() const { return records; }
+
+  // After decode(): true if the body was a delta, and the board version
+  // it was computed against
+  bool isDelta() const { return delta; }
+  uint32_t deltaBase() const { return base; }
+
+  const JsonArena& recordArena() const { return arena; }
+
+ private:
+  DeserializationError decodeJson(Stream& input, TrainTable& table);
+  DeserializationError decodeJsonTrains(Stream& input, TrainTable& table,
+                                        bool replace);
+  DeserializationError decodeJsonRemoves(Stream& input, TrainTable& table);
+  DeserializationError decodeMsgPack(Stream& input, TrainTable& table);
+  DeserializationError decodeMsgPackTrains(Stream& input, TrainTable& table,
+                                           bool replace);
+  DeserializationError decodeMsgPackRemoves(Stream& input, TrainTable& table);
+
+  // Called for each array that carries trains
+  void beginTrains(TrainTable& table, bool replace);
+
+  // Called before each train record is parsed
+  void beginRecord();
+
+  JsonDocument filter;         // Built once, on the heap
+  JsonArena arena;
+  JsonDocument record{&arena}; // Reused for every train
+
+  uint32_t seq = 0;
+  uint32_t base = 0;
+  uint16_t records = 0;
+  bool delta = false;
+};
+
+#endif // TRAIN_DECODER_H
@@ -0,0 +1,160 @@
+/**
+ * Train Field Schema for Metro-North Railroad Train Clock
+ *
+ * Single compile-time list of the per-train fields the display reads.
+ * The list drives the ArduinoJson filter used while parsing (so any key not
+ * listed here is skipped without being allocated), the layout of the Train
+ * struct in the train table, and the code that fills it.
+ *
+ * Each field has a storage kind, which also knows how to compare two values,
+ * whether a value is just the fallback (the key was missing), and how to
+ * move a value into another table's pool:
+ *   InlineText<N>  copied into a char[N] (truncated if longer)
+ *   InternedText   stored once in the table's StringPool, one-byte id
+ *   LocalTime      "HH:MM[:SS]" local time, stored as epoch seconds of
+ *                  the nearest such time (see wall_clock.h)
+ *   Int32          plain number
+ *
+ * To display a new field, add one line to TRAIN_FIELDS:
+ *   X(<json key>, <storage kind>, <fallback value>)
+ *
+ * trip_id identifies a train across delta updates (see train_table.h) and
+ * has to stay an InlineText field.
+ */
+
+#ifndef TRAIN_SCHEMA_H
+#define TRAIN_SCHEMA_H
+
+#include <ArduinoJson.h>
+#include <stdio.h>
+#include <string.h>
+#include "string_pool.h"
+#include "wall_clock.h"
+
+#define TRAIN_FIELDS(X)                              \
+  X(trip_id,       InlineText<16>, "N/A")            \
+  X(route,         InternedText,   "Unknown Route")  \
+  X(destination,   InternedText,   "Unknown")        \
+  X(track,         InlineText<6>,  "TBD")            \
+  X(arrival_time,  LocalTime,      "N/A")            \
+  X(status,        InternedText,   "Unknown")        \
+  X(delay_seconds, Int32,          0)
+
+template <size_t N>
+struct InlineText {
+  typedef char Storage[N];
+
+  static void load(Storage& out, JsonVariantConst value, const char* fallback,
+                   StringPool&) {
+    strncpy(out, value | fallback, N - 1);
+    out[N - 1] = '\0';
+  }
+
+  static bool equal(const Storage& a, const StringPool&, const Storage& b,
+                    const StringPool&) {
+    return strcmp(a, b) == 0;
+  }
+
+  static bool isFallback(const Storage& value, const StringPool&,
+                         const char* fallback) {
+    return strcmp(value, fallback) == 0;
+  }
+
+  static void rehome(Storage&, const StringPool&, StringPool&) {}
+};
+
+struct InternedText {
+  typedef StringId Storage;
+
+  static void load(Storage& out, JsonVariantConst value, const char* fallback,
+                   StringPool& strings) {
+    out = strings.intern(value | fallback);
+  }
+
+  static bool equal(Storage a, const StringPool& aStrings, Storage b,
+                    const StringPool& bStrings) {
+    return strcmp(aStrings.get(a), bStrings.get(b)) == 0;
+  }
+
+  static bool isFallback(Storage value, const StringPool& strings,
+                         const char* fallback) {
+    return strcmp(strings.get(value), fallback) == 0;
+  }
+
+  static void rehome(Storage& value, const StringPool& from, StringPool& to) {
+    value = to.intern(from.get(value));
+  }
+};
+
+/**
+ * "HH:MM" or "HH:MM:SS" to seconds after midnight, or -1 if unparsable
+ */
+inline int32_t parseClockTime(const char* text) {
+  int hours, minutes, seconds = 0;
+  int fields = sscanf(text, "%d:%d:%d", &hours, &minutes, &seconds);
+
+  // GTFS allows hours past 24 for trips running after midnight
+  if (fields < 2 || hours < 0 || hours > 47 || minutes < 0 || minutes > 59 ||
+      seconds < 0 || seconds > 59) {
+    return -1;
+  }
+  return hours * 3600 + minutes * 60 + seconds;
+}
+
+struct LocalTime {
+  typedef time_t Storage;
+
+  static void load(Storage& out, JsonVariantConst value, const char*,
+                   StringPool&) {
+    out = localTimeNear(parseClockTime(value | ""));
+  }
+
+  static bool equal(Storage a, const StringPool&, Storage b, const StringPool&) {
+    return a == b;
+  }
+
+  static bool isFallback(Storage value, const StringPool&, const char*) {
+    return value == TIME_UNKNOWN;
+  }
+
+  static void rehome(Storage&, const StringPool&, StringPool&) {}
+};
+
+struct Int32 {
+  typedef int32_t Storage;
+
+  static void load(Storage& out, JsonVariantConst value, int32_t fallback,
+                   StringPool&) {
+    out = value | fallback;
+  }
+
+  static bool equal(Storage a, const StringPool&, Storage b, const StringPool&) {
+    return a == b;
+  }
+
+  static bool isFallback(Storage value, const StringPool&, int32_t fallback) {
+    return value == fallback;
+  }
+
+  static void rehome(Storage&, const StringPool&, StringPool&) {}
+};
+
+/**
+ * Build the deserialization filter for one train object
+ *
+ * Only the schema fields are kept; everything else the server sends
+ * (stops, route colors, vehicle info...) is skipped while parsing.
+ */
+inline void buildTrainFilter(JsonDocument& filter) {
+#define X(key, kind, fallback) filter[#key] = true;
+  TRAIN_FIELDS(X)
+#undef X
+}
+
+// The schema's keys, comma-separated ("trip_id,route,..."), for asking the
+// server to leave out everything else (fields=; see query_builder.h)
+#define X(key, kind, fallback) "," #key
+static const char* const TRAIN_FIELD_KEYS = TRAIN_FIELDS(X) + 1;
+#undef X
+
+#endif // TRAIN_SCHEMA_H
@@ -0,0 +1,138 @@
+/**
+ * Train Table for Metro-North Railroad Train Clock
+ *
+ * Fixed-capacity, heap-free representation of one board. Trains are plain
+ * structs laid out from TRAIN_FIELDS (see train_schema.h): epoch times
+ * and numeric delays, short inline strings, and one-byte ids into the table's
+ * StringPool for the strings that repeat across a board.
+ *
+ * The decoders in train_decoder.h fill a table in place, one train at a
+ * time, so a table is the only copy of the data after a fetch. Tables are
+ * handed from the network task to the render task through a
+ * SnapshotBuffer, and can be copied with memcpy.
+ *
+ * A table can also be patched in place from a delta response: trains are
+ * matched by trip_id, changed or new ones are upserted (new trains go to
+ * the end, as the server orders them) and departed ones removed. `seq`
+ * names the server's version of the board the table holds.
+ *
+ * Every train also carries `departs`, its departure as one integer sort key
+ * (see departureKey()), set as it is stored. A table holds at most
+ * MAX_TRAINS: once full, a new train takes the place of the latest one if
+ * it leaves earlier, so whatever order a server sends, and however many
+ * trains, the table keeps the earliest ones.
+ *
+ * Boards fetched for several queries are combined with merge() into the one
+ * board that is displayed, sorted by that key. dropDeparted() takes trains
+ * off as the clock passes their time, between fetches. With a timetable in flash (schedule_index.h),
+ * the server's board is laid over the scheduled one with overlay().
+ *
+ * A table whose response was cut off (the fetch deadline, a stalled body)
+ * holds the trains that arrived whole and is marked `incomplete`; boards
+ * merged from it are too.
+ *
+ * board_store.h keeps the last good table in NVS; a table loaded from there
+ * at boot is marked `stale` until the first fetch replaces it.
+ */
+
+#ifndef TRAIN_TABLE_H
+#define TRAIN_TABLE_H
+
+#include "train_schema.h"
+
+// Most trains kept per board (the K of the top-K); later trains in a
+// response are dropped
+#define MAX_TRAINS 20
+
+// Sort key of a train without a departure time: after all others
+const uint32_t DEPARTS_UNKNOWN = UINT32_MAX;
+
+/**
+ * A departure time (epoch seconds, already including the delay, as servers
+ * and TrainTable::overlay() give it) as a sort key
+ */
+inline uint32_t departureKey(time_t at) {
+  if (at == TIME_UNKNOWN) return DEPARTS_UNKNOWN;
+  return at < 0 ? 0 : (uint32_t)at;
+}
+
+/**
+ * One train, with every TRAIN_FIELDS entry stored in place
+ */
+struct Train {
+#define X(key, kind, fallback) kind::Storage key;
+  TRAIN_FIELDS(X)
+#undef X
+  uint32_t departs; // departureKey(arrival_time), kept by TrainTable
+};
+
+class TrainTable {
+ public:
+  // Empty the table for a new board
+  void clear();
+
+  // Append a train decoded from `object`. Once the table is full, the
+  // latest train is dropped for it if it leaves earlier; returns false if
+  // instead it is the one dropped. Either way droppedTrains counts one.
+  // May compact the pool to make room (see compactStrings()).
+  bool add(JsonObjectConst object);
+
+  // Replace the train with the same trip_id as `object`, or append it.
+  // Returns false (and counts it in droppedTrains) if it does not fit.
+  bool upsert(JsonObjectConst object);
+
+  // Remove the train with this trip_id; false if there is none
+  bool remove(const char* tripId);
+
+  // Index of the train with this trip_id, or -1
+  int find(const char* tripId) const;
+
+  // True if both tables list the same trips in the same order
+  bool sameRows(const TrainTable& other) const;
+
+  // True if trains[i] here and other.trains[j] hold the same values
+  bool sameTrain(uint8_t i, const TrainTable& other, uint8_t j) const;
+
+  // Replace this table with the earliest MAX_TRAINS trains of all
+  // `sources` (this table not among them), sorted by departure with
+  // unknown times last; later ones are counted in droppedTrains. A trip
+  // listed by several sources is kept once, and trains that left before
+  // `departedBefore` not at all. seq is kept only for a single source;
+  // the result is incomplete if any source is.
+  void merge(const TrainTable* sources, uint8_t sourceCount,
+             time_t departedBefore = TIME_UNKNOWN);
+
+  // Take off the trains that left before `before` (in place, keeping the
+  // order); returns how many
+  uint8_t dropDeparted(time_t before);
+
+  // Set a stored train's time, and with it its sort key
+  void setArrival(uint8_t index, time_t arrival);
+
+  // Lay a realtime board over this one (a timetable). A trip both list
+  // takes every field realtime has (not at its fallback); if realtime has
+  // no time for it, the scheduled time moves by the realtime delay.
+  // Realtime trips with a time that the timetable lacks are merged in.
+  // seq becomes realtime's. Uses static scratch tables:
+  // network task only.
+  void overlay(const TrainTable& realtime);
+
+  // Drop pool strings no train refers to any more (left behind by
+  // upserts and removals). Uses a static scratch pool: network task only.
+  void compactStrings();
+
+  const char* text(StringId id) const { return strings.get(id); }
+
+  bool hasTrainList = false;     // Response contained a "trains" array
+  uint8_t count = 0;             // Valid entries in trains[]
+  uint16_t droppedTrains = 0;    // Trains beyond MAX_TRAINS
+  unsigned long updatedAtMs = 0; // millis() when the data was fetched
+  time_t updatedAt = TIME_UNKNOWN; // Wall-clock time of the fetch, if known
+  uint32_t seq = 0;              // Server board version, 0 if unknown
+  bool stale = false;            // Saved by an earlier boot, not yet refreshed
+  bool incomplete = false;       // Response cut off: trains may be missing
+  Train trains[MAX_TRAINS];
+  StringPool strings;
+};
+
+#endif // TRAIN_TABLE_H
@@ -0,0 +1,49 @@
+/**
+ * Wall Clock for Metro-North Railroad Train Clock
+ *
+ * Local time of day from SNTP, so arrival times can be turned into absolute
+ * (epoch) times once, when a board is decoded, and the display can count
+ * down to each departure on its own between fetches.
+ *
+ * Until the first SNTP reply the clock still runs from 1 January 1970;
+ * arrival times converted then keep their time of day (and display
+ * correctly) but no countdown is shown until timeSynced() is true.
+ *
+ * Usage:
+ *   beginTimeSync();                  // once WiFi is up
+ *   time_t due = localTimeNear(14 * 3600 + 30 * 60);
+ *   if (timeSynced()) minutes = (due - time(nullptr)) / 60;
+ */
+
+#ifndef WALL_CLOCK_H
+#define WALL_CLOCK_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+// Epoch value for a missing or unparsable time
+#define TIME_UNKNOWN ((time_t)-1)
+
+// Apply TIME_ZONE only, so epoch times already held (a saved board) format
+// as local time before the network is up
+void applyTimeZone();
+
+// Apply TIME_ZONE and start SNTP (NTP_SERVER). SNTP keeps re-syncing in
+// the background; safe to call again after a reconnect.
+void beginTimeSync();
+
+// True once SNTP has set the clock
+bool timeSynced();
+
+// Epoch time of `secondsAfterMidnight` local time on the day closest to
+// now: "00:10" read at 23:55 is tomorrow, "23:59" read at 00:05 yesterday.
+// Values past 24:00 (GTFS trips running after midnight) roll over.
+time_t localTimeNear(int32_t secondsAfterMidnight);
+
+// Format an epoch time as local time (strftime `format`), or `fallback`
+// for TIME_UNKNOWN
+void formatLocalTime(time_t when, const char* format, char* buffer,
+                     size_t size, const char* fallback = "N/A");
+
+#endif // WALL_CLOCK_H
@@ -0,0 +1,76 @@
+/**
+ * Non-blocking WiFi Connection for Metro-North Railroad Train Clock
+ *
+ * Event-driven replacement for a busy-wait connect loop. update() advances
+ * a small state machine and returns immediately; connection progress is
+ * reported by WiFi.onEvent callbacks.
+ *
+ * Startup and reconnects are kept short by:
+ *   - remembering the BSSID and channel of the last AP in NVS, so the next
+ *     connect skips the full channel scan (falls back to a scan if the AP
+ *     has moved)
+ *   - an optional static IP (WIFI_STATIC_IP in config.h) to skip DHCP
+ *   - retrying a dropped link immediately, then backing off exponentially
+ *     while attempts keep failing
+ *
+ * Usage (from the network task):
+ *   wifi.begin(ssid, password);
+ *   for (;;) {
+ *     wifi.update();
+ *     if (wifi.connected()) { ... }
+ *   }
+ */
+
+#ifndef WIFI_LINK_H
+#define WIFI_LINK_H
+
+#include <WiFi.h>
+#include <atomic>
+
+enum WiFiLinkState {
+  WIFI_LINK_IDLE,
+  WIFI_LINK_CONNECTING,
+  WIFI_LINK_CONNECTED,
+  WIFI_LINK_BACKOFF,
+};
+
+class WiFiLink {
+ public:
+  void begin(const char* ssid, const char* password);
+
+  // Advance the state machine; never blocks
+  void update();
+
+  bool connected() const { return state == WIFI_LINK_CONNECTED; }
+  WiFiLinkState getState() const { return state; }
+
+  // Times an established link was lost
+  uint32_t reconnectCount() const { return drops; }
+
+ private:
+  void startAttempt();
+  void attemptFailed(uint8_t reason);
+  void loadCachedAp();
+  void saveCachedAp();
+  void onEvent(arduino_event_id_t event, arduino_event_info_t info);
+
+  const char* ssid = nullptr;
+  const char* password = nullptr;
+
+  WiFiLinkState state = WIFI_LINK_IDLE;
+  unsigned long stateSince = 0;
+  unsigned long backoffMs = 0;
+  uint32_t drops = 0;
+
+  // Last AP we were associated with (from NVS)
+  uint8_t cachedBssid[6] = {0};
+  uint8_t cachedChannel = 0;
+  bool fastConnect = false; // Current attempt targets the cached AP
+
+  // Set from the WiFi event task, consumed by update()
+  std::atomic<bool> gotIp{false};
+  std::atomic<bool> linkLost{false};
+  std::atomic<uint8_t> lostReason{0};
+};
+
+#endif // WIFI_LINK_H
@@ -13,11 +13,37 @@ Then configure your Arduino to point to:
 
 Requirements:
     pip install flask
+    pip install msgpack   # optional, enables application/msgpack replies
+    pip install zeroconf  # optional, lets SERVICE_DISCOVERY clocks find it
 """
 
-from flask import Flask, jsonify
+from flask import Flask, Response, jsonify, request, stream_with_context
+from werkzeug.serving import WSGIRequestHandler
+from collections import OrderedDict
 from datetime import datetime, timedelta
+import copy
+import json
+import os
 import random
+import socket
+import threading
+import time
+import zlib
+
+# MessagePack is optional: without the package every client gets JSON
+try:
+    import msgpack
+except ImportError:
+    msgpack = None
+
+# zeroconf is optional: without it clocks need API_ENDPOINT to find us
+try:
+    from zeroconf import ServiceInfo, Zeroconf
+except ImportError:
+    Zeroconf = None
+
+# DNS-SD type the clock browses for (DISCOVERY_SERVICE in service_discovery.h)
+SERVICE_TYPE = "_mnr-trains._tcp.local."
 
 app = Flask(__name__)
 
@@ -32,34 +58,74 @@ DESTINATIONS = [
 ]
 STATUSES = ["On Time", "Delayed", "Boarding", "Departed"]
 
+# Stop IDs of the destinations, for ?destination_station= (what the clock
+# sends as API_DESTINATION). Grand Central is "1", as in the MNR feed; the
+# others are made up for the mock.
+DESTINATION_STOP_IDS = {
+    "Grand Central Terminal": "1",
+    "White Plains": "74",
+    "Poughkeepsie": "39",
+    "New Haven": "149",
+    "Stamford": "124",
+}
 
-def generate_mock_trains(count=5):
-    """Generate mock train data"""
-    trains = []
-    now = datetime.now()
-    
-    for i in range(count):
+# How long a board stays unchanged. Polls in between get the same data, so
+# the clock's conditional GET sees 304 Not Modified.
+BOARD_REFRESH_SECONDS = 60
+
+# Past versions kept per board, so clients up to this many versions behind
+# get a delta (?since=<seq>) instead of the full board
+BOARD_HISTORY = 16
+
+# Chance that a train's delay grows when the board is refreshed
+DELAY_CHANCE = 0.3
+
+# Tracks are announced ("TBD" -> a number) this long before departure,
+# whenever that falls: the change push clients see within seconds
+TRACK_ANNOUNCE_MINUTES = 10
+
+# Push streams check for a new version this often, and send a heartbeat
+# comment when idle for HEARTBEAT_SECONDS
+STREAM_CHECK_SECONDS = 1
+HEARTBEAT_SECONDS = 15
+
+# count -> Board; polls and push streams run on several threads
+_boards = {}
+_boards_lock = threading.Lock()
+
+
+class Board:
+    """A board of count trains that evolves over time, with its history"""
+
+    def __init__(self, count):
+        self.count = count
+        self.next_trip = 1000000
+        self.generated_at = datetime.now().replace(microsecond=0)
+        self.changed_at = self.generated_at  # Time of the current version
+        self.trains = [self.new_train(
+            self.generated_at + timedelta(minutes=5 + i * 7))
+            for i in range(count)]
+        self.seq = 1
+        self.history = OrderedDict([(self.seq, copy.deepcopy(self.trains))])
+
+    def new_train(self, scheduled):
+        """Generate one mock train due at `scheduled`"""
         # Generate random delay
-        is_delayed = random.random() < 0.3  # 30% chance of delay
+        is_delayed = random.random() < DELAY_CHANCE
         delay_seconds = random.randint(60, 600) if is_delayed else 0
-        
-        # Generate arrival time
-        minutes_from_now = 5 + (i * 7)
-        arrival_time = now + timedelta(minutes=minutes_from_now, seconds=delay_seconds)
+        arrival_time = scheduled + timedelta(seconds=delay_seconds)
         
         # Determine status
-        if delay_seconds > 300:
-            status = "Delayed"
-        elif delay_seconds > 0:
+        if delay_seconds > 0:
             status = "Delayed"
         else:
             status = random.choice(["On Time", "Boarding"])
         
-        # Generate track number
-        track = str(random.randint(1, 12)) if random.random() < 0.9 else "TBD"
+        # The track is announced shortly before departure (see refresh)
+        track = "TBD"
         
         train = {
-            "trip_id": f"MNR{1000000 + i}",
+            "trip_id": f"MNR{self.next_trip}",
             "route": random.choice(ROUTES),
             "destination": random.choice(DESTINATIONS),
             "track": track,
@@ -67,16 +133,319 @@ def generate_mock_trains(count=5):
             "status": status,
             "delay_seconds": delay_seconds
         }
-        trains.append(train)
-    
-    return trains
+        self.next_trip += 1
+        return train
+
+    @staticmethod
+    def departs_at(train, now):
+        """Departure of train as a datetime on the day nearest to now"""
+        clock = datetime.strptime(train["arrival_time"], "%H:%M:%S").time()
+        when = datetime.combine(now.date(), clock)
+        if when - now > timedelta(hours=12):
+            when -= timedelta(days=1)
+        elif now - when > timedelta(hours=12):
+            when += timedelta(days=1)
+        return when
+
+    def announce_at(self, train, now):
+        """When train's track is announced, or None if it already is"""
+        if train["track"] != "TBD":
+            return None
+        return self.departs_at(train, now) - timedelta(minutes=TRACK_ANNOUNCE_MINUTES)
+
+    def refresh(self):
+        """
+        Advance the board: every BOARD_REFRESH_SECONDS a few trains change,
+        and tracks are announced as trains approach
+        """
+        now = datetime.now().replace(microsecond=0)
+        stale = (now - self.generated_at).total_seconds() >= BOARD_REFRESH_SECONDS
+        trains = copy.deepcopy(self.trains)
+        changed = False
+
+        if stale:
+            for train in trains:
+                if random.random() < DELAY_CHANCE:
+                    extra = random.choice([60, 120, 180])
+                    arrival = datetime.strptime(train["arrival_time"], "%H:%M:%S")
+                    train["arrival_time"] = (arrival + timedelta(seconds=extra)).strftime("%H:%M:%S")
+                    train["delay_seconds"] += extra
+                    train["status"] = "Delayed"
+
+            # The first train departs; a new one joins at the end of the board
+            trains.pop(0)
+            trains.append(self.new_train(now + timedelta(minutes=5 + self.count * 7)))
+            self.generated_at = now
+            changed = True
+
+        for train in trains:
+            announce = self.announce_at(train, now)
+            if announce is not None and announce <= now:
+                train["track"] = str(random.randint(1, 12))
+                changed = True
+
+        if not changed:
+            return
+
+        self.trains = trains
+        self.changed_at = now
+        self.seq += 1
+        self.history[self.seq] = copy.deepcopy(trains)
+        while len(self.history) > BOARD_HISTORY:
+            self.history.popitem(last=False)
+
+    def seconds_until_refresh(self):
+        """Seconds until refresh() will produce a new version"""
+        now = datetime.now()
+        seconds = BOARD_REFRESH_SECONDS - (now - self.generated_at).total_seconds()
+        for train in self.trains:
+            announce = self.announce_at(train, now)
+            if announce is not None:
+                seconds = min(seconds, (announce - now).total_seconds())
+        return max(0, int(seconds))
+
+    def delta(self, since, view=lambda trains: trains):
+        """
+        Changes from version `since` to now, or None if it is not kept,
+        among the trains `view` selects
+        """
+        old = self.history.get(since)
+        if old is None:
+            return None
+
+        old_by_id = {train["trip_id"]: train for train in view(old)}
+        trains = view(self.trains)
+        new_ids = {train["trip_id"] for train in trains}
+        return {
+            "seq": self.seq,
+            "base": since,
+            "upserts": [train for train in trains
+                        if old_by_id.get(train["trip_id"]) != train],
+            "removes": [trip_id for trip_id in old_by_id if trip_id not in new_ids],
+        }
+
+
+def current_board(count):
+    """Return the Board of count trains, advanced if it is stale"""
+    with _boards_lock:
+        board = _boards.get(count)
+        if board is None:
+            board = _boards[count] = Board(count)
+        board.refresh()
+        return board
+
+
+def request_view():
+    """
+    Trains selected by the request's ?route= and destination filters, so a
+    clock can show several views (directions, lines) merged on one board,
+    and of those the first ?limit= (the rows its display has)
+
+    The destination is a stop ID in ?destination_station= (as the clock and
+    web_server.py name it) or a name in ?destination=. ?origin_station= is
+    accepted and changes nothing: the mock board is the board of whichever
+    station asks, so every train calls there.
+    """
+    route = request.args.get('route')
+    destination = request.args.get('destination')
+    destination_stop = request.args.get('destination_station')
+    limit = request.args.get('limit', type=int)
+
+    def heads_for(train):
+        if destination is not None and train["destination"] != destination:
+            return False
+        return (destination_stop is None or
+                DESTINATION_STOP_IDS.get(train["destination"]) == destination_stop)
+
+    def select(trains):
+        matched = [train for train in trains
+                   if (route is None or train["route"] == route) and heads_for(train)]
+        return matched[:limit] if limit is not None and limit > 0 else matched
+
+    return select
+
+
+# What a clock with its station's timetable in flash still needs from the
+# server; it has the rest (SCHEDULE_REALTIME_FIELDS in schedule_index.h)
+COMPACT_FIELDS = ("trip_id", "track", "status", "delay_seconds")
+
+
+def request_fields():
+    """
+    Keys of each train the request asks for: ?fields=<key>,<key>... (the
+    firmware sends the ones it stores), COMPACT_FIELDS for ?compact=1 from
+    older firmware, or None for all of them
+    """
+    fields = request.args.get('fields')
+    if fields:
+        return tuple(field for field in fields.split(',') if field)
+    if request.args.get('compact') == '1':
+        return COMPACT_FIELDS
+    return None
+
+
+def board_payload(board, since, view, fields=None):
+    """
+    Delta from version since if it is kept, else the full board; trains
+    reduced to `fields` if given
+    """
+    payload = board.delta(since, view) if since is not None else None
+    if payload is None:
+        payload = {"seq": board.seq, "trains": view(board.trains)}
+    if fields is not None:
+        key = "upserts" if "upserts" in payload else "trains"
+        payload[key] = [{field: train[field] for field in fields if field in train}
+                        for train in payload[key]]
+    return payload
+
+
+# Compress with a 4 KB window so the clock's small-window inflater can
+# decode it (INFLATE_WINDOW_BITS in the firmware's config_defaults.h)
+COMPRESSION_WINDOW_BITS = 12
+COMPRESSION_MIN_SIZE = 256
+
+
+def compress_response(response):
+    """gzip- or deflate-encode response if the client accepts it"""
+    response.vary.add('Accept-Encoding')
+    body = response.get_data()
+    coding = request.accept_encodings.best_match(['gzip', 'deflate'])
+    if coding is None or len(body) < COMPRESSION_MIN_SIZE:
+        return response
+
+    wbits = COMPRESSION_WINDOW_BITS + (16 if coding == 'gzip' else 0)
+    compressor = zlib.compressobj(6, zlib.DEFLATED, wbits)
+    response.set_data(compressor.compress(body) + compressor.flush())
+    response.headers['Content-Encoding'] = coding
+    return response
+
+
+def advertise_service(port, path):
+    """
+    Announce the API over DNS-SD as _mnr-trains._tcp, so clocks built
+    with SERVICE_DISCOVERY 1 find this server without an API_ENDPOINT.
+
+    Returns the Zeroconf instance, which has to be kept for as long as the
+    announcement should last, or None without the zeroconf package.
+    """
+    if Zeroconf is None:
+        print("  (pip install zeroconf to let clocks find this server)")
+        return None
+
+    # The address other hosts reach us on: the one the default route uses
+    # (connecting a UDP socket sends nothing)
+    with socket.socket(socket.AF_INET, socket.SOCK_DGRAM) as probe:
+        probe.connect(("10.255.255.255", 1))
+        address = probe.getsockname()[0]
+
+    info = ServiceInfo(
+        SERVICE_TYPE,
+        f"{socket.gethostname()}.{SERVICE_TYPE}",
+        addresses=[socket.inet_aton(address)],
+        port=port,
+        properties={"path": path},
+    )
+    zeroconf = Zeroconf()
+    zeroconf.register_service(info)
+    print(f"  Advertised as {SERVICE_TYPE} on {address}:{port}{path}")
+    return zeroconf
+
+
+def conditional_response(payload, last_modified):
+    """
+    Encode payload as JSON or MessagePack, with ETag and Last-Modified
+
+    MessagePack is used when the request's Accept header prefers it, and
+    the body is compressed when Accept-Encoding allows.
+    Answers 304 Not Modified when the request's If-None-Match or
+    If-Modified-Since shows the client already has this payload.
+    """
+    mimetype = 'application/json'
+    if msgpack is not None:
+        # JSON first, so clients sending */* (browsers, curl) still get JSON
+        mimetype = request.accept_mimetypes.best_match(
+            ['application/json', 'application/msgpack']) or mimetype
+
+    if mimetype == 'application/msgpack':
+        response = app.response_class(msgpack.packb(payload), mimetype=mimetype)
+    else:
+        response = jsonify(payload)
+    response.vary.add('Accept')
+    compress_response(response)
+    response.add_etag()
+    response.last_modified = last_modified
+    return response.make_conditional(request)
+
+
+def board_response(count):
+    """
+    Full board, or only its changes when the client names a version
+
+    Cache-Control max-age tells clients when the board changes next. With
+    ?since=<seq> for a version still in the history the reply is a delta:
+    {"seq", "base", "upserts", "removes"}. Unknown versions get the full
+    board ({"seq", "trains"}), which the client takes as a resync.
+    ?route= and ?destination_station= (or ?destination=) narrow either to
+    the matching trains, ?limit=
+    to the first of them, and ?fields= (or ?compact=1) to some keys of each.
+    """
+    board = current_board(count)
+    since = request.args.get('since', type=int)
+
+    if since == board.seq:
+        response = app.response_class(status=304)
+        response.last_modified = board.changed_at
+    else:
+        response = conditional_response(
+            board_payload(board, since, request_view(), request_fields()),
+            board.changed_at)
+
+    # Nothing changes before the next refresh, so clients can wait for it
+    response.cache_control.max_age = board.seconds_until_refresh()
+    return response
+
+
+def board_stream(count):
+    """
+    Server-Sent Events stream of board changes
+
+    The first event brings the client up to date from ?since=<seq> (or the
+    Last-Event-ID header a reconnecting browser sends): a delta, the full
+    board, or nothing if it already has the current version. After that,
+    one "board" event per new version, each a delta against the previous
+    one, and a heartbeat comment whenever the board is quiet.
+    """
+    since = request.args.get('since', type=int)
+    if since is None:
+        since = request.headers.get('Last-Event-ID', type=int)
+    view = request_view()
+    fields = request_fields()
+
+    def events():
+        last = since
+        idle = 0
+        while True:
+            board = current_board(count)
+            if board.seq != last:
+                data = json.dumps(board_payload(board, last, view, fields), separators=(',', ':'))
+                yield f"event: board\nid: {board.seq}\ndata: {data}\n\n"
+                last = board.seq
+                idle = 0
+            elif idle >= HEARTBEAT_SECONDS:
+                yield ": keep-alive\n\n"
+                idle = 0
+            time.sleep(STREAM_CHECK_SECONDS)
+            idle += STREAM_CHECK_SECONDS
+
+    response = Response(stream_with_context(events()), mimetype='text/event-stream')
+    response.cache_control.no_cache = True
+    return response
 
 
 @app.route('/api/trains')
 def get_trains():
     """Return mock train data as JSON"""
-    trains = generate_mock_trains(count=5)
-    return jsonify({"trains": trains})
+    return board_response(5)
 
 
 @app.route('/api/trains/<int:count>')
@@ -85,8 +454,22 @@ def get_trains_count(count):
     if count < 1 or count > 20:
         return jsonify({"error": "Count must be between 1 and 20"}), 400
     
-    trains = generate_mock_trains(count=count)
-    return jsonify({"trains": trains})
+    return board_response(count)
+
+
+@app.route('/api/trains/stream')
+def stream_trains():
+    """Push changes to the 5-train board as they happen"""
+    return board_stream(5)
+
+
+@app.route('/api/trains/<int:count>/stream')
+def stream_trains_count(count):
+    """Push changes to the board of count trains"""
+    if count < 1 or count > 20:
+        return jsonify({"error": "Count must be between 1 and 20"}), 400
+
+    return board_stream(count)
 
 
 @app.route('/api/status')
@@ -99,6 +482,13 @@ def status():
         "endpoints": {
             "/api/trains": "Get 5 upcoming trains",
             "/api/trains/<count>": "Get specified number of trains",
+            "/api/trains?since=<seq>": "Changes since board version <seq>",
+            "/api/trains?route=<route>&destination_station=<stop_id>": "Only matching trains",
+            "/api/trains?destination=<name>": "Only trains to this destination",
+            "/api/trains?limit=<n>": "Only the first n trains",
+            "/api/trains?fields=<key>,<key>": "Only these keys of each train",
+            "/api/trains?compact=1": "Only trip_id, track, status and delay",
+            "/api/trains/stream": "Server-Sent Events stream of board changes",
             "/api/status": "Server status"
         }
     })
@@ -118,6 +508,9 @@ def index():
         <ul>
             <li><a href="/api/trains">/api/trains</a> - Get 5 upcoming trains (JSON)</li>
             <li><a href="/api/trains/10">/api/trains/10</a> - Get 10 upcoming trains (JSON)</li>
+            <li><a href="/api/trains?since=1">/api/trains?since=1</a> - Changes since board version 1 (JSON)</li>
+            <li><a href="/api/trains?route=Hudson%20Line">/api/trains?route=Hudson%20Line</a> - Only Hudson Line trains (filters: route, destination, limit)</li>
+            <li><a href="/api/trains/stream">/api/trains/stream</a> - Board changes as they happen (Server-Sent Events)</li>
             <li><a href="/api/status">/api/status</a> - Server status (JSON)</li>
         </ul>
         
@@ -130,6 +523,7 @@ def index():
         <h2>Sample Response:</h2>
         <pre>
 {
+  "seq": 1,
   "trains": [
     {
       "trip_id": "MNR1000000",
@@ -155,8 +549,18 @@ if __name__ == '__main__':
     print("\nStarting server on http://0.0.0.0:5000")
     print("\nEndpoints:")
     print("  - http://localhost:5000/api/trains")
+    print("  - http://localhost:5000/api/trains/stream")
     print("  - http://localhost:5000/api/status")
     print("\nPress Ctrl+C to stop the server")
     print("=" * 60)
     
-    app.run(host='0.0.0.0', port=5000, debug=True)
+    # Werkzeug answers HTTP/1.0 and closes every connection by default;
+    # HTTP/1.1 lets the clock keep one socket open between polls
+    WSGIRequestHandler.protocol_version = "HTTP/1.1"
+
+    # With debug on, the reloader's child process is the one serving
+    if os.environ.get("WERKZEUG_RUN_MAIN") == "true":
+        advertiser = advertise_service(5000, "/api/trains")
+
+    # Push streams hold their request open, so serve each on its own thread
+    app.run(host='0.0.0.0', port=5000, debug=True, threaded=True)
@@ -0,0 +1,174 @@
+/**
+ * Persisted Last-good Board - implementation
+ *
+ * See board_store.h for an overview.
+ *
+ * Record layout (one NVS blob):
+ *   StoredHeader                     magic, layout size, checksum, fetch time
+ *   Train[count]                     as in memory (plain structs)
+ *   strings 1..stringCount           NUL-terminated, in pool id order
+ *                                    (EMPTY, id 0, is implied)
+ * Interning the strings again in that order into an empty pool gives them
+ * the same ids, so the StringId fields in the trains stay valid.
+ *
+ * Wear: a full board is about 2 KB, ~70 NVS entries. At one write per
+ * BOARD_SAVE_INTERVAL_MS (at most ~100 a day) even a small NVS partition
+ * lasts many years of flash erase cycles; NVS spreads the writes itself.
+ */
+
+#include "board_store.h"
+
+#include <Preferences.h>
+#include <stddef.h>
+#include <string.h>
+
+static const char* NVS_NAMESPACE = "board";
+static const char* NVS_KEY = "last";
+
+// Bump when the record layout changes, so an old record is not misread
+static const uint32_t STORED_MAGIC = 0x4D4E4201;
+
+// Minimum time between two writes of a changed board
+const unsigned long BOARD_SAVE_INTERVAL_MS = 15 * 60000;
+
+struct StoredHeader {
+  uint32_t magic;
+  uint16_t trainSize;     // sizeof(Train) of the firmware that wrote it
+  uint16_t length;        // Bytes after the header
+  uint32_t checksum;      // Of everything from seq to the end
+  int64_t updatedAt;      // Not part of the checksum: refetching an unchanged
+                          // board does not cause a write
+  uint32_t seq;
+  uint16_t droppedTrains;
+  uint8_t count;
+  uint8_t stringCount;
+};
+
+// Largest record: a full table and a full string pool
+static const size_t RECORD_CAPACITY = sizeof(StoredHeader) +
+                                      MAX_TRAINS * sizeof(Train) +
+                                      STRING_POOL_BYTES;
+
+// Network task only
+static uint8_t record[RECORD_CAPACITY];
+
+/**
+ * FNV-1a, as in retained_state.cpp
+ */
+static uint32_t checksumOf(const uint8_t* p, size_t length) {
+  uint32_t hash = 2166136261u;
+  while (length--) {
+    hash = (hash ^ *p++) * 16777619u;
+  }
+  return hash;
+}
+
+size_t BoardStore::serialize(const TrainTable& table, uint8_t* out,
+                             size_t size) const {
+  StoredHeader header = {};
+  header.magic = STORED_MAGIC;
+  header.trainSize = sizeof(Train);
+  header.updatedAt = (int64_t)table.updatedAt;
+  header.seq = table.seq;
+  header.droppedTrains = table.droppedTrains;
+  header.count = table.count;
+  header.stringCount = table.strings.size() - 1; // Without EMPTY
+
+  size_t at = sizeof(header);
+  size_t trainBytes = table.count * sizeof(Train);
+  if (at + trainBytes > size) return 0;
+  memcpy(out + at, table.trains, trainBytes);
+  at += trainBytes;
+
+  for (uint8_t id = 1; id <= header.stringCount; id++) {
+    const char* text = table.strings.get(id);
+    size_t length = strlen(text) + 1;
+    if (at + length > size) return 0;
+    memcpy(out + at, text, length);
+    at += length;
+  }
+
+  header.length = at - sizeof(header);
+  memcpy(out, &header, sizeof(header));
+  uint32_t checksum = checksumOf(out + offsetof(StoredHeader, seq),
+                                 at - offsetof(StoredHeader, seq));
+  memcpy(out + offsetof(StoredHeader, checksum), &checksum, sizeof(checksum));
+  return at;
+}
+
+void BoardStore::save(const TrainTable& table) {
+  // Only real boards; an empty board after a failed first fetch would
+  // replace a good one
+  if (!table.hasTrainList) return;
+
+  size_t length = serialize(table, record, sizeof(record));
+  if (length == 0) return;
+
+  uint32_t checksum;
+  memcpy(&checksum, record + offsetof(StoredHeader, checksum), sizeof(checksum));
+  if (checksum == savedChecksum) return;
+
+  // The first changed board of a boot is written right away; later ones
+  // wait out the interval
+  if (savedThisBoot && millis() - savedAtMs < BOARD_SAVE_INTERVAL_MS) return;
+
+  Preferences prefs;
+  if (!prefs.begin(NVS_NAMESPACE, false)) return;
+  bool written = prefs.putBytes(NVS_KEY, record, length) == length;
+  prefs.end();
+
+  if (written) {
+    savedChecksum = checksum;
+    savedAtMs = millis();
+    savedThisBoot = true;
+  }
+}
+
+bool BoardStore::load(TrainTable& table) {
+  Preferences prefs;
+  if (!prefs.begin(NVS_NAMESPACE, true)) return false;
+  size_t length = prefs.getBytesLength(NVS_KEY);
+  bool read = length >= sizeof(StoredHeader) && length <= sizeof(record) &&
+              prefs.getBytes(NVS_KEY, record, length) == length;
+  prefs.end();
+  if (!read) return false;
+
+  StoredHeader header;
+  memcpy(&header, record, sizeof(header));
+  if (header.magic != STORED_MAGIC || header.trainSize != sizeof(Train) ||
+      header.length != length - sizeof(header) || header.count > MAX_TRAINS ||
+      header.checksum != checksumOf(record + offsetof(StoredHeader, seq),
+                                    length - offsetof(StoredHeader, seq))) {
+    return false;
+  }
+
+  size_t at = sizeof(header);
+  size_t trainBytes = header.count * sizeof(Train);
+  if (at + trainBytes > length) return false;
+
+  table.clear();
+  memcpy(table.trains, record + at, trainBytes);
+  at += trainBytes;
+
+  for (uint8_t id = 1; id <= header.stringCount; id++) {
+    const char* text = (const char*)record + at;
+    size_t textLength = strnlen(text, length - at);
+    if (at + textLength >= length || table.strings.intern(text) != id) {
+      table.clear();
+      return false;
+    }
+    at += textLength + 1;
+  }
+
+  table.hasTrainList = true;
+  table.count = header.count;
+  table.droppedTrains = header.droppedTrains;
+  table.seq = header.seq;
+  table.updatedAt = (time_t)header.updatedAt;
+  table.updatedAtMs = 0; // millis() of an earlier boot
+  table.stale = true;
+
+  // Already in NVS: no need to write it again this boot
+  savedChecksum = header.checksum;
+  return true;
+}
@@ -0,0 +1,45 @@
+/**
+ * Display Backends - shared countdown formatting
+ *
+ * See display.h for an overview.
+ */
+
+#include "display.h"
+
+int16_t countdownBucket(time_t arrival, time_t now) {
+  if (arrival == TIME_UNKNOWN) return COUNTDOWN_UNKNOWN;
+
+  long seconds = (long)(arrival - now);
+  if (seconds < -60) return COUNTDOWN_DEPARTED;
+  if (seconds < 60) return COUNTDOWN_DUE;
+  return (int16_t)(seconds / 60 > 999 ? 999 : seconds / 60);
+}
+
+void formatCountdown(time_t arrival, time_t now, char* buffer, size_t size) {
+  int16_t bucket = countdownBucket(arrival, now);
+
+  if (bucket == COUNTDOWN_UNKNOWN) {
+    snprintf(buffer, size, "N/A");
+  } else if (bucket == COUNTDOWN_DEPARTED) {
+    snprintf(buffer, size, "departed");
+  } else if (bucket == COUNTDOWN_DUE) {
+    snprintf(buffer, size, "due now");
+  } else {
+    snprintf(buffer, size, "in %d min", bucket);
+  }
+}
+
+void formatShortCountdown(time_t arrival, time_t now, char* buffer,
+                          size_t size) {
+  int16_t bucket = countdownBucket(arrival, now);
+
+  if (bucket == COUNTDOWN_UNKNOWN) {
+    snprintf(buffer, size, "--");
+  } else if (bucket == COUNTDOWN_DEPARTED) {
+    snprintf(buffer, size, "dep");
+  } else if (bucket == COUNTDOWN_DUE) {
+    snprintf(buffer, size, "due");
+  } else {
+    snprintf(buffer, size, "%dm", bucket);
+  }
+}
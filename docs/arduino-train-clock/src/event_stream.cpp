@@ -0,0 +1,215 @@
+/**
+ * Server-Sent Events Reader - implementation
+ *
+ * See event_stream.h for an overview.
+ */
+
+#include "event_stream.h"
+
+#include <string.h>
+
+// Longest field name told apart ("event", "data", "id", "retry")
+static const size_t FIELD_NAME_CAPACITY = 8;
+
+void EventStream::begin(Stream& source) {
+  this->source = &source;
+  inData = false;
+  eventDone = false;
+  sourceEnded = false;
+  pendingCr = false;
+  lookahead = -1;
+  peeked = -1;
+  strcpy(eventType, "message");
+  eventId[0] = '\0';
+}
+
+/**
+ * Next byte of the stream with CR, LF and CRLF all read as '\n'
+ */
+int EventStream::nextByte() {
+  if (lookahead >= 0) {
+    int c = lookahead;
+    lookahead = -1;
+    return c;
+  }
+  if (sourceEnded) return -1;
+
+  int c = source->read();
+  if (pendingCr) {
+    pendingCr = false;
+    if (c == '\n') c = source->read();
+  }
+  if (c < 0) {
+    sourceEnded = true;
+    return -1;
+  }
+  if (c == '\r') {
+    pendingCr = true;
+    return '\n';
+  }
+  return c;
+}
+
+/**
+ * Read a field name, up to `:` or the end of the line. Returns the
+ * character that ended it (':' or '\n'), or -1 at the end of the stream.
+ * A blank line gives an empty name ending in '\n', a comment an empty name
+ * ending in ':'.
+ */
+int EventStream::readField(char* name, size_t size) {
+  size_t len = 0;
+  int c;
+  while ((c = nextByte()) >= 0 && c != ':' && c != '\n') {
+    if (len + 1 < size) name[len++] = (char)c;
+  }
+  name[len] = '\0';
+  return c;
+}
+
+/**
+ * Read the rest of a field's line into buffer (nullptr to discard), without
+ * the single space that may follow the `:`
+ */
+void EventStream::readValue(char* buffer, size_t size) {
+  size_t len = 0;
+  int c = nextByte();
+  if (c == ' ') c = nextByte();
+  while (c >= 0 && c != '\n') {
+    if (buffer != nullptr && len + 1 < size) buffer[len++] = (char)c;
+    c = nextByte();
+  }
+  if (buffer != nullptr) buffer[len] = '\0';
+}
+
+bool EventStream::next() {
+  if (inData) finish();
+
+  // Fields seen before a call that found no more bytes still count: they
+  // belong to the event whose data is arriving
+  while (!sourceEnded && (lookahead >= 0 || source->available() > 0)) {
+    if (eventDone) {
+      strcpy(eventType, "message");
+      eventDone = false;
+    }
+
+    char name[FIELD_NAME_CAPACITY];
+    int end = readField(name, sizeof(name));
+    if (end < 0) break;
+
+    if (name[0] == '\0') {
+      if (end == ':') {
+        readValue(nullptr, 0); // Comment, e.g. a heartbeat
+      } else {
+        eventDone = true;      // Blank line ending an event without data
+      }
+      continue;
+    }
+
+    if (strcmp(name, "data") == 0) {
+      if (end == ':') {
+        int c = nextByte();
+        if (c != ' ') lookahead = c;
+      } else {
+        lookahead = '\n';      // "data" alone: an empty line of data
+      }
+      inData = true;
+      return true;
+    }
+
+    char* value = nullptr;
+    size_t size = 0;
+    if (strcmp(name, "event") == 0) {
+      value = eventType;
+      size = sizeof(eventType);
+    } else if (strcmp(name, "id") == 0) {
+      value = eventId;
+      size = sizeof(eventId);
+    }
+    if (end == ':') {
+      readValue(value, size);
+    } else if (value != nullptr) {
+      value[0] = '\0';
+    }
+  }
+  return false;
+}
+
+/**
+ * Next byte of the current event's data, or -1 at its end
+ */
+int EventStream::dataByte() {
+  if (!inData) return -1;
+
+  int c = nextByte();
+  if (c < 0) {
+    inData = false;
+    return -1;
+  }
+  if (c != '\n') return c;
+
+  // End of a data line: more fields follow, or a blank line ends the event
+  for (;;) {
+    char name[FIELD_NAME_CAPACITY];
+    int end = readField(name, sizeof(name));
+    if (end < 0) {
+      inData = false;
+      return -1;
+    }
+
+    if (name[0] == '\0' && end == '\n') {
+      inData = false;
+      eventDone = true;
+      return -1;
+    }
+
+    if (strcmp(name, "data") == 0) {
+      if (end == ':') {
+        int next = nextByte();
+        if (next != ' ') lookahead = next;
+      } else {
+        lookahead = '\n';
+      }
+      return '\n'; // Data lines are joined with a line feed
+    }
+
+    // Comments and fields other than data; an id is still recorded
+    if (end == ':') {
+      readValue(strcmp(name, "id") == 0 ? eventId : nullptr, sizeof(eventId));
+    }
+  }
+}
+
+void EventStream::finish() {
+  peeked = -1;
+  while (dataByte() >= 0) {
+  }
+}
+
+int EventStream::read() {
+  if (peeked >= 0) {
+    int c = peeked;
+    peeked = -1;
+    return c;
+  }
+  return dataByte();
+}
+
+int EventStream::peek() {
+  if (peeked < 0) peeked = dataByte();
+  return peeked;
+}
+
+size_t EventStream::readBytes(char* buffer, size_t length) {
+  size_t total = 0;
+  while (total < length) {
+    int c = read();
+    if (c < 0) break;
+    buffer[total++] = (char)c;
+  }
+  return total;
+}
+
+int EventStream::available() {
+  if (peeked >= 0 || lookahead >= 0) return 1;
+  return inData && source->available() > 0 ? 1 : 0;
+}
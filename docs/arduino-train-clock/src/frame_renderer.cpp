@@ -0,0 +1,123 @@
+/**
+ * Frame-buffered Text Renderer - implementation
+ *
+ * See frame_renderer.h for an overview.
+ */
+
+#include "frame_renderer.h"
+
+#include <stdarg.h>
+
+static bool isContinuationByte(char c) {
+  return ((uint8_t)c & 0xC0) == 0x80;
+}
+
+size_t displayWidth(const char* text) {
+  size_t columns = 0;
+  for (const char* p = text; *p != '\0'; p++) {
+    if (!isContinuationByte(*p)) columns++;
+  }
+  return columns;
+}
+
+void FrameRenderer::begin() {
+  len = 0;
+  col = 0;
+}
+
+void FrameRenderer::appendBytes(const char* data, size_t count, size_t columns) {
+  // A frame larger than the buffer still renders correctly, just in more
+  // than one write
+  if (len + count > sizeof(buffer)) {
+    out.write((const uint8_t*)buffer, len);
+    len = 0;
+    if (count > sizeof(buffer)) {
+      out.write((const uint8_t*)data, count);
+      col += columns;
+      return;
+    }
+  }
+
+  memcpy(buffer + len, data, count);
+  len += count;
+  col += columns;
+}
+
+void FrameRenderer::append(const char* text) {
+  const char* lineStart = text;
+  const char* newline;
+
+  // Column tracking restarts after every embedded newline
+  while ((newline = strchr(lineStart, '\n')) != nullptr) {
+    appendBytes(lineStart, newline - lineStart + 1, 0);
+    col = 0;
+    lineStart = newline + 1;
+  }
+  appendBytes(lineStart, strlen(lineStart), displayWidth(lineStart));
+}
+
+void FrameRenderer::appendf(const char* format, ...) {
+  char text[128];
+  va_list args;
+  va_start(args, format);
+  vsnprintf(text, sizeof(text), format, args);
+  va_end(args);
+  append(text);
+}
+
+void FrameRenderer::appendClipped(const char* text, size_t maxColumns) {
+  if (displayWidth(text) <= maxColumns) {
+    append(text);
+    return;
+  }
+  if (maxColumns == 0) return;
+
+  // Keep maxColumns - 1 code points and mark the cut with an ellipsis
+  const char* end = text;
+  size_t columns = 0;
+  while (*end != '\0') {
+    if (!isContinuationByte(*end)) {
+      if (columns == maxColumns - 1) break;
+      columns++;
+    }
+    end++;
+  }
+
+  appendBytes(text, end - text, columns);
+  appendBytes("…", strlen("…"), 1);
+}
+
+void FrameRenderer::appendPadded(const char* text, size_t columns) {
+  size_t end = col + columns;
+  appendClipped(text, columns);
+  padTo(end);
+}
+
+void FrameRenderer::appendRepeat(const char* glyph, size_t count) {
+  size_t glyphLen = strlen(glyph);
+  size_t glyphColumns = displayWidth(glyph);
+  for (size_t i = 0; i < count; i++) {
+    appendBytes(glyph, glyphLen, glyphColumns);
+  }
+}
+
+void FrameRenderer::padTo(size_t column) {
+  static const char spaces[] = "                                ";
+  while (col < column) {
+    size_t n = column - col;
+    if (n > sizeof(spaces) - 1) n = sizeof(spaces) - 1;
+    appendBytes(spaces, n, n);
+  }
+}
+
+void FrameRenderer::appendLine(const char* text) {
+  append(text);
+  appendBytes("\r\n", 2, 0);
+  col = 0;
+}
+
+void FrameRenderer::flush() {
+  if (len > 0) out.write((const uint8_t*)buffer, len);
+  len = 0;
+  col = 0;
+}
@@ -0,0 +1,208 @@
+/**
+ * Character-grid Displays - implementation
+ *
+ * See grid_display.h for an overview.
+ */
+
+#include "grid_display.h"
+
+#include "wall_clock.h"
+
+// Panels this tall get a footer row (fetch time, trains not shown)
+static const uint8_t FOOTER_MIN_ROWS = 6;
+
+// The panels the firmware drives, checked when it is built: a 20x4 LCD,
+// and a 320x240 TFT at text size 1
+static_assert(!gridLayout(20).wide && gridLayout(20).destinationWidth >= 10,
+              "20-column layout leaves too little room for destinations");
+static_assert(gridLayout(53).wide && gridLayout(53).destinationWidth >= 20,
+              "53-column layout leaves too little room for destinations");
+
+void CellGrid::resize(uint8_t columns, uint8_t rows) {
+  columnCount = columns < GRID_MAX_COLUMNS ? columns : GRID_MAX_COLUMNS;
+  rowCount = rows < GRID_MAX_ROWS ? rows : GRID_MAX_ROWS;
+  clear();
+}
+
+void CellGrid::clear() {
+  memset(cells, ' ', sizeof(cells));
+}
+
+void CellGrid::put(uint8_t column, uint8_t row, const char* text,
+                   uint8_t width, bool alignRight) {
+  if (row >= rowCount || column >= columnCount) return;
+  if (width > columnCount - column) width = columnCount - column;
+
+  // One cell per character; anything outside printable ASCII (including
+  // each multi-byte UTF-8 sequence) becomes a single '?'
+  char glyphs[GRID_MAX_COLUMNS];
+  uint8_t length = 0;
+  for (const char* p = text; *p != '\0' && length < width; p++) {
+    uint8_t c = (uint8_t)*p;
+    if ((c & 0xC0) == 0x80) continue;
+    glyphs[length++] = c >= 0x20 && c < 0x7F ? (char)c : '?';
+  }
+
+  char* cell = &cells[row][column];
+  memset(cell, ' ', width);
+  memcpy(cell + (alignRight ? width - length : 0), glyphs, length);
+}
+
+void GridDisplay::setGeometry(uint8_t columns, uint8_t rows) {
+  next.resize(columns, rows);
+  shown.resize(columns, rows);
+  layout = gridLayout(next.columns());
+}
+
+uint8_t GridDisplay::trainRows() const {
+  uint8_t rows = next.rows();
+  if (rows < 2) return 0;
+  return rows - 1 - (rows >= FOOTER_MIN_ROWS ? 1 : 0); // Less header, footer
+}
+
+void GridDisplay::drawBoard(const TrainTable& table, const TrainTable*) {
+  compose(table);
+  present();
+}
+
+void GridDisplay::tick(const TrainTable& table, bool) {
+  // Composing is cheap, and present() sends nothing unless a cell (a
+  // countdown or the clock) changed
+  compose(table);
+  present();
+}
+
+/**
+ * Lay out the board for this table into `next`
+ */
+void GridDisplay::compose(const TrainTable& table) {
+  uint8_t columns = next.columns();
+  uint8_t rows = next.rows();
+  if (columns == 0 || rows == 0) return;
+
+  next.clear();
+  time_t now = time(nullptr);
+  char text[24];
+
+  // Header: what is shown, and the time of day
+  if (timeSynced()) {
+    formatLocalTime(now, "%H:%M", text, sizeof(text));
+  } else {
+    snprintf(text, sizeof(text), "--:--");
+  }
+  next.put(layout.clockAt, 0, text, GRID_TIME_WIDTH);
+  const char* title = table.stale ? "Saved board"
+                      : table.incomplete ? (layout.longTitle ? "Partial board" : "Partial")
+                      : layout.longTitle ? "Metro-North" : "MNR";
+  next.put(0, 0, title, layout.titleWidth);
+
+  bool footer = rows >= FOOTER_MIN_ROWS;
+
+  if (!table.hasTrainList) {
+    next.put(0, 1, "No train data", columns);
+  } else if (table.count == 0) {
+    next.put(0, 1, "No upcoming trains", columns);
+  }
+
+  uint8_t room = trainRows();
+  uint8_t listed = table.count < room ? table.count : room;
+  for (uint8_t i = 0; i < listed; i++) {
+    composeTrain(table, i, 1 + i, now);
+  }
+
+  if (!footer) return;
+
+  if (table.stale) {
+    formatLocalTime(table.updatedAt, "Saved %m-%d %H:%M", text, sizeof(text),
+                    "Saved board");
+  } else {
+    formatLocalTime(table.updatedAt, "Updated %H:%M", text, sizeof(text),
+                    "Updated");
+  }
+  next.put(0, rows - 1, text, columns);
+
+  unsigned hidden = table.count - listed + table.droppedTrains;
+  if (hidden > 0) {
+    snprintf(text, sizeof(text), "+%u more", hidden);
+    next.put(layout.moreAt, rows - 1, text, GRID_MORE_WIDTH, true);
+  }
+}
+
+/**
+ * One train's row, into the slots of the panel's layout: destination,
+ * track and countdown (plus departure time and status on wide panels)
+ */
+void GridDisplay::composeTrain(const TrainTable& table, uint8_t index,
+                               uint8_t row, time_t now) {
+  const Train& train = table.trains[index];
+  char text[24];
+
+  if (timeSynced()) {
+    formatShortCountdown(train.arrival_time, now, text, sizeof(text));
+  } else {
+    formatLocalTime(train.arrival_time, "%H:%M", text, sizeof(text), "--");
+  }
+  next.put(layout.countdownAt, row, text, GRID_COUNTDOWN_WIDTH, true);
+  next.put(layout.trackAt, row, train.track, GRID_TRACK_WIDTH, true);
+  next.put(layout.destinationAt, row, table.text(train.destination),
+           layout.destinationWidth);
+
+  if (!layout.wide) return;
+
+  formatLocalTime(train.arrival_time, "%H:%M", text, sizeof(text), "--:--");
+  next.put(layout.timeAt, row, text, GRID_TIME_WIDTH);
+
+  // The delay keeps the end of the slot and the status text is clipped
+  // before it, so "+120" never shows as "+1"
+  uint8_t delayWidth = 0;
+  if (train.delay_seconds > 0) {
+    int length = snprintf(text, sizeof(text), " +%ld", (long)(train.delay_seconds / 60));
+    delayWidth = length < GRID_STATUS_WIDTH ? (uint8_t)length : GRID_STATUS_WIDTH;
+    next.put(layout.statusAt + GRID_STATUS_WIDTH - delayWidth, row, text,
+             delayWidth, true);
+  }
+  next.put(layout.statusAt, row, table.text(train.status),
+           GRID_STATUS_WIDTH - delayWidth);
+}
+
+/**
+ * Send the cells of `next` that differ from `shown`, row by row
+ */
+void GridDisplay::present() {
+  uint8_t columns = next.columns();
+  bool drawn = false;
+
+  for (uint8_t row = 0; row < next.rows(); row++) {
+    const char* want = next.row(row);
+    const char* have = shown.row(row);
+
+    uint8_t column = 0;
+    while (column < columns) {
+      if (want[column] == have[column]) {
+        column++;
+        continue;
+      }
+
+      // Extend the run over changed cells, and over short gaps of
+      // unchanged ones when another change follows
+      uint8_t start = column;
+      uint8_t end = column + 1;
+      for (uint8_t scan = end; scan < columns; scan++) {
+        if (want[scan] != have[scan]) {
+          end = scan + 1;
+        } else if (scan - end >= mergeGap) {
+          break;
+        }
+      }
+
+      drawRun(start, row, want + start, end - start);
+      drawn = true;
+      column = end;
+    }
+  }
+
+  if (drawn) {
+    shown = next;
+    endFrame();
+  }
+}
@@ -0,0 +1,241 @@
+/**
+ * Host Name Cache - implementation
+ *
+ * See host_resolver.h for an overview.
+ *
+ * A lookup is one A query (recursion desired) to the first DNS server, then
+ * the second; the answer's TTL is the smallest along its CNAME chain,
+ * clamped to MIN_TTL_MS..MAX_TTL_MS. Names that do not come back from the
+ * servers (.local, or servers that do not answer plain queries) go to
+ * lwIP's resolver and are kept for FALLBACK_TTL_MS.
+ */
+
+#include "host_resolver.h"
+
+#include <WiFi.h>
+#include <errno.h>
+#include <esp_random.h>
+#include <lwip/sockets.h>
+#include <string.h>
+#include <strings.h>
+
+static const uint8_t CACHE_SIZE = 4;
+static const unsigned long QUERY_TIMEOUT_MS = 1500;
+static const unsigned long MIN_TTL_MS = 30000;
+static const unsigned long MAX_TTL_MS = 24 * 3600000UL;
+static const unsigned long FALLBACK_TTL_MS = 120000; // mDNS's usual TTL
+static const unsigned long STALE_MS = 3600000;       // Served after expiry
+static const uint16_t DNS_PORT = 53;
+
+// Largest plain DNS message over UDP
+static const size_t MESSAGE_BYTES = 512;
+
+struct CachedHost {
+  char name[64];
+  IPAddress address;
+  unsigned long resolvedAt; // millis()
+  unsigned long ttlMs;
+  bool used;
+};
+
+static CachedHost cache[CACHE_SIZE];
+
+static CachedHost* findCached(const char* host) {
+  for (CachedHost& entry : cache) {
+    if (entry.used && strcasecmp(entry.name, host) == 0) return &entry;
+  }
+  return nullptr;
+}
+
+/**
+ * Entry for `host`: its own, else an unused one, else the oldest
+ */
+static CachedHost* slotFor(const char* host) {
+  CachedHost* slot = findCached(host);
+  if (slot != nullptr) return slot;
+  slot = &cache[0];
+  for (CachedHost& entry : cache) {
+    if (!entry.used) return &entry;
+    if (millis() - entry.resolvedAt > millis() - slot->resolvedAt) slot = &entry;
+  }
+  return slot;
+}
+
+/**
+ * Encode an A query for `host`; returns its length, or 0 if the name does
+ * not fit in a label sequence
+ */
+static size_t buildQuery(uint8_t* message, uint16_t id, const char* host) {
+  const uint8_t header[12] = {(uint8_t)(id >> 8), (uint8_t)id, 0x01, 0x00, // RD
+                              0, 1, 0, 0, 0, 0, 0, 0};                     // QDCOUNT 1
+  memcpy(message, header, sizeof(header));
+  size_t at = sizeof(header);
+
+  const char* label = host;
+  while (*label != '\0') {
+    size_t length = strcspn(label, ".");
+    if (length == 0 || length > 63 || at + length + 6 > MESSAGE_BYTES) return 0;
+    message[at++] = (uint8_t)length;
+    memcpy(message + at, label, length);
+    at += length;
+    label += length;
+    if (*label == '.') label++;
+  }
+  message[at++] = 0;
+  const uint8_t question[4] = {0, 1, 0, 1}; // QTYPE A, QCLASS IN
+  memcpy(message + at, question, sizeof(question));
+  return at + sizeof(question);
+}
+
+/**
+ * Offset just past the (possibly compressed) name at `at`, or 0
+ */
+static size_t skipName(const uint8_t* message, size_t length, size_t at) {
+  while (at < length) {
+    uint8_t size = message[at];
+    if (size == 0) return at + 1;
+    if ((size & 0xC0) == 0xC0) return at + 2 <= length ? at + 2 : 0; // Pointer
+    at += 1 + size;
+  }
+  return 0;
+}
+
+static uint16_t read16(const uint8_t* p) {
+  return (uint16_t)(p[0] << 8 | p[1]);
+}
+
+static uint32_t read32(const uint8_t* p) {
+  return (uint32_t)read16(p) << 16 | read16(p + 2);
+}
+
+/**
+ * First A record of a response to query `id`, with the TTL that applies
+ */
+static bool parseResponse(const uint8_t* message, size_t length, uint16_t id,
+                          IPAddress& address, uint32_t& ttl) {
+  if (length < 12 || read16(message) != id || !(message[2] & 0x80) ||
+      (message[3] & 0x0F) != 0) {
+    return false; // Not ours, not a response, or an error (e.g. NXDOMAIN)
+  }
+  uint16_t questions = read16(message + 4);
+  uint16_t answers = read16(message + 6);
+
+  size_t at = 12;
+  for (uint16_t i = 0; i < questions; i++) {
+    at = skipName(message, length, at);
+    if (at == 0 || at + 4 > length) return false;
+    at += 4;
+  }
+
+  ttl = UINT32_MAX;
+  for (uint16_t i = 0; i < answers; i++) {
+    at = skipName(message, length, at);
+    if (at == 0 || at + 10 > length) return false;
+    uint16_t type = read16(message + at);
+    uint16_t klass = read16(message + at + 2);
+    uint32_t recordTtl = read32(message + at + 4);
+    uint16_t dataLength = read16(message + at + 8);
+    at += 10;
+    if (at + dataLength > length) return false;
+
+    ttl = min(ttl, recordTtl); // CNAMEs on the way count as well
+    if (type == 1 && klass == 1 && dataLength == 4) {
+      address = IPAddress(message[at], message[at + 1], message[at + 2], message[at + 3]);
+      return true;
+    }
+    at += dataLength;
+  }
+  return false;
+}
+
+/**
+ * Ask `server` for the A record of `host`
+ */
+static bool queryServer(IPAddress server, const char* host, IPAddress& address,
+                        uint32_t& ttl) {
+  if ((uint32_t)server == 0) return false;
+
+  uint8_t message[MESSAGE_BYTES];
+  uint16_t id = (uint16_t)esp_random();
+  size_t length = buildQuery(message, id, host);
+  if (length == 0) return false;
+
+  int fd = lwip_socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  if (fd < 0) return false;
+
+  struct sockaddr_in to = {};
+  to.sin_family = AF_INET;
+  to.sin_port = htons(DNS_PORT);
+  to.sin_addr.s_addr = (uint32_t)server;
+  bool found = false;
+  if (lwip_sendto(fd, message, length, 0, (struct sockaddr*)&to, sizeof(to)) ==
+      (int)length) {
+    // Skip stray datagrams until ours arrives or time is up
+    unsigned long start = millis();
+    while (!found && millis() - start < QUERY_TIMEOUT_MS) {
+      unsigned long left = QUERY_TIMEOUT_MS - (millis() - start);
+      fd_set readable;
+      FD_ZERO(&readable);
+      FD_SET(fd, &readable);
+      struct timeval wait = {(long)(left / 1000), (long)(left % 1000 * 1000)};
+      if (lwip_select(fd + 1, &readable, nullptr, nullptr, &wait) <= 0) break;
+
+      int received = lwip_recv(fd, message, sizeof(message), 0);
+      if (received <= 0) break;
+      found = parseResponse(message, received, id, address, ttl);
+    }
+  }
+  lwip_close(fd);
+  return found;
+}
+
+bool resolveHost(const char* host, IPAddress& address) {
+  IPAddress literal;
+  if (literal.fromString(host)) {
+    address = literal;
+    return true;
+  }
+
+  CachedHost* cached = findCached(host);
+  if (cached != nullptr && millis() - cached->resolvedAt < cached->ttlMs) {
+    address = cached->address;
+    return true;
+  }
+
+  // mDNS names are not for the DNS servers to answer
+  size_t length = strlen(host);
+  bool multicast = length > 6 && strcasecmp(host + length - 6, ".local") == 0;
+
+  IPAddress found;
+  uint32_t ttl = 0;
+  unsigned long ttlMs;
+  if (!multicast && (queryServer(WiFi.dnsIP(0), host, found, ttl) ||
+                     queryServer(WiFi.dnsIP(1), host, found, ttl))) {
+    ttlMs = ttl >= MAX_TTL_MS / 1000 ? MAX_TTL_MS : max(ttl * 1000UL, MIN_TTL_MS);
+  } else if (WiFi.hostByName(host, found) == 1) {
+    ttlMs = FALLBACK_TTL_MS;
+  } else {
+    // Keep using what we had rather than nothing
+    if (cached != nullptr && millis() - cached->resolvedAt < cached->ttlMs + STALE_MS) {
+      address = cached->address;
+      return true;
+    }
+    return false;
+  }
+
+  if (length < sizeof(CachedHost::name)) {
+    CachedHost* slot = slotFor(host);
+    strcpy(slot->name, host);
+    slot->address = found;
+    slot->resolvedAt = millis();
+    slot->ttlMs = ttlMs;
+    slot->used = true;
+  }
+  address = found;
+  return true;
+}
+
+void forgetHost(const char* host) {
+  CachedHost* cached = findCached(host);
+  if (cached != nullptr) cached->used = false;
+}
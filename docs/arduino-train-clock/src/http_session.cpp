@@ -0,0 +1,681 @@
+/**
+ * Persistent HTTP/1.1 Session - implementation
+ *
+ * See http_session.h for an overview.
+ */
+
+#include "http_session.h"
+
+#include "host_resolver.h"
+#include "metrics.h"
+
+#include <ctype.h>
+#include <stdarg.h>
+#include <strings.h>
+
+/**
+ * Read one CRLF-terminated line from the client, without the terminator
+ *
+ * Lines longer than the buffer are truncated but still consumed.
+ * Returns the stored length, or -1 if the connection closed or timed out
+ * before a full line arrived.
+ */
+static int readClientLine(Client* client, char* buffer, size_t size,
+                          unsigned long timeoutMs) {
+  size_t len = 0;
+  unsigned long start = millis();
+
+  while (true) {
+    int c = client->read();
+    if (c < 0) {
+      if (!client->connected() && client->available() <= 0) return -1;
+      if (millis() - start >= timeoutMs) return -1;
+      delay(1);
+      continue;
+    }
+
+    if (c == '\n') break;
+    if (c != '\r' && len + 1 < size) buffer[len++] = (char)c;
+  }
+
+  buffer[len] = '\0';
+  return (int)len;
+}
+
+/**
+ * True once millis() has reached `deadlineMs` (if `bounded`)
+ */
+static bool reached(bool bounded, unsigned long deadlineMs) {
+  return bounded && (long)(millis() - deadlineMs) >= 0;
+}
+
+/**
+ * `budgetMs`, cut to what is left until `deadlineMs` (if `bounded`)
+ */
+static unsigned long within(unsigned long budgetMs, bool bounded,
+                            unsigned long deadlineMs) {
+  if (!bounded) return budgetMs;
+  long left = (long)(deadlineMs - millis());
+  if (left <= 0) return 0;
+  return (unsigned long)left < budgetMs ? (unsigned long)left : budgetMs;
+}
+
+// Request text around its fields: request line, header names, CRLFs, a
+// ":65535" port and the blank line
+const size_t REQUEST_FRAMING_BYTES = 192;
+
+/**
+ * Append printf-style text at buffer[len], advancing len
+ *
+ * Returns false (leaving len unchanged) if the text does not fit.
+ */
+static bool appendf(char* buffer, size_t size, size_t& len,
+                    const char* format, ...) {
+  va_list args;
+  va_start(args, format);
+  int n = vsnprintf(buffer + len, size - len, format, args);
+  va_end(args);
+
+  if (n < 0 || len + n >= size) {
+    buffer[len] = '\0';
+    return false;
+  }
+  len += n;
+  return true;
+}
+
+/**
+ * Copy a header value into a fixed buffer, or clear it if it does not fit
+ */
+static void copyHeaderValue(char* dest, size_t size, const char* value) {
+  if (strlen(value) < size) {
+    strcpy(dest, value);
+  } else {
+    dest[0] = '\0';
+  }
+}
+
+/**
+ * Return the value of "Name: value" if the line carries header `name`
+ */
+static const char* headerValue(const char* line, const char* name) {
+  size_t nameLen = strlen(name);
+  if (strncasecmp(line, name, nameLen) != 0 || line[nameLen] != ':') {
+    return nullptr;
+  }
+
+  const char* value = line + nameLen + 1;
+  while (*value == ' ' || *value == '\t') value++;
+  return value;
+}
+
+// ---------------------------------------------------------------------------
+// HttpBodyStream
+// ---------------------------------------------------------------------------
+
+void HttpBodyStream::reset(Client* client, long contentLength, bool chunked,
+                           unsigned long timeoutMs) {
+  this->client = client;
+  this->chunked = chunked;
+  this->timeoutMs = timeoutMs;
+  peeked = -1;
+  chunkOpen = false;
+  expired = false;
+
+  if (client == nullptr) {
+    remaining = 0;
+    untilClose = false;
+    done = true;
+  } else if (chunked) {
+    remaining = 0;
+    untilClose = false;
+    done = false;
+  } else if (contentLength >= 0) {
+    remaining = contentLength;
+    untilClose = false;
+    done = (contentLength == 0);
+  } else {
+    remaining = 0;
+    untilClose = true;
+    done = false;
+  }
+}
+
+void HttpBodyStream::setDeadline(bool bounded, unsigned long deadlineMs) {
+  this->bounded = bounded;
+  this->deadlineMs = deadlineMs;
+}
+
+unsigned long HttpBodyStream::waitLimit() const {
+  return within(timeoutMs, bounded, deadlineMs);
+}
+
+/**
+ * Advance to the next chunk of a chunked body
+ *
+ * Returns false at the end of the body (done is set) or on a framing or
+ * connection error (done stays false).
+ */
+bool HttpBodyStream::nextChunk() {
+  if (!chunked) {
+    done = true;
+    return false;
+  }
+
+  char line[32];
+
+  // Each chunk's data is followed by CRLF
+  if (chunkOpen && readClientLine(client, line, sizeof(line), waitLimit()) != 0) {
+    return false;
+  }
+
+  if (readClientLine(client, line, sizeof(line), waitLimit()) < 0) return false;
+
+  char* end;
+  long size = strtol(line, &end, 16);
+  if (end == line || size < 0) return false;
+
+  if (size == 0) {
+    // Skip optional trailer headers up to the terminating empty line
+    int len;
+    while ((len = readClientLine(client, line, sizeof(line), waitLimit())) > 0) {
+    }
+    if (len < 0) return false;
+    done = true;
+    return false;
+  }
+
+  remaining = size;
+  chunkOpen = true;
+  return true;
+}
+
+size_t HttpBodyStream::readBytes(char* buffer, size_t length) {
+  size_t total = 0;
+
+  if (peeked >= 0 && length > 0) {
+    buffer[total++] = (char)peeked;
+    peeked = -1;
+  }
+
+  unsigned long start = millis();
+
+  while (total < length && !done) {
+    if (!untilClose && remaining == 0) {
+      if (!nextChunk()) {
+        // A chunk header that did not arrive in time, as below
+        if (!done && client->connected()) expired = true;
+        break;
+      }
+      continue;
+    }
+
+    size_t want = length - total;
+    if (!untilClose && (long)want > remaining) want = (size_t)remaining;
+
+    int n = client->available() > 0
+        ? client->read((uint8_t*)buffer + total, want)
+        : 0;
+
+    if (n > 0) {
+      total += n;
+      if (!untilClose) {
+        remaining -= n;
+        if (remaining == 0 && !chunked) done = true;
+      }
+      start = millis();
+      continue;
+    }
+
+    if (!client->connected()) {
+      // Only an unframed body may legitimately end with the connection
+      if (untilClose) done = true;
+      break;
+    }
+    if (millis() - start >= timeoutMs || reached(bounded, deadlineMs)) {
+      expired = true;
+      break;
+    }
+
+    // Only the slow path is timed: bytes already buffered cost nothing
+    unsigned long waitStart = micros();
+    delay(1);
+    waitUs += micros() - waitStart;
+  }
+
+  return total;
+}
+
+int HttpBodyStream::read() {
+  char c;
+  return readBytes(&c, 1) == 1 ? (uint8_t)c : -1;
+}
+
+int HttpBodyStream::peek() {
+  if (peeked < 0) peeked = read();
+  return peeked;
+}
+
+int HttpBodyStream::available() {
+  int pending = (peeked >= 0) ? 1 : 0;
+  if (done || client == nullptr) return pending;
+
+  // Between chunks, step over a chunk header that has already arrived, so
+  // a long-lived chunked body (an event stream) reports its next data
+  if (chunked && remaining == 0 && client->available() > 0 && !nextChunk()) {
+    return pending;
+  }
+
+  int avail = client->available();
+  if (!untilClose && avail > remaining) avail = (int)remaining;
+  return pending + (avail > 0 ? avail : 0);
+}
+
+bool HttpBodyStream::drain() {
+  if (untilClose) return false;
+
+  char scratch[64];
+  while (!done) {
+    if (readBytes(scratch, sizeof(scratch)) == 0 && !done) return false;
+  }
+  return true;
+}
+
+// ---------------------------------------------------------------------------
+// HttpSession
+// ---------------------------------------------------------------------------
+
+bool HttpSession::begin(const char* url) {
+  close();
+  configured = false;
+
+  const char* p;
+  if (strncmp(url, "http://", 7) == 0) {
+    secure = false;
+    port = 80;
+    p = url + 7;
+#if HTTP_SESSION_TLS
+  } else if (strncmp(url, "https://", 8) == 0) {
+    secure = true;
+    port = 443;
+    p = url + 8;
+#endif
+  } else {
+    return false;
+  }
+
+  size_t hostLen = strcspn(p, ":/?");
+  if (hostLen == 0 || hostLen >= sizeof(host)) return false;
+  memcpy(host, p, hostLen);
+  host[hostLen] = '\0';
+  p += hostLen;
+
+  if (*p == ':') {
+    char* end;
+    long value = strtol(p + 1, &end, 10);
+    if (end == p + 1 || value <= 0 || value > 65535) return false;
+    port = (uint16_t)value;
+    p = end;
+  }
+
+  if (*p == '\0') {
+    strcpy(path, "/");
+  } else if (*p == '/' && strlen(p) < sizeof(path)) {
+    strcpy(path, p);
+  } else if (*p == '?' && strlen(p) + 1 < sizeof(path)) {
+    path[0] = '/';
+    strcpy(path + 1, p);
+  } else {
+    return false;
+  }
+
+  configured = true;
+  return true;
+}
+
+bool HttpSession::addHeader(const char* name, const char* value) {
+  size_t used = strlen(extraHeaders);
+  int len = snprintf(extraHeaders + used, sizeof(extraHeaders) - used,
+                     "%s: %s\r\n", name, value);
+  if (len < 0 || used + len >= sizeof(extraHeaders)) {
+    extraHeaders[used] = '\0';
+    return false;
+  }
+  return true;
+}
+
+void HttpSession::setAccept(const char* mediaTypes) {
+  copyHeaderValue(accept, sizeof(accept), mediaTypes);
+}
+
+void HttpSession::setAcceptEncoding(const char* codings) {
+  copyHeaderValue(acceptEncoding, sizeof(acceptEncoding), codings);
+}
+
+void HttpSession::setTimeouts(unsigned long connectMs, unsigned long firstByteMs,
+                              unsigned long readMs) {
+  this->connectMs = connectMs;
+  this->firstByteMs = firstByteMs;
+  this->readMs = readMs;
+}
+
+void HttpSession::setDeadline(unsigned long deadlineMs) {
+  bounded = true;
+  this->deadlineMs = deadlineMs;
+  bodyStream.setDeadline(true, deadlineMs);
+}
+
+void HttpSession::clearDeadline() {
+  bounded = false;
+  bodyStream.setDeadline(false, 0);
+}
+
+bool HttpSession::pastDeadline() const {
+  return reached(bounded, deadlineMs);
+}
+
+/**
+ * Budget of a phase, cut to what is left of the deadline
+ */
+unsigned long HttpSession::budget(unsigned long phaseMs) const {
+  return within(phaseMs, bounded, deadlineMs);
+}
+
+bool HttpSession::connect() {
+  // Resolve first, so the lookup is timed on its own
+  IPAddress address;
+  unsigned long start = micros();
+  bool resolved = resolveHost(host, address);
+  recordPhase(PHASE_DNS, micros() - start);
+  if (!resolved) {
+    connected = false;
+    return false;
+  }
+
+  bool ok;
+  start = micros();
+#if HTTP_SESSION_TLS
+  if (secure) {
+    // The name is for SNI and the certificate check. TCP connect and
+    // handshake happen in one call, so both are timed as the TLS phase
+    // (which drops once the server resumes the saved session).
+    client = &tlsClient;
+    ok = tlsClient.connect(address, port, host, (int32_t)budget(connectMs));
+    if (ok) recordPhase(PHASE_TLS, micros() - start);
+  } else
+#endif
+  {
+    client = &plainClient;
+    ok = plainClient.connect(address, port, (int32_t)budget(connectMs));
+    if (ok) {
+      recordPhase(PHASE_CONNECT, micros() - start);
+      plainClient.setNoDelay(true);
+    }
+  }
+  if (ok) {
+    countEvent(COUNTER_HTTP_CONNECTS);
+  } else {
+    forgetHost(host); // The server may have moved: look it up again
+  }
+
+  connected = ok;
+  return ok;
+}
+
+void HttpSession::close() {
+  if (client != nullptr) client->stop();
+  connected = false;
+  keepAlive = false;
+  bodyStream.reset(nullptr, 0, false, readMs);
+  requestsSent = false;
+}
+
+/**
+ * Write request `index`; returns 0, or HTTP_SESSION_ERROR_SEND /
+ * HTTP_SESSION_ERROR_REQUEST_TOO_LONG
+ */
+int HttpSession::sendRequest(uint8_t index) {
+  const char* query = queries[index];
+  const HttpValidators& cached = *validators[index];
+
+  // Every field at its longest fits, so only an over-long query can fail
+  char request[sizeof(path) + HTTP_SESSION_QUERY_CAPACITY + sizeof(host) +
+               sizeof(accept) + sizeof(acceptEncoding) + sizeof(cached.etag) +
+               sizeof(cached.lastModified) + sizeof(extraHeaders) +
+               REQUEST_FRAMING_BYTES];
+  size_t len = 0;
+
+  bool defaultPort = (port == (secure ? 443 : 80));
+  bool ok;
+  if (query != nullptr && query[0] != '\0') {
+    const char* separator = strchr(path, '?') != nullptr ? "&" : "?";
+    ok = appendf(request, sizeof(request), len, "GET %s%s%s HTTP/1.1\r\n",
+                 path, separator, query);
+  } else {
+    ok = appendf(request, sizeof(request), len, "GET %s HTTP/1.1\r\n", path);
+  }
+  if (defaultPort) {
+    ok = ok && appendf(request, sizeof(request), len, "Host: %s\r\n", host);
+  } else {
+    ok = ok && appendf(request, sizeof(request), len, "Host: %s:%u\r\n", host, port);
+  }
+  ok = ok && appendf(request, sizeof(request), len,
+                     "User-Agent: MNR-Train-Clock\r\n"
+                     "Accept: %s\r\n"
+                     "Connection: keep-alive\r\n",
+                     accept);
+
+  if (acceptEncoding[0] != '\0') {
+    ok = ok && appendf(request, sizeof(request), len,
+                       "Accept-Encoding: %s\r\n", acceptEncoding);
+  }
+
+  // Conditional GET: let the server answer 304 if nothing changed
+  if (cached.etag[0] != '\0') {
+    ok = ok && appendf(request, sizeof(request), len, "If-None-Match: %s\r\n",
+                       cached.etag);
+  }
+  if (cached.lastModified[0] != '\0') {
+    ok = ok && appendf(request, sizeof(request), len,
+                       "If-Modified-Since: %s\r\n", cached.lastModified);
+  }
+
+  ok = ok && appendf(request, sizeof(request), len, "%s\r\n", extraHeaders);
+  if (!ok) return HTTP_SESSION_ERROR_REQUEST_TOO_LONG;
+
+  // One write, so the request leaves in a single segment
+  if (client->write((const uint8_t*)request, len) != len) {
+    return HTTP_SESSION_ERROR_SEND;
+  }
+  return 0;
+}
+
+void HttpSession::acceptValidators() {
+  if (validators == nullptr) return;
+  HttpValidators& cached = *validators[responseIndex];
+  strcpy(cached.etag, responseEtag);
+  strcpy(cached.lastModified, responseLastModified);
+}
+
+
+int HttpSession::readLine(char* buffer, size_t size) {
+  return readClientLine(client, buffer, size, budget(readMs));
+}
+
+int HttpSession::readResponseHead() {
+  char line[256];
+
+  // The status line gets the first-byte budget: the server may still be
+  // working on the answer
+  unsigned long start = micros();
+  if (readClientLine(client, line, sizeof(line), budget(firstByteMs)) < 0) {
+    return HTTP_SESSION_ERROR_NO_RESPONSE;
+  }
+  recordPhase(PHASE_FIRST_BYTE, micros() - start);
+
+  // Status line: HTTP/1.x NNN Reason
+  int minor = 0;
+  int status = 0;
+  if (sscanf(line, "HTTP/1.%d %d", &minor, &status) != 2 || status < 100) {
+    return HTTP_SESSION_ERROR_BAD_RESPONSE;
+  }
+
+  long contentLength = -1;
+  bool chunked = false;
+  keepAlive = (minor >= 1);
+  responseEtag[0] = '\0';
+  responseLastModified[0] = '\0';
+  responseContentType[0] = '\0';
+  responseContentEncoding[0] = '\0';
+  responseMaxAge = -1;
+  responseRetryAfter = -1;
+
+  int len;
+  while ((len = readLine(line, sizeof(line))) > 0) {
+    const char* value;
+    if ((value = headerValue(line, "Content-Length")) != nullptr) {
+      contentLength = strtol(value, nullptr, 10);
+    } else if ((value = headerValue(line, "Transfer-Encoding")) != nullptr) {
+      chunked = (strcasestr(value, "chunked") != nullptr);
+    } else if ((value = headerValue(line, "Connection")) != nullptr) {
+      if (strcasestr(value, "close") != nullptr) keepAlive = false;
+      if (strcasestr(value, "keep-alive") != nullptr) keepAlive = true;
+    } else if ((value = headerValue(line, "ETag")) != nullptr) {
+      copyHeaderValue(responseEtag, sizeof(responseEtag), value);
+    } else if ((value = headerValue(line, "Last-Modified")) != nullptr) {
+      copyHeaderValue(responseLastModified, sizeof(responseLastModified), value);
+    } else if ((value = headerValue(line, "Content-Type")) != nullptr) {
+      copyHeaderValue(responseContentType, sizeof(responseContentType), value);
+    } else if ((value = headerValue(line, "Content-Encoding")) != nullptr) {
+      copyHeaderValue(responseContentEncoding, sizeof(responseContentEncoding), value);
+    } else if ((value = headerValue(line, "Cache-Control")) != nullptr) {
+      const char* maxAge = strcasestr(value, "max-age=");
+      if (maxAge != nullptr) responseMaxAge = strtol(maxAge + 8, nullptr, 10);
+    } else if ((value = headerValue(line, "Retry-After")) != nullptr) {
+      if (isdigit((unsigned char)value[0])) {
+        responseRetryAfter = strtol(value, nullptr, 10);
+      }
+    }
+  }
+  if (len < 0) return HTTP_SESSION_ERROR_BAD_RESPONSE;
+
+  // These responses never carry a body, whatever the headers say
+  if (status == HTTP_CODE_NO_CONTENT || status == HTTP_CODE_NOT_MODIFIED ||
+      status < 200) {
+    contentLength = 0;
+    chunked = false;
+  }
+
+  bodyStream.reset(client, chunked ? -1 : contentLength, chunked, readMs);
+  return status;
+}
+
+int HttpSession::get(const char* query) {
+  singleQuery = query;
+  pipeline(&singleQuery, &singleValidators, 1);
+  return nextResponse();
+}
+
+void HttpSession::pipeline(const char* const* queries,
+                           HttpValidators* const* validators, uint8_t count) {
+  // Never start requests on top of an unfinished response
+  if (connected && !bodyStream.complete()) end();
+
+  this->queries = queries;
+  this->validators = validators;
+  queryCount = count;
+  nextIndex = 0;
+  requestsSent = false;
+  pipelineError = 0;
+}
+
+int HttpSession::nextResponse() {
+  // Nothing of the previous response applies to this one
+  responseMaxAge = -1;
+  responseRetryAfter = -1;
+
+  if (!configured) return HTTP_SESSION_ERROR_BAD_URL;
+  if (pipelineError < 0) return pipelineError;
+  if (nextIndex >= queryCount) return HTTP_SESSION_ERROR_NO_RESPONSE;
+  if (pastDeadline()) {
+    pipelineError = HTTP_SESSION_ERROR_DEADLINE;
+    return pipelineError;
+  }
+
+  // Skip whatever the caller left of the previous body
+  if (connected && !bodyStream.complete()) end();
+
+  int status = HTTP_SESSION_ERROR_NO_RESPONSE;
+  for (int attempt = 0; attempt < 2; attempt++) {
+    if (!requestsSent) {
+      // Leftover bytes mean the connection is out of sync; start over
+      reused = connected && client->connected() && client->available() == 0;
+
+      if (!reused) {
+        close();
+        if (!connect()) {
+          status = pastDeadline() ? HTTP_SESSION_ERROR_DEADLINE
+                                  : HTTP_SESSION_ERROR_CONNECT;
+          break;
+        }
+      }
+
+      // Every outstanding request goes out before the first answer is
+      // read: the server works through them while responses stream back
+      int sent = 0;
+      for (uint8_t i = nextIndex; i < queryCount && sent == 0; i++) {
+        sent = sendRequest(i);
+      }
+      if (sent < 0) {
+        close();
+        status = sent;
+        // A request that does not fit will not fit on a new connection
+        if (reused && sent == HTTP_SESSION_ERROR_SEND) continue;
+        break;
+      }
+      requestsSent = true;
+    }
+
+    responseIndex = nextIndex;
+    status = readResponseHead();
+    if (status >= 0) {
+      nextIndex++;
+      return status;
+    }
+
+    close();
+    if (pastDeadline()) {
+      status = HTTP_SESSION_ERROR_DEADLINE;
+      break;
+    }
+    // The server may have dropped the idle connection just as we sent
+    if (!(reused && status == HTTP_SESSION_ERROR_NO_RESPONSE)) break;
+  }
+
+  pipelineError = status;
+  return status;
+}
+
+void HttpSession::end() {
+  if (!connected) return;
+
+  bool clean = bodyStream.drain();
+  if (!clean || !keepAlive) {
+    close();
+  } else {
+    bodyStream.reset(nullptr, 0, false, readMs);
+  }
+}
+
+const char* HttpSession::errorToString(int error) {
+  switch (error) {
+    case HTTP_SESSION_ERROR_BAD_URL:          return "invalid endpoint URL";
+    case HTTP_SESSION_ERROR_CONNECT:          return "connection failed";
+    case HTTP_SESSION_ERROR_SEND:             return "failed to send request";
+    case HTTP_SESSION_ERROR_NO_RESPONSE:      return "no response";
+    case HTTP_SESSION_ERROR_BAD_RESPONSE:     return "malformed response";
+    case HTTP_SESSION_ERROR_DEADLINE:         return "fetch deadline passed";
+    case HTTP_SESSION_ERROR_REQUEST_TOO_LONG: return "request too long";
+    default:                                  return "unknown error";
+  }
+}
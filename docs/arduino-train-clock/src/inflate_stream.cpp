@@ -0,0 +1,201 @@
+/**
+ * Streaming gzip / deflate Decoder - implementation
+ *
+ * See inflate_stream.h for an overview.
+ */
+
+#include "inflate_stream.h"
+
+// gzip header flags (RFC 1952, section 2.3.1)
+static const uint8_t GZIP_FHCRC = 0x02;
+static const uint8_t GZIP_FEXTRA = 0x04;
+static const uint8_t GZIP_FNAME = 0x08;
+static const uint8_t GZIP_FCOMMENT = 0x10;
+
+void InflateStream::begin(Stream& source, InflateFormat format) {
+  this->source = &source;
+  this->format = format;
+  headerDone = false;
+  finished = false;
+  sourceDone = false;
+  error = false;
+
+  tinfl_init(&inflator);
+  windowPos = 0;
+  outStart = 0;
+  outEnd = 0;
+  totalOut = 0;
+  inputPos = 0;
+  inputLen = 0;
+}
+
+/**
+ * Read exactly count compressed-stream bytes (buffered input first)
+ */
+bool InflateStream::readInput(uint8_t* dest, size_t count) {
+  while (count > 0) {
+    if (inputPos < inputLen) {
+      size_t n = inputLen - inputPos;
+      if (n > count) n = count;
+      if (dest != nullptr) {
+        memcpy(dest, input + inputPos, n);
+        dest += n;
+      }
+      inputPos += n;
+      count -= n;
+      continue;
+    }
+
+    inputLen = source->readBytes((char*)input, sizeof(input));
+    inputPos = 0;
+    if (inputLen == 0) {
+      sourceDone = true;
+      return false;
+    }
+  }
+  return true;
+}
+
+bool InflateStream::skipZeroTerminated() {
+  uint8_t c;
+  do {
+    if (!readInput(&c, 1)) return false;
+  } while (c != 0);
+  return true;
+}
+
+bool InflateStream::readHeader() {
+  if (format == INFLATE_ZLIB) {
+    uint8_t header[2];
+    if (!readInput(header, 2)) return false;
+
+    // CM must be deflate, no preset dictionary, valid check bits, and a
+    // window that fits ours
+    unsigned windowBits = (header[0] >> 4) + 8;
+    return (header[0] & 0x0F) == 8 && (header[1] & 0x20) == 0 &&
+           ((header[0] << 8) | header[1]) % 31 == 0 &&
+           windowBits <= INFLATE_WINDOW_BITS;
+  }
+
+  // ID1 ID2 CM FLG MTIME(4) XFL OS
+  uint8_t header[10];
+  if (!readInput(header, sizeof(header))) return false;
+  if (header[0] != 0x1F || header[1] != 0x8B || header[2] != 8) return false;
+
+  uint8_t flags = header[3];
+  if (flags & GZIP_FEXTRA) {
+    uint8_t len[2];
+    if (!readInput(len, 2)) return false;
+    if (!readInput(nullptr, len[0] | (len[1] << 8))) return false;
+  }
+  if ((flags & GZIP_FNAME) && !skipZeroTerminated()) return false;
+  if ((flags & GZIP_FCOMMENT) && !skipZeroTerminated()) return false;
+  if ((flags & GZIP_FHCRC) && !readInput(nullptr, 2)) return false;
+  return true;
+}
+
+/**
+ * Check the stream trailer after the last deflate block
+ *
+ * For gzip the uncompressed length (ISIZE) is compared; the checksums are
+ * not recomputed, the parser rejects corrupted text anyway.
+ */
+void InflateStream::checkTrailer() {
+  if (format == INFLATE_ZLIB) {
+    if (!readInput(nullptr, 4)) error = true; // Adler-32
+    return;
+  }
+
+  uint8_t trailer[8]; // CRC32, ISIZE
+  if (!readInput(trailer, sizeof(trailer))) {
+    error = true;
+    return;
+  }
+  uint32_t size = trailer[4] | (trailer[5] << 8) | (trailer[6] << 16) |
+                  ((uint32_t)trailer[7] << 24);
+  if (size != totalOut) error = true;
+}
+
+/**
+ * Decode the next run of output into the window
+ *
+ * Only called once everything previously decoded was handed out, since
+ * tinfl may overwrite any part of the window that is not pending.
+ */
+bool InflateStream::refill() {
+  if (error) return false;
+
+  if (!headerDone) {
+    if (!readHeader()) {
+      error = true;
+      return false;
+    }
+    headerDone = true;
+  }
+
+  while (!finished) {
+    if (inputPos == inputLen && !sourceDone) {
+      inputLen = source->readBytes((char*)input, sizeof(input));
+      inputPos = 0;
+      if (inputLen == 0) sourceDone = true;
+    }
+
+    size_t inBytes = inputLen - inputPos;
+    size_t outBytes = WINDOW_SIZE - windowPos;
+    tinfl_status status = tinfl_decompress(
+        &inflator, input + inputPos, &inBytes, window, window + windowPos,
+        &outBytes, sourceDone ? 0 : TINFL_FLAG_HAS_MORE_INPUT);
+    inputPos += inBytes;
+
+    if (outBytes > 0) {
+      outStart = windowPos;
+      outEnd = windowPos + outBytes;
+      windowPos = (windowPos + outBytes) & (WINDOW_SIZE - 1);
+      totalOut += outBytes;
+    }
+
+    if (status == TINFL_STATUS_DONE) {
+      finished = true;
+      checkTrailer();
+    } else if (status < 0 ||
+               (status == TINFL_STATUS_NEEDS_MORE_INPUT && sourceDone)) {
+      // Corrupt data, or the body ended mid-stream
+      error = true;
+      return outBytes > 0;
+    }
+
+    if (outBytes > 0) return true;
+  }
+  return false;
+}
+
+size_t InflateStream::readBytes(char* buffer, size_t length) {
+  size_t total = 0;
+
+  while (total < length) {
+    if (outStart == outEnd && !refill()) break;
+
+    size_t n = outEnd - outStart;
+    if (n > length - total) n = length - total;
+    memcpy(buffer + total, window + outStart, n);
+    outStart += n;
+    total += n;
+  }
+
+  return total;
+}
+
+int InflateStream::read() {
+  char c;
+  return readBytes(&c, 1) == 1 ? (uint8_t)c : -1;
+}
+
+int InflateStream::peek() {
+  if (outStart == outEnd && !refill()) return -1;
+  return window[outStart];
+}
+
+int InflateStream::available() {
+  if (outStart != outEnd) return (int)(outEnd - outStart);
+  return (finished || error) ? 0 : source->available() > 0;
+}
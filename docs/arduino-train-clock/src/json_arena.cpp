@@ -0,0 +1,113 @@
+/**
+ * JSON Arena Allocator - implementation
+ *
+ * See json_arena.h for an overview.
+ *
+ * Each block is preceded by its size (needed to copy it when realloc
+ * cannot grow it in place). Blocks and headers are 8-byte aligned, the
+ * strictest alignment ArduinoJson's slots need.
+ */
+
+#include "json_arena.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(ESP_PLATFORM)
+#include <esp_heap_caps.h>
+#endif
+
+static const size_t ALIGNMENT = 8;
+static const size_t HEADER_SIZE = ALIGNMENT;
+
+static size_t alignUp(size_t value) {
+  return (value + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+}
+
+bool JsonArena::begin(size_t bytes) {
+  if (region != nullptr) return true;
+
+  void* taken = nullptr;
+#if defined(ESP_PLATFORM)
+  // The access is cached, and a record's few hundred bytes stay in cache
+  taken = heap_caps_malloc(bytes + ALIGNMENT, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+  psram = taken != nullptr;
+  if (taken == nullptr) {
+    taken = heap_caps_malloc(bytes + ALIGNMENT, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  }
+#else
+  taken = malloc(bytes + ALIGNMENT);
+#endif
+  if (taken == nullptr) return false;
+
+  // Never freed: the region is the arena for the life of the program
+  region = (uint8_t*)alignUp((uintptr_t)taken);
+  size = bytes & ~(ALIGNMENT - 1);
+  reset();
+  return true;
+}
+
+void JsonArena::reset() {
+  used = 0;
+  last = 0;
+}
+
+size_t JsonArena::blockSize(size_t offset) const {
+  size_t stored;
+  memcpy(&stored, region + offset - HEADER_SIZE, sizeof(stored));
+  return stored;
+}
+
+void* JsonArena::allocate(size_t bytes) {
+  if (region == nullptr) return malloc(bytes);
+
+  size_t offset = used + HEADER_SIZE;
+  size_t end = offset + alignUp(bytes);
+  if (end > size || end < offset) {
+    failed++;
+    return nullptr;
+  }
+
+  memcpy(region + used, &bytes, sizeof(bytes));
+  last = offset;
+  used = end;
+  if (used > peak) peak = used;
+  return region + offset;
+}
+
+void JsonArena::deallocate(void* block) {
+  if (region == nullptr) {
+    free(block);
+    return;
+  }
+
+  // Only the newest block can be given back; the rest waits for reset()
+  if (last != 0 && block == region + last) {
+    used = last - HEADER_SIZE;
+    last = 0;
+  }
+}
+
+void* JsonArena::reallocate(void* block, size_t bytes) {
+  if (region == nullptr) return realloc(block, bytes);
+  if (block == nullptr) return allocate(bytes);
+
+  size_t offset = (uint8_t*)block - region;
+  if (offset == last) {
+    // The newest block grows or shrinks in place
+    size_t end = offset + alignUp(bytes);
+    if (end > size || end < offset) {
+      failed++;
+      return nullptr;
+    }
+    memcpy(region + offset - HEADER_SIZE, &bytes, sizeof(bytes));
+    used = end;
+    if (used > peak) peak = used;
+    return block;
+  }
+
+  size_t kept = blockSize(offset);
+  void* moved = allocate(bytes);
+  if (moved != nullptr) memcpy(moved, block, kept < bytes ? kept : bytes);
+  return moved;
+}
@@ -0,0 +1,47 @@
+/**
+ * HD44780 Character LCD Display - implementation
+ *
+ * See lcd_display.h for an overview.
+ */
+
+#include "display.h"
+
+#if DISPLAY_BACKEND == DISPLAY_LCD_I2C
+
+#include "lcd_display.h"
+
+#include <Wire.h>
+
+// Moving the cursor is one command byte, as expensive as writing one cell,
+// so a single unchanged cell between two changes is rewritten instead
+static const uint8_t LCD_MERGE_GAP = 1;
+
+Hd44780Display::Hd44780Display(uint8_t address, uint8_t columns, uint8_t rows)
+    : GridDisplay(LCD_MERGE_GAP), lcd(address, columns, rows),
+      address(address), columns(columns), rows(rows) {}
+
+bool Hd44780Display::begin() {
+  Wire.begin();
+
+  // The library does not report a missing backpack; ask the bus
+  Wire.beginTransmission(address);
+  if (Wire.endTransmission() != 0) return false;
+
+  lcd.init();
+  lcd.backlight();
+  lcd.clear();
+
+  setGeometry(columns, rows);
+  panelCleared();
+  return true;
+}
+
+void Hd44780Display::drawRun(uint8_t column, uint8_t row, const char* text,
+                             uint8_t length) {
+  lcd.setCursor(column, row);
+  for (uint8_t i = 0; i < length; i++) {
+    lcd.write((uint8_t)text[i]);
+  }
+}
+
+#endif // DISPLAY_BACKEND == DISPLAY_LCD_I2C
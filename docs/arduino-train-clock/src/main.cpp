@@ -2,11 +2,12 @@
  * Metro-North Railroad Train Clock
  * 
  * This Arduino sketch fetches real-time train information from the MNR GTFS-RT
- * web service and displays upcoming trains on the serial monitor.
+ * web service and displays upcoming trains on the serial monitor, or on
+ * an LCD/TFT panel (DISPLAY_BACKEND in config.h, see display.h).
  * 
  * Hardware:
  *   - Arduino Nano ESP32
- *   - Optional: LCD display (future enhancement)
+ *   - Optional: 20x4 I2C character LCD, or an SPI TFT/OLED panel
  * 
  * Setup:
  *   1. Copy config.example.h to config.h
@@ -16,28 +17,190 @@
  * 
  * Usage:
  *   - Connect via serial monitor at 115200 baud
- *   - Watch for train updates every 30 seconds
+ *   - Watch for train updates (about once a minute, faster when a train
+ *     is due or delayed); departure countdowns tick locally in between
+ *   - Type "metrics" for per-phase fetch timings, heap and WiFi health
+ *   - With the station's timetable flashed (see schedule_index.h), the
+ *     board is built from it and the server only adds delays and tracks
+ * 
+ * Tasks:
+ *   - networkTask (core 0): WiFi, HTTP fetch and parsing (or, with
+ *     PUSH_ENDPOINT set, boards pushed by the server); publishes each new
+ *     board as a TrainTable
+ *   - renderTask (core 1): picks up the newest table and draws it, so
+ *     the display never waits on the network. Only what changed is
+ *     redrawn: the trains on the serial monitor, the cells on a panel.
  */
 
 #include <WiFi.h>
-#include <HTTPClient.h>
 #include <ArduinoJson.h>
+#include <atomic>
 #include "config.h"
+#include "board_store.h"
+#include "config_defaults.h"
+#include "display.h"
+#include "http_session.h"
+#include "inflate_stream.h"
+#include "metrics.h"
+#include "metrics_server.h"
+#include "poll_scheduler.h"
+#include "power_mode.h"
+#include "push_channel.h"
+#include "query_builder.h"
+#include "retained_state.h"
+#include "schedule_index.h"
+#include "serial_display.h"
+#include "service_discovery.h"
+#include "snapshot_buffer.h"
+#include "train_decoder.h"
+#include "train_table.h"
+#include "wall_clock.h"
+#include "wifi_link.h"
+#if DISPLAY_BACKEND == DISPLAY_LCD_I2C
+#include "lcd_display.h"
+#elif DISPLAY_BACKEND == DISPLAY_TFT_SPI
+#include "tft_display.h"
+#endif
 
 // Configuration (see config.h)
 const char* ssid = WIFI_SSID;
 const char* password = WIFI_PASSWORD;
-const char* apiEndpoint = API_ENDPOINT;
+const char* apiEndpoint = API_ENDPOINT; // Or the server found (SERVICE_DISCOVERY)
+
+// Endpoint found by DNS-SD, this boot or an earlier one
+char discoveredEndpoint[160] = "";
+
+// Queries of the views merged into one board (API_VIEWS in config.h)
+const char* const apiViews[] = API_VIEWS;
+const uint8_t VIEW_COUNT = sizeof(apiViews) / sizeof(apiViews[0]);
+
+// Each view keeps a board of its own (a TrainTable, about 2 KB)
+const uint8_t MAX_VIEWS = 4;
+static_assert(VIEW_COUNT >= 1 && VIEW_COUNT <= MAX_VIEWS,
+              "API_VIEWS takes 1 to 4 queries");
+
+// Room for a view's query plus "&since=<seq>", fields=, limit= and the
+// station filters (see query_builder.h)
+const size_t QUERY_CAPACITY = HTTP_SESSION_QUERY_CAPACITY;
+
+// A train is taken off the board this many seconds after its departure
+// (with its delay), whether or not a fetch has come in since
+const time_t DEPARTED_GRACE = 60;
+
+// Budgets of a fetch: TCP connect (with the TLS handshake), time to first
+// byte, any later wait for bytes, and the whole cycle of all views. A
+// response cut off by them still shows the trains it brought.
+const unsigned long FETCH_CONNECT_MS = 5000;
+const unsigned long FETCH_FIRST_BYTE_MS = 4000;
+const unsigned long FETCH_READ_MS = 2000;
+const unsigned long FETCH_DEADLINE_MS = 8000;
+
+// How often the render task re-evaluates departure countdowns
+const unsigned long COUNTDOWN_TICK = 1000;
+
+// Task layout. The network task shares core 0 with the WiFi stack; the
+// render task gets core 1, where loop() would normally run.
+const BaseType_t NETWORK_TASK_CORE = 0;
+const BaseType_t RENDER_TASK_CORE = 1;
+const uint32_t NETWORK_TASK_STACK = 12288; // Room for a TLS handshake
+const uint32_t RENDER_TASK_STACK = 4096;
+const TickType_t NETWORK_TASK_TICK = pdMS_TO_TICKS(100);
+const TickType_t RENDER_TASK_TICK = pdMS_TO_TICKS(100);
+
+// Decodes response bodies into a TrainTable, one train at a time
+TrainDecoder decoder;
+
+// Keep-alive connection to apiEndpoint, reused across fetch cycles
+HttpSession api;
+
+// Event-driven WiFi connection, advanced by the network task
+WiFiLink wifi;
+
+// Decides when the network task fetches next (see poll_scheduler.h)
+PollScheduler poller;
+
+// Server-Sent Events stream from PUSH_ENDPOINT; replaces polling while open
+PushChannel push;
 
-// Update interval (milliseconds)
-const unsigned long UPDATE_INTERVAL = 30000; // 30 seconds
-unsigned long lastUpdate = 0;
+// Optional GET /metrics on METRICS_PORT, served by the network task
+MetricsServer metricsServer;
+
+// Decodes compressed response bodies while they are parsed
+InflateStream inflater;
+
+// Boards handed from the network task to the render task
+SnapshotBuffer<TrainTable> snapshots;
+
+// Owned by the network task: the last good board of each view, which
+// deltas patch, and its validators for conditional requests
+TrainTable views[VIEW_COUNT];
+HttpValidators viewValidators[VIEW_COUNT];
+
+// Owned by the network task: the views merged into the board on display
+TrainTable board;
+
+// The station's timetable in flash, if one was uploaded
+ScheduleIndex schedule;
+
+// Owned by the network task: the views are fetched compact (the timetable
+// has the rest)
+bool compactViews = false;
+
+// Train rows the display has, set once at boot: no view asks for more
+uint8_t displayRows = MAX_TRAINS;
+
+// The last good board in NVS, shown at boot until the first fetch
+BoardStore boardStore;
+
+// Set by the render task while it draws, so the SoC is not put to light
+// sleep mid-frame
+std::atomic<bool> rendering{false};
+
+// Woken by publishBoard(); blocks in between (see renderWait())
+TaskHandle_t renderTaskHandle = nullptr;
+
+// Owned by the render task: where boards are drawn (DISPLAY_BACKEND)
+#if DISPLAY_BACKEND == DISPLAY_LCD_I2C
+Hd44780Display display(LCD_I2C_ADDRESS, LCD_COLUMNS, LCD_ROWS);
+#elif DISPLAY_BACKEND == DISPLAY_TFT_SPI
+TftDisplay display(TFT_TEXT_SIZE, TFT_ROTATION);
+#else
+SerialDisplay display(Serial);
+#endif
+
+// Outcome of one view's response within a fetch cycle
+enum ViewFetch {
+  VIEW_UPDATED,   // New board for the view
+  VIEW_UNCHANGED, // 304 Not Modified
+  VIEW_RESYNC,    // Delta against another version: fetch the full board
+  VIEW_PARTIAL,   // Cut off: the trains that arrived, marked incomplete
+  VIEW_FAILED,
+};
 
 // Function prototypes
-void connectWiFi();
-void fetchTrainData();
-void displayTrainInfo(JsonDocument& doc);
+void networkTask(void* param);
+void renderTask(void* param);
+bool fetchTrainData(TrainTable& table);
+void viewQuery(uint8_t view, char* buffer, size_t size);
+ViewFetch fetchView(uint8_t view, TrainTable& table);
+bool receivePushedBoard(TrainTable& table);
+void buildBoard(TrainTable& table);
+void acceptBoard(TrainTable& table);
+bool isMsgPack(const char* contentType);
+Stream* openBody();
+DeserializationError timedDecode(Stream& input, PayloadFormat format,
+                                 TrainTable& table, const HttpSession& session);
+void pollSerialCommands();
+void printArena(Print& out);
+bool updateCountdowns(const TrainTable& table, int16_t* buckets);
 void printWiFiStatus();
+void configureServerChecks(HttpSession& session);
+void findServer();
+void idleNetworkTask();
+unsigned long msUntilCountdownChange(const TrainTable& table);
+void publishBoard();
+TickType_t renderWait(unsigned long sinceTick, unsigned long tickDelay);
+unsigned long countdownTickDelay(const TrainTable& table);
 
 /**
  * Setup function - runs once at startup
@@ -53,58 +216,394 @@ void setup() {
   Serial.println("Metro-North Railroad Train Clock");
   Serial.println("=================================\n");
   
-  // Connect to WiFi
-  connectWiFi();
+  if (!decoder.begin(JSON_ARENA_BYTES)) {
+    Serial.println("No room for the JSON arena; parsing uses the heap");
+  }
+  poller.begin();
+  
+  bool timetable = schedule.begin();
+  if (timetable) {
+    Serial.printf("Timetable for %s: %lu departures over %u days\n",
+                  schedule.station(), (unsigned long)schedule.departureCount(),
+                  (unsigned)schedule.dayCount());
+  }
+  
+  if (!display.begin()) {
+    Serial.println("Display not found; check DISPLAY_BACKEND and wiring");
+  }
+  if (display.trainRows() > 0 && display.trainRows() < MAX_TRAINS) {
+    displayRows = display.trainRows();
+  }
+  
+  // After a reset that kept RTC memory, carry on from the board we had
+  if (restoreRetainedState(board, poller)) {
+    Serial.print("Restored board ");
+    Serial.print(board.seq);
+    Serial.println(" from RTC memory");
+  } else if (boardStore.load(board)) {
+    Serial.print("Loaded saved board ");
+    Serial.println(board.seq);
+  }
+  
+  // Show the board we had right away, marked stale, instead of a blank
+  // display until WiFi and the first fetch are done
+  if (board.hasTrainList) {
+    applyTimeZone();
+    board.stale = true;
+    snapshots.write() = board;
+    publishBoard();
+    
+    // A single view's board is the board itself, so its deltas resume
+    // (unless it was built on the timetable, and holds scheduled trains
+    // the server never sent)
+    if (VIEW_COUNT == 1 && !timetable) views[0] = board;
+  }
+  
+#if SERVICE_DISCOVERY
+  // The server found at the last boot, until this boot's browse is done
+  if (loadDiscoveredEndpoint(discoveredEndpoint, sizeof(discoveredEndpoint))) {
+    apiEndpoint = discoveredEndpoint;
+  }
+#endif
+  if (!api.begin(apiEndpoint)) {
+    Serial.println("Invalid API_ENDPOINT in config.h");
+  }
+  api.setTimeouts(FETCH_CONNECT_MS, FETCH_FIRST_BYTE_MS, FETCH_READ_MS);
+#if ACCEPT_MSGPACK
+  api.setAccept("application/msgpack, application/json;q=0.5");
+#endif
+#if ACCEPT_COMPRESSION
+  api.setAcceptEncoding("gzip, deflate");
+#endif
+#ifdef API_KEY
+  api.addHeader("X-API-Key", API_KEY);
+#endif
+  configureServerChecks(api);
+  
+  // Optional: the server pushes changes as they happen. The stream
+  // carries one board, so it is used with a single view only.
+  if (VIEW_COUNT > 1 && PUSH_ENDPOINT[0] != '\0') {
+    Serial.println("PUSH_ENDPOINT ignored with several API_VIEWS; polling them");
+  } else if (push.begin(PUSH_ENDPOINT)) {
+#ifdef API_KEY
+    push.session().addHeader("X-API-Key", API_KEY);
+#endif
+    configureServerChecks(push.session());
+  }
   
-  // Perform initial data fetch
-  fetchTrainData();
-  lastUpdate = millis();
+  xTaskCreatePinnedToCore(networkTask, "network", NETWORK_TASK_STACK, nullptr,
+                          1, nullptr, NETWORK_TASK_CORE);
+  xTaskCreatePinnedToCore(renderTask, "render", RENDER_TASK_STACK, nullptr,
+                          1, &renderTaskHandle, RENDER_TASK_CORE);
 }
 
 /**
- * Main loop - runs continuously
+ * Main loop - unused, all work happens in networkTask and renderTask
  */
 void loop() {
-  // Check WiFi connection
-  if (WiFi.status() != WL_CONNECTED) {
-    Serial.println("WiFi disconnected. Reconnecting...");
-    connectWiFi();
-  }
+  vTaskDelete(nullptr);
+}
+
+/**
+ * Network task - keeps WiFi up and publishes a table per fetched board
+ * 
+ * Blocking calls (HTTP timeouts) only ever stall this task.
+ */
+void networkTask(void* param) {
+  wifi.begin(ssid, password);
+  beginPowerMode();
   
-  // Update train data at regular intervals
-  if (millis() - lastUpdate >= UPDATE_INTERVAL) {
-    fetchTrainData();
-    lastUpdate = millis();
+  bool online = false;
+  bool timeSyncStarted = false;
+  bool discoveryDone = false;
+  
+  for (;;) {
+    // Advance the WiFi state machine (never blocks)
+    wifi.update();
+    
+    if (!wifi.connected()) {
+      if (online) {
+        // Sockets do not survive a lost link
+        api.close();
+        push.close();
+        online = false;
+      }
+      vTaskDelay(NETWORK_TASK_TICK);
+      continue;
+    }
+    
+    if (!online) {
+      Serial.println("WiFi connected!");
+      printWiFiStatus();
+      online = true;
+      countEvent(COUNTER_WIFI_CONNECTS);
+      metricsServer.begin(METRICS_PORT);
+      
+      // SNTP keeps the clock in sync from here on, across reconnects
+      if (!timeSyncStarted) {
+        beginTimeSync();
+        timeSyncStarted = true;
+      }
+      
+      // Once per boot: the result is kept (in NVS) rather than browsed
+      // for again on every poll
+      if (SERVICE_DISCOVERY && !discoveryDone) {
+        findServer();
+        discoveryDone = true;
+      }
+    }
+    
+    // (Re)open the push stream from the board we hold; the server answers
+    // with what changed since, as it would for a poll
+    if (push.connectDue()) {
+      push.connect(board.seq);
+    }
+    
+    // While the push stream is open, updates arrive as they happen.
+    // Otherwise update train data whenever the scheduler says so; a poll
+    // missed while WiFi or the stream was down runs right away.
+    if (push.isOpen()) {
+      if (push.next()) {
+        if (receivePushedBoard(snapshots.write())) {
+          publishBoard();
+        }
+        saveRetainedState(board, poller);
+        boardStore.save(board);
+      }
+    } else if (poller.due()) {
+      if (fetchTrainData(snapshots.write())) {
+        publishBoard();
+      }
+      saveRetainedState(board, poller);
+      boardStore.save(board);
+    }
+    
+    // Between fetches, trains leave the board as their time passes
+    if (timeSynced() && board.dropDeparted(time(nullptr) - DEPARTED_GRACE) > 0) {
+      snapshots.write() = board;
+      publishBoard();
+      saveRetainedState(board, poller);
+    }
+    
+    metricsServer.poll();
+    idleNetworkTask();
+  }
+}
+
+/**
+ * Wait for the network task's next job
+ * 
+ * In POWER_LIGHT_SLEEP, once the render task has drawn everything that was
+ * published, the task idles until the next poll or the next countdown
+ * change (the SoC light-sleeps through it), then stays awake briefly so the
+ * render task can draw. Otherwise, and while the push stream is open (it is
+ * read every tick), this is a plain task tick.
+ */
+void idleNetworkTask() {
+#if POWER_MODE == POWER_LIGHT_SLEEP
+  if (!snapshots.pending() && !rendering && !push.isOpen()) {
+    unsigned long wait = poller.remainingMs();
+    unsigned long countdown = msUntilCountdownChange(board);
+    idleFor(countdown < wait ? countdown : wait);
+    vTaskDelay(2 * RENDER_TASK_TICK);
+    return;
   }
+#endif
+  vTaskDelay(NETWORK_TASK_TICK);
+}
+
+/**
+ * Time until any countdown shown for table (or the display's clock) moves
+ * on, or ULONG_MAX if nothing shown will change
+ */
+unsigned long msUntilCountdownChange(const TrainTable& table) {
+  if (!timeSynced()) return ULONG_MAX;
   
-  // Small delay to prevent excessive CPU usage
-  delay(100);
+  time_t now = time(nullptr);
+  long soonest = display.showsClock() ? 60 - (long)(now % 60) : -1;
+  for (uint8_t i = 0; i < table.count; i++) {
+    if (table.trains[i].arrival_time == TIME_UNKNOWN) continue;
+    
+    // Minutes tick down until "due now", which lasts until a minute after
+    // the arrival time (see countdownBucket)
+    long seconds = (long)(table.trains[i].arrival_time - now);
+    if (seconds < -60) continue;
+    long change = seconds >= 60 ? seconds % 60 + 1 : seconds + 61;
+    if (soonest < 0 || change < soonest) soonest = change;
+  }
+  return soonest < 0 ? ULONG_MAX : (unsigned long)soonest * 1000UL;
 }
 
 /**
- * Connect to WiFi network
+ * Render task - draws each new table as soon as it is published
+ * 
+ * The task remembers what it drew last and hands it to the display along
+ * with the new board, so a backend can redraw only what changed. Between
+ * boards it ticks the display (see countdownTickDelay()), noting whether
+ * one of the departure countdowns moved to the next minute. It also
+ * answers the serial monitor's commands.
+ * 
+ * It sleeps on its task notification, which publishBoard() gives, until
+ * the next tick is due, so an idle clock does not wake for it in between.
  */
-void connectWiFi() {
-  Serial.print("Connecting to WiFi network: ");
-  Serial.println(ssid);
+void renderTask(void* param) {
+  static TrainTable shown; // Too large for this task's stack
+  int16_t countdowns[MAX_TRAINS];
+  bool drawnOnce = false;
+  unsigned long lastTick = 0;
+  unsigned long tickDelay = ULONG_MAX; // Nothing to tick before a board
   
-  WiFi.mode(WIFI_STA);
-  WiFi.begin(ssid, password);
+  for (;;) {
+    if (snapshots.acquire()) {
+      rendering = true;
+      const TrainTable& table = snapshots.front();
+      {
+        PhaseTimer timer(PHASE_RENDER);
+        display.drawBoard(table, drawnOnce ? &shown : nullptr);
+      }
+      shown = table;
+      drawnOnce = true;
+      updateCountdowns(shown, countdowns);
+      lastTick = millis();
+      tickDelay = countdownTickDelay(shown);
+      rendering = false;
+    } else if (drawnOnce && millis() - lastTick >= tickDelay) {
+      rendering = true;
+      lastTick = millis();
+      bool moved = updateCountdowns(shown, countdowns);
+      unsigned long start = micros();
+      display.tick(shown, moved);
+      if (moved) recordPhase(PHASE_RENDER, micros() - start);
+      tickDelay = countdownTickDelay(shown);
+      rendering = false;
+    }
+    
+    // USB CDC: true while a serial monitor has the port open
+    if (Serial) pollSerialCommands();
+    ulTaskNotifyTake(pdTRUE, renderWait(millis() - lastTick, tickDelay));
+  }
+}
+
+/**
+ * Hand the table filled through snapshots.write() to the render task and
+ * wake it
+ */
+void publishBoard() {
+  snapshots.publish();
+  if (renderTaskHandle != nullptr) xTaskNotifyGive(renderTaskHandle);
+}
+
+/**
+ * Time between display ticks: every COUNTDOWN_TICK, or in POWER_LIGHT_SLEEP
+ * only when something shown moves on (ULONG_MAX if nothing will)
+ */
+unsigned long countdownTickDelay(const TrainTable& table) {
+#if POWER_MODE == POWER_LIGHT_SLEEP
+  return msUntilCountdownChange(table);
+#else
+  return COUNTDOWN_TICK;
+#endif
+}
+
+/**
+ * How long the render task may block: until the next display tick, but no
+ * longer than a task tick while a serial monitor is attached, so its
+ * commands are answered. A published board ends the wait early.
+ */
+TickType_t renderWait(unsigned long sinceTick, unsigned long tickDelay) {
+  TickType_t wait = portMAX_DELAY;
+  if (tickDelay != ULONG_MAX) {
+    wait = sinceTick >= tickDelay ? 0 : pdMS_TO_TICKS(tickDelay - sinceTick);
+  }
+  if (Serial && wait > RENDER_TASK_TICK) wait = RENDER_TASK_TICK;
+  return wait;
+}
+
+/**
+ * Handle a command typed into the serial monitor, once its line is
+ * complete: "metrics" prints the timing histograms and health counters,
+ * "metrics reset" clears them
+ */
+void pollSerialCommands() {
+  static char line[32];
+  static size_t len = 0;
   
-  int attempts = 0;
-  while (WiFi.status() != WL_CONNECTED && attempts < 40) {
-    delay(500);
-    Serial.print(".");
-    attempts++;
+  while (Serial.available() > 0) {
+    int c = Serial.read();
+    if (c != '\n' && c != '\r') {
+      if (len + 1 < sizeof(line)) line[len++] = (char)c;
+      continue;
+    }
+    if (len == 0) continue;
+    line[len] = '\0';
+    len = 0;
+    
+    if (strcmp(line, "metrics") == 0) {
+      printMetrics(Serial);
+      printArena(Serial);
+    } else if (strcmp(line, "metrics reset") == 0) {
+      resetMetrics();
+      Serial.println("Metrics reset");
+    } else {
+      Serial.println("Commands: metrics, metrics reset");
+    }
+  }
+}
+
+/**
+ * How much of the JSON arena a train record has needed so far
+ */
+void printArena(Print& out) {
+  const JsonArena& arena = decoder.recordArena();
+  if (arena.capacity() == 0) {
+    out.println("JSON arena: none, records are parsed on the heap");
+    return;
+  }
+  out.printf("JSON arena: %u of %u bytes used at most (%s), %lu requests did not fit\n",
+             (unsigned)arena.highWater(), (unsigned)arena.capacity(),
+             arena.inPsram() ? "PSRAM" : "internal RAM",
+             (unsigned long)arena.failures());
+}
+
+/**
+ * Browse for the server (DNS-SD) and switch the API session to it if it
+ * is not the one being polled
+ */
+void findServer() {
+  char url[sizeof(discoveredEndpoint)];
+  if (!discoverEndpoint(url, sizeof(url))) {
+    Serial.print("No " DISCOVERY_SERVICE " server found; using ");
+    Serial.println(apiEndpoint);
+    return;
   }
+  if (strcmp(url, apiEndpoint) == 0) return;
   
-  if (WiFi.status() == WL_CONNECTED) {
-    Serial.println("\nWiFi connected!");
-    printWiFiStatus();
-  } else {
-    Serial.println("\nFailed to connect to WiFi");
-    Serial.println("Please check credentials in config.h");
+  if (!api.begin(url)) return;
+  strcpy(discoveredEndpoint, url);
+  apiEndpoint = discoveredEndpoint;
+  Serial.print("Found server at ");
+  Serial.println(apiEndpoint);
+  
+  // Another server's versions and validators mean nothing here
+  for (uint8_t v = 0; v < VIEW_COUNT; v++) {
+    views[v].seq = 0;
+    viewValidators[v].clear();
+  }
+}
+
+/**
+ * Apply TLS_FINGERPRINT or TLS_CA_CERT to an https:// session
+ */
+void configureServerChecks(HttpSession& session) {
+#if defined(TLS_FINGERPRINT)
+  if (!session.tls().setFingerprint(TLS_FINGERPRINT)) {
+    Serial.println("Invalid TLS_FINGERPRINT in config.h; not checking the server");
   }
+#elif defined(TLS_CA_CERT)
+  if (!session.tls().setCACert(TLS_CA_CERT)) {
+    Serial.println("Invalid TLS_CA_CERT in config.h; not checking the server");
+  }
+#endif
 }
 
 /**
@@ -120,168 +619,381 @@ void printWiFiStatus() {
 }
 
 /**
- * Fetch train data from the API endpoint
+ * Fetch the boards of all views and merge them into table
+ * 
+ * Every view's request goes out at once on the keep-alive connection
+ * (HTTP/1.1 pipelining), so a cycle costs about one round trip however
+ * many views there are. Once a view holds a board, only the changes since
+ * it are requested. The whole cycle ends by FETCH_DEADLINE_MS; a view cut
+ * off by then shows what it got. Returns true if table now holds a new
+ * board to publish (and board has been updated to match); false on errors
+ * and when the server reports every view unchanged.
  */
-void fetchTrainData() {
+bool fetchTrainData(TrainTable& table) {
   if (WiFi.status() != WL_CONNECTED) {
     Serial.println("Cannot fetch data: WiFi not connected");
-    return;
+    poller.failed(-1);
+    return false;
   }
   
+  bool changed = false;  // Some view has a new board
+  bool failed = false;   // Some view got no usable answer
+  long maxAge = -1;      // Shortest Cache-Control max-age of the replies
+  long retryAfter = -1;  // Longest Retry-After of the replies
+  
   Serial.println("\n--- Fetching Train Data ---");
   Serial.print("Endpoint: ");
   Serial.println(apiEndpoint);
+  api.setDeadline(millis() + FETCH_DEADLINE_MS);
   
-  HTTPClient http;
-  http.begin(apiEndpoint);
-  http.setTimeout(10000); // 10 second timeout
-  
-  // Add headers if needed
-  http.addHeader("Accept", "application/json");
+  // A compact board names no times or routes, so switching between
+  // compact and full boards starts every view over from a full board
+  bool compact = SCHEDULE_COMPACT_FETCH && schedule.ready(time(nullptr));
+  if (compact != compactViews) {
+    compactViews = compact;
+    for (uint8_t v = 0; v < VIEW_COUNT; v++) {
+      views[v].seq = 0;
+      viewValidators[v].clear();
+    }
+  }
   
-  // Send GET request
-  int httpCode = http.GET();
+  // A view whose delta does not fit its board is fetched again in full by
+  // a second pipeline, right away
+  bool pending[VIEW_COUNT];
+  for (uint8_t v = 0; v < VIEW_COUNT; v++) pending[v] = true;
   
-  if (httpCode > 0) {
-    Serial.print("HTTP Response Code: ");
-    Serial.println(httpCode);
+  for (int pass = 0; pass < 2; pass++) {
+    static char queries[VIEW_COUNT][QUERY_CAPACITY];
+    const char* list[VIEW_COUNT];
+    HttpValidators* validators[VIEW_COUNT];
+    uint8_t listed[VIEW_COUNT];
+    uint8_t count = 0;
+    
+    for (uint8_t v = 0; v < VIEW_COUNT; v++) {
+      if (!pending[v]) continue;
+      pending[v] = false;
+      viewQuery(v, queries[v], sizeof(queries[v]));
+      list[count] = queries[v];
+      validators[count] = &viewValidators[v];
+      listed[count++] = v;
+    }
+    if (count == 0) break;
     
-    if (httpCode == HTTP_CODE_OK) {
-      String payload = http.getString();
+    api.pipeline(list, validators, count);
+    for (uint8_t k = 0; k < count; k++) {
+      uint8_t v = listed[k];
+      ViewFetch result = fetchView(v, table);
       
-      // Parse JSON response
-      JsonDocument doc;
-      DeserializationError error = deserializeJson(doc, payload);
+      long age = api.maxAge();
+      if (age >= 0 && (maxAge < 0 || age < maxAge)) maxAge = age;
+      if (api.retryAfter() > retryAfter) retryAfter = api.retryAfter();
       
-      if (error) {
-        Serial.print("JSON parsing failed: ");
-        Serial.println(error.c_str());
-      } else {
-        displayTrainInfo(doc);
+      // Finish the response but keep the socket open for the next one
+      api.end();
+      
+      if (result == VIEW_UPDATED) {
+        changed = true;
+      } else if (result == VIEW_PARTIAL) {
+        // Shown, but retried like a failure
+        changed = true;
+        failed = true;
+      } else if (result == VIEW_RESYNC && pass == 0) {
+        views[v].seq = 0;
+        viewValidators[v].clear();
+        pending[v] = true;
+      } else if (result != VIEW_UNCHANGED) {
+        failed = true;
       }
-    } else {
-      Serial.println("HTTP request failed");
     }
+  }
+  api.clearDeadline();
+  
+  // A board saved before the restart that every view confirms is redrawn
+  // once as live
+  bool updated = changed || (board.stale && !failed);
+  if (updated) {
+    buildBoard(table);
+    acceptBoard(table);
+  } else if (failed && schedule.ready(time(nullptr))) {
+    // The server is out of reach, but the timetable still knows which
+    // trains have left and which come next. The board keeps the time of
+    // the last good fetch.
+    buildBoard(table);
+    table.updatedAtMs = board.updatedAtMs;
+    table.updatedAt = board.updatedAt;
+    table.stale = board.stale;
+    board = table;
+    updated = true;
+  }
+  
+  if (failed) {
+    countEvent(COUNTER_FETCH_FAILURES);
+    poller.failed(retryAfter);
   } else {
-    Serial.print("HTTP request error: ");
-    Serial.println(http.errorToString(httpCode));
+    poller.succeeded(board, maxAge);
   }
+  Serial.print("Next update in ");
+  Serial.print(poller.remainingMs() / 1000);
+  Serial.print(" s (");
+  Serial.print(poller.reason());
+  Serial.println(")");
   
-  http.end();
+  return updated;
+}
+
+/**
+ * Query for a view: its API_VIEWS entry, plus (once the view holds a board
+ * the server versions) the changes since that board, the fields the board
+ * keeps (only delays, tracks and status while the timetable supplies the
+ * rest), as many trains as the display shows, and the board's station and
+ * direction
+ */
+void viewQuery(uint8_t view, char* buffer, size_t size) {
+  QueryBuilder query(buffer, size);
+  query.append(apiViews[view]);
+#if DELTA_SYNC
+  if (views[view].seq != 0) query.add("since", (unsigned long)views[view].seq);
+#endif
+  query.add("fields", compactViews ? SCHEDULE_REALTIME_FIELDS : TRAIN_FIELD_KEYS);
+  query.add("limit", (unsigned long)displayRows);
+  query.add("origin_station", API_STATION);
+  query.add("destination_station", API_DESTINATION);
+  if (!query.complete()) {
+    Serial.println("View query too long for QUERY_CAPACITY; parameters left out");
+  }
 }
 
 /**
- * Display train information from JSON data
+ * Read the next pipelined response, for `view`, and apply it to the view
  * 
- * Expected JSON format (example):
- * {
- *   "trains": [
- *     {
- *       "trip_id": "123",
- *       "route": "Hudson Line",
- *       "destination": "Grand Central",
- *       "track": "5",
- *       "arrival_time": "14:30",
- *       "status": "On Time",
- *       "delay_seconds": 0
- *     }
- *   ]
- * }
+ * table is scratch space: a delta patches a copy of the view's board, a
+ * full board replaces it, and the view only takes the result once the
+ * decode is known to be good.
  */
-void displayTrainInfo(JsonDocument& doc) {
-  Serial.println("\n╔═══════════════════════════════════════════════════════════╗");
-  Serial.println("║           METRO-NORTH RAILROAD - UPCOMING TRAINS          ║");
-  Serial.println("╚═══════════════════════════════════════════════════════════╝\n");
-  
-  // Check if trains array exists
-  if (!doc.containsKey("trains")) {
-    Serial.println("No train data available");
-    Serial.println("\nNote: Ensure your web server provides JSON in the format:");
-    Serial.println("  { \"trains\": [ { \"trip_id\": \"...\", \"route\": \"...\", ... } ] }");
-    return;
+ViewFetch fetchView(uint8_t view, TrainTable& table) {
+  int httpCode = api.nextResponse();
+  
+  if (VIEW_COUNT > 1) {
+    Serial.print("View ");
+    Serial.print(view + 1);
+    Serial.print(" (");
+    Serial.print(apiViews[view]);
+    Serial.print("): ");
   }
   
-  JsonArray trains = doc["trains"];
+  if (httpCode <= 0) {
+    Serial.print("HTTP request error: ");
+    Serial.println(HttpSession::errorToString(httpCode));
+    return VIEW_FAILED;
+  }
   
-  if (trains.size() == 0) {
-    Serial.println("No upcoming trains scheduled");
-    return;
+  Serial.print("HTTP Response Code: ");
+  Serial.print(httpCode);
+  Serial.println(api.reusedConnection() ? " (reused connection)" : " (new connection)");
+  
+  if (httpCode == HTTP_CODE_NOT_MODIFIED) {
+    // Nothing changed since the last good response: skip parse and render
+    Serial.println("Train data unchanged");
+    return VIEW_UNCHANGED;
+  }
+  if (httpCode != HTTP_CODE_OK) {
+    Serial.println("HTTP request failed");
+    return VIEW_FAILED;
   }
   
-  // Display each train
-  int count = 0;
-  for (JsonObject train : trains) {
-    count++;
-    
-    // Extract train information
-    const char* trip_id = train["trip_id"] | "N/A";
-    const char* route = train["route"] | "Unknown Route";
-    const char* destination = train["destination"] | "Unknown";
-    const char* track = train["track"] | "TBD";
-    const char* arrival_time = train["arrival_time"] | "N/A";
-    const char* status = train["status"] | "Unknown";
-    int delay_seconds = train["delay_seconds"] | 0;
-    
-    // Format and display
-    Serial.println("┌───────────────────────────────────────────────────────────┐");
-    Serial.print("│ Train #");
-    Serial.print(count);
-    Serial.print(" - ");
-    Serial.print(route);
-    
-    // Pad to align the right border
-    int padding = 50 - strlen(route) - 12;
-    for (int i = 0; i < padding; i++) Serial.print(" ");
-    Serial.println("│");
-    
-    Serial.println("├───────────────────────────────────────────────────────────┤");
-    
-    // Destination
-    Serial.print("│ → Destination:  ");
-    Serial.print(destination);
-    padding = 44 - strlen(destination);
-    for (int i = 0; i < padding; i++) Serial.print(" ");
-    Serial.println("│");
-    
-    // Track
-    Serial.print("│   Track:        ");
-    Serial.print(track);
-    padding = 44 - strlen(track);
-    for (int i = 0; i < padding; i++) Serial.print(" ");
-    Serial.println("│");
-    
-    // Arrival time
-    Serial.print("│   Arrival:      ");
-    Serial.print(arrival_time);
-    padding = 44 - strlen(arrival_time);
-    for (int i = 0; i < padding; i++) Serial.print(" ");
-    Serial.println("│");
-    
-    // Status
-    Serial.print("│   Status:       ");
-    Serial.print(status);
-    
-    // Add delay information if applicable
-    if (delay_seconds > 0) {
-      Serial.print(" (+");
-      Serial.print(delay_seconds / 60);
-      Serial.print(" min)");
-      padding = 44 - strlen(status) - 8 - (delay_seconds >= 600 ? 1 : 0);
-    } else {
-      padding = 44 - strlen(status);
+  Stream* body = openBody();
+  if (body == nullptr) {
+    Serial.print("Unsupported Content-Encoding: ");
+    Serial.println(api.contentEncoding());
+    return VIEW_FAILED;
+  }
+  
+  // Decode straight off the socket into the table as bytes arrive. Only
+  // one train is ever held as a JsonDocument, and only its schema fields,
+  // in the decoder's fixed arena, so fetching does not touch the heap.
+  TrainTable& held = views[view];
+  bool msgpack = isMsgPack(api.contentType());
+  table = held;
+  table.incomplete = false;
+  DeserializationError error = timedDecode(
+      *body, msgpack ? PAYLOAD_MSGPACK : PAYLOAD_JSON, table, api);
+  
+  if (error == DeserializationError::IncompleteInput && decoder.recordCount() > 0 &&
+      !(decoder.isDelta() && decoder.deltaBase() != held.seq)) {
+    // Cut off part way, but every train before the cut arrived whole: show
+    // those, marked incomplete. The view holds no version the server
+    // knows now, so the next fetch asks for its full board.
+    Serial.print(api.bodyTimedOut() ? "Response cut off by the fetch budget; showing "
+                                    : "Connection lost part way; showing ");
+    Serial.print(table.count);
+    Serial.println(" trains");
+    table.incomplete = true;
+    table.seq = 0;
+    viewValidators[view].clear();
+    held = table;
+    return VIEW_PARTIAL;
+  }
+  
+  if (error) {
+    Serial.print(msgpack ? "MessagePack parsing failed: " : "JSON parsing failed: ");
+    Serial.println(error.c_str());
+    if (body == &inflater && inflater.failed()) {
+      Serial.println("Compressed body is corrupt, truncated or uses too large a window");
     }
-    
-    for (int i = 0; i < padding; i++) Serial.print(" ");
-    Serial.println("│");
-    
-    Serial.println("└───────────────────────────────────────────────────────────┘");
-    Serial.println();
+    return VIEW_FAILED;
   }
   
-  Serial.print("Total trains: ");
-  Serial.println(count);
-  Serial.print("Last updated: ");
-  Serial.print(millis() / 1000);
-  Serial.println(" seconds since boot");
-  Serial.println();
+  if (decoder.isDelta() && decoder.deltaBase() != held.seq) {
+    // Changes against a board we do not hold cannot be applied
+    Serial.println("Delta does not match the current board");
+    return held.seq != 0 ? VIEW_RESYNC : VIEW_FAILED;
+  }
+  
+  if (decoder.isDelta()) {
+    Serial.print("Applied changes since board ");
+    Serial.println(decoder.deltaBase());
+  }
+  
+  // Only a fully parsed board becomes the baseline for 304 replies and for
+  // the next delta
+  api.acceptValidators();
+  held = table;
+  return VIEW_UPDATED;
+}
+
+/**
+ * Apply the event waiting on the push stream to a copy of the board
+ * 
+ * Pushed events carry the same JSON as a poll (a full board or a delta),
+ * so they go through the same decoder. Returns true if table now holds a
+ * new board to publish (and board has been updated to match). An event
+ * that cannot be applied drops the stream; reconnecting with the seq of
+ * the board held resyncs it.
+ */
+bool receivePushedBoard(TrainTable& table) {
+  EventStream& event = push.event();
+  if (strcmp(event.type(), "board") != 0) {
+    event.finish(); // Not for this clock
+    return false;
+  }
+  
+  table = views[0];
+  DeserializationError error = timedDecode(event, PAYLOAD_JSON, table,
+                                           push.session());
+  event.finish();
+  
+  if (error) {
+    Serial.print("Pushed board parsing failed: ");
+    Serial.println(error.c_str());
+    push.close(true);
+    return false;
+  }
+  if (decoder.isDelta() && decoder.deltaBase() != views[0].seq) {
+    Serial.println("Pushed delta does not match the current board");
+    push.close(true);
+    return false;
+  }
+  
+  Serial.print(decoder.isDelta() ? "Pushed changes since board " : "Pushed board ");
+  Serial.println(decoder.isDelta() ? decoder.deltaBase() : table.seq);
+  views[0] = table;
+  buildBoard(table);
+  acceptBoard(table);
+  return true;
+}
+
+/**
+ * Combine the views into the board to show: merged (the earliest trains
+ * still to leave), and laid over the timetable when there is one for today
+ */
+void buildBoard(TrainTable& table) {
+  time_t now = time(nullptr);
+  table.merge(views, VIEW_COUNT, timeSynced() ? now - DEPARTED_GRACE : TIME_UNKNOWN);
+  
+  if (!schedule.ready(now)) return;
+  
+  // Network task only
+  static TrainTable timetable;
+  schedule.departures(now - SCHEDULE_LOOKBACK, now - DEPARTED_GRACE,
+                      table, timetable);
+  timetable.overlay(table);
+  table = timetable;
+}
+
+/**
+ * Make a fully decoded table the network task's board
+ */
+void acceptBoard(TrainTable& table) {
+  table.updatedAtMs = millis();
+  table.updatedAt = timeSynced() ? time(nullptr) : TIME_UNKNOWN;
+  table.stale = false;
+  board = table;
+}
+
+/**
+ * Stream that yields the decoded body of the current response
+ * 
+ * Compressed bodies are routed through the inflater. Returns nullptr for
+ * a Content-Encoding the clock cannot decode.
+ */
+Stream* openBody() {
+  const char* encoding = api.contentEncoding();
+  
+  if (encoding[0] == '\0' || strcasecmp(encoding, "identity") == 0) {
+    return &api.body();
+  }
+  if (strcasecmp(encoding, "gzip") == 0) {
+    inflater.begin(api.body(), INFLATE_GZIP);
+    return &inflater;
+  }
+  if (strcasecmp(encoding, "deflate") == 0) {
+    inflater.begin(api.body(), INFLATE_ZLIB);
+    return &inflater;
+  }
+  return nullptr;
+}
+
+/**
+ * Decode a body into table, timing the waits for its bytes and the parsing
+ * itself as separate phases (see metrics.h)
+ */
+DeserializationError timedDecode(Stream& input, PayloadFormat format,
+                                 TrainTable& table, const HttpSession& session) {
+  unsigned long waitedBefore = session.bodyWaitMicros();
+  unsigned long start = micros();
+  DeserializationError error = decoder.decode(input, format, table);
+  unsigned long elapsed = micros() - start;
+  unsigned long waited = session.bodyWaitMicros() - waitedBefore;
+  
+  recordPhase(PHASE_BODY, waited);
+  recordPhase(PHASE_PARSE, elapsed > waited ? elapsed - waited : 0);
+  return error;
+}
+
+/**
+ * True if a Content-Type names MessagePack (application/msgpack or the
+ * older application/x-msgpack)
+ */
+bool isMsgPack(const char* contentType) {
+  return strstr(contentType, "msgpack") != nullptr;
+}
+
+/**
+ * Recompute every train's countdown bucket into buckets[]
+ * 
+ * Returns true if any of them differs from what buckets[] held, i.e. some
+ * countdown on the display is out of date. Always false while the clock
+ * is not synced, as there is nothing to count down from.
+ */
+bool updateCountdowns(const TrainTable& table, int16_t* buckets) {
+  if (!timeSynced()) return false;
+  
+  time_t now = time(nullptr);
+  bool changed = false;
+  for (uint8_t i = 0; i < table.count; i++) {
+    int16_t bucket = countdownBucket(table.trains[i].arrival_time, now);
+    if (bucket != buckets[i]) changed = true;
+    buckets[i] = bucket;
+  }
+  return changed;
 }
@@ -0,0 +1,199 @@
+/**
+ * Runtime Metrics - implementation
+ *
+ * See metrics.h for an overview.
+ *
+ * Histogram buckets: values below 8 µs have a bucket each; above that,
+ * every power of two [2^k, 2^(k+1)) is split into four equal buckets.
+ * Samples of 2^26 µs (~67 s) or more share the last bucket.
+ */
+
+#include "metrics.h"
+
+#include <WiFi.h>
+#include <esp_heap_caps.h>
+
+static const uint8_t HISTOGRAM_OCTAVES = 26;
+static const uint8_t HISTOGRAM_BUCKETS = 4 * (HISTOGRAM_OCTAVES - 1);
+
+static const char* const PHASE_NAMES[PHASE_COUNT] = {
+  "dns", "connect", "tls", "first_byte", "body", "parse", "render",
+};
+
+static const char* const COUNTER_NAMES[COUNTER_COUNT] = {
+  "wifi_connects", "http_connects", "fetch_failures",
+};
+
+struct PhaseStats {
+  uint32_t count;
+  uint32_t minUs;
+  uint32_t maxUs;
+  uint32_t lastUs;
+  uint64_t sumUs;
+  uint32_t buckets[HISTOGRAM_BUCKETS];
+};
+
+struct PhaseSummary {
+  uint32_t count;
+  uint32_t minUs;
+  uint32_t avgUs;
+  uint32_t p95Us;
+  uint32_t maxUs;
+  uint32_t lastUs;
+  uint64_t sumUs;
+};
+
+// Both tasks record and report; every access holds the lock
+static portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+static PhaseStats phases[PHASE_COUNT];
+static uint32_t counters[COUNTER_COUNT];
+
+static uint8_t bucketOf(uint32_t us) {
+  if (us < 8) return (uint8_t)us;
+
+  uint8_t octave = 31 - __builtin_clz(us);
+  if (octave >= HISTOGRAM_OCTAVES) return HISTOGRAM_BUCKETS - 1;
+  uint8_t quarter = (us >> (octave - 2)) & 3;
+  return 4 * (octave - 1) + quarter;
+}
+
+// Largest value that falls into bucket
+static uint32_t bucketTop(uint8_t bucket) {
+  if (bucket < 7) return bucket;
+  if (bucket == HISTOGRAM_BUCKETS - 1) return UINT32_MAX;
+
+  uint8_t next = bucket + 1;
+  uint8_t octave = next / 4 + 1;
+  return ((uint32_t)(4 + next % 4) << (octave - 2)) - 1;
+}
+
+void recordPhase(MetricPhase phase, uint32_t micros) {
+  portENTER_CRITICAL(&lock);
+  PhaseStats& stats = phases[phase];
+  if (stats.count == 0 || micros < stats.minUs) stats.minUs = micros;
+  if (micros > stats.maxUs) stats.maxUs = micros;
+  stats.lastUs = micros;
+  stats.sumUs += micros;
+  stats.count++;
+  stats.buckets[bucketOf(micros)]++;
+  portEXIT_CRITICAL(&lock);
+}
+
+void countEvent(MetricCounter counter) {
+  portENTER_CRITICAL(&lock);
+  counters[counter]++;
+  portEXIT_CRITICAL(&lock);
+}
+
+void resetMetrics() {
+  portENTER_CRITICAL(&lock);
+  memset(phases, 0, sizeof(phases));
+  memset(counters, 0, sizeof(counters));
+  portEXIT_CRITICAL(&lock);
+}
+
+static PhaseSummary summarize(MetricPhase phase) {
+  PhaseSummary summary = {};
+
+  portENTER_CRITICAL(&lock);
+  const PhaseStats& stats = phases[phase];
+  summary.count = stats.count;
+  summary.minUs = stats.minUs;
+  summary.maxUs = stats.maxUs;
+  summary.lastUs = stats.lastUs;
+  summary.sumUs = stats.sumUs;
+  if (stats.count > 0) {
+    summary.avgUs = (uint32_t)(stats.sumUs / stats.count);
+
+    // The bucket holding the 95th percentile sample; its top, but never
+    // more than the largest sample seen
+    uint32_t rank = stats.count - stats.count / 20;
+    uint32_t seen = 0;
+    for (uint8_t b = 0; b < HISTOGRAM_BUCKETS; b++) {
+      seen += stats.buckets[b];
+      if (seen >= rank) {
+        uint32_t top = bucketTop(b);
+        summary.p95Us = top < stats.maxUs ? top : stats.maxUs;
+        break;
+      }
+    }
+  }
+  portEXIT_CRITICAL(&lock);
+
+  return summary;
+}
+
+static uint32_t counterValue(MetricCounter counter) {
+  portENTER_CRITICAL(&lock);
+  uint32_t value = counters[counter];
+  portEXIT_CRITICAL(&lock);
+  return value;
+}
+
+static int32_t currentRssi() {
+  return WiFi.status() == WL_CONNECTED ? WiFi.RSSI() : 0;
+}
+
+void printMetrics(Print& out) {
+  unsigned long uptime = millis() / 1000;
+  out.printf("\n--- Metrics (up %luh%02lum) ---\n", uptime / 3600, uptime / 60 % 60);
+  out.println("phase         count   min ms   avg ms   p95 ms   max ms  last ms");
+
+  for (uint8_t p = 0; p < PHASE_COUNT; p++) {
+    PhaseSummary s = summarize((MetricPhase)p);
+    out.printf("%-11s %7lu %8.1f %8.1f %8.1f %8.1f %8.1f\n", PHASE_NAMES[p],
+               (unsigned long)s.count, s.minUs / 1000.0, s.avgUs / 1000.0,
+               s.p95Us / 1000.0, s.maxUs / 1000.0, s.lastUs / 1000.0);
+  }
+
+  out.printf("Heap: %lu bytes free, largest block %lu, minimum ever %lu\n",
+             (unsigned long)ESP.getFreeHeap(),
+             (unsigned long)heap_caps_get_largest_free_block(MALLOC_CAP_8BIT),
+             (unsigned long)ESP.getMinFreeHeap());
+  out.printf("WiFi: RSSI %ld dBm, %lu connects\n", (long)currentRssi(),
+             (unsigned long)counterValue(COUNTER_WIFI_CONNECTS));
+  out.printf("HTTP: %lu connections opened, %lu failed fetches\n",
+             (unsigned long)counterValue(COUNTER_HTTP_CONNECTS),
+             (unsigned long)counterValue(COUNTER_FETCH_FAILURES));
+}
+
+void writeMetricsText(Print& out) {
+  out.println("# TYPE trainclock_phase_seconds summary");
+  for (uint8_t p = 0; p < PHASE_COUNT; p++) {
+    PhaseSummary s = summarize((MetricPhase)p);
+    const char* name = PHASE_NAMES[p];
+    out.printf("trainclock_phase_seconds{phase=\"%s\",quantile=\"0\"} %.6f\n",
+               name, s.minUs / 1e6);
+    out.printf("trainclock_phase_seconds{phase=\"%s\",quantile=\"0.95\"} %.6f\n",
+               name, s.p95Us / 1e6);
+    out.printf("trainclock_phase_seconds{phase=\"%s\",quantile=\"1\"} %.6f\n",
+               name, s.maxUs / 1e6);
+    out.printf("trainclock_phase_seconds_sum{phase=\"%s\"} %.6f\n", name,
+               s.sumUs / 1e6);
+    out.printf("trainclock_phase_seconds_count{phase=\"%s\"} %lu\n", name,
+               (unsigned long)s.count);
+  }
+  out.println("# TYPE trainclock_phase_last_seconds gauge");
+  for (uint8_t p = 0; p < PHASE_COUNT; p++) {
+    out.printf("trainclock_phase_last_seconds{phase=\"%s\"} %.6f\n",
+               PHASE_NAMES[p], summarize((MetricPhase)p).lastUs / 1e6);
+  }
+
+  for (uint8_t c = 0; c < COUNTER_COUNT; c++) {
+    out.printf("# TYPE trainclock_%s_total counter\n", COUNTER_NAMES[c]);
+    out.printf("trainclock_%s_total %lu\n", COUNTER_NAMES[c],
+               (unsigned long)counterValue((MetricCounter)c));
+  }
+
+  out.println("# TYPE trainclock_heap_free_bytes gauge");
+  out.printf("trainclock_heap_free_bytes %lu\n", (unsigned long)ESP.getFreeHeap());
+  out.println("# TYPE trainclock_heap_largest_block_bytes gauge");
+  out.printf("trainclock_heap_largest_block_bytes %lu\n",
+             (unsigned long)heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+  out.println("# TYPE trainclock_heap_min_free_bytes gauge");
+  out.printf("trainclock_heap_min_free_bytes %lu\n", (unsigned long)ESP.getMinFreeHeap());
+  out.println("# TYPE trainclock_wifi_rssi_dbm gauge");
+  out.printf("trainclock_wifi_rssi_dbm %ld\n", (long)currentRssi());
+  out.println("# TYPE trainclock_uptime_seconds counter");
+  out.printf("trainclock_uptime_seconds %lu\n", millis() / 1000);
+}
@@ -0,0 +1,77 @@
+/**
+ * Metrics HTTP Endpoint - implementation
+ *
+ * See metrics_server.h for an overview.
+ */
+
+#include "metrics_server.h"
+
+#include "metrics.h"
+
+// Longest a client may take to send its request head
+static const unsigned long REQUEST_TIMEOUT_MS = 500;
+
+void MetricsServer::begin(uint16_t port) {
+  if (port == 0 || listening) return;
+  server.begin(port);
+  listening = true;
+}
+
+/**
+ * Read one request line into buffer (without CRLF); false on timeout
+ */
+static bool readRequestLine(WiFiClient& client, char* buffer, size_t size,
+                            unsigned long deadline) {
+  size_t len = 0;
+  while ((long)(deadline - millis()) > 0) {
+    int c = client.read();
+    if (c < 0) {
+      if (!client.connected()) return false;
+      delay(1);
+      continue;
+    }
+    if (c == '\n') {
+      buffer[len] = '\0';
+      return true;
+    }
+    if (c != '\r' && len + 1 < size) buffer[len++] = (char)c;
+  }
+  return false;
+}
+
+void MetricsServer::poll() {
+  if (!listening) return;
+
+  WiFiClient client = server.available();
+  if (!client) return;
+
+  unsigned long deadline = millis() + REQUEST_TIMEOUT_MS;
+  char requestLine[64];
+  char header[128];
+  bool ok = readRequestLine(client, requestLine, sizeof(requestLine), deadline);
+
+  // Skip the headers up to the blank line
+  while (ok && readRequestLine(client, header, sizeof(header), deadline) &&
+         header[0] != '\0') {
+  }
+
+  if (!ok) {
+    client.stop();
+    return;
+  }
+
+  bool metrics = strncmp(requestLine, "GET /metrics ", 13) == 0 ||
+                 strcmp(requestLine, "GET /metrics") == 0;
+  if (metrics) {
+    client.print("HTTP/1.1 200 OK\r\n"
+                 "Content-Type: text/plain; version=0.0.4\r\n"
+                 "Connection: close\r\n\r\n");
+    writeMetricsText(client);
+  } else {
+    client.print("HTTP/1.1 404 Not Found\r\n"
+                 "Content-Type: text/plain\r\n"
+                 "Connection: close\r\n\r\n"
+                 "Try /metrics\n");
+  }
+  client.stop();
+}
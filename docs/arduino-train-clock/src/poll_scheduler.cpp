@@ -0,0 +1,131 @@
+/**
+ * Adaptive Poll Scheduler - implementation
+ *
+ * See poll_scheduler.h for an overview.
+ */
+
+#include "poll_scheduler.h"
+
+#include "wall_clock.h"
+
+// Intervals between successful polls
+const unsigned long POLL_NORMAL_MS = 60000;     // 1 min
+const unsigned long POLL_FAST_MS = 20000;       // Departure soon / delays
+const unsigned long POLL_IDLE_MS = 15 * 60000;  // Empty board, overnight
+
+// Longest wait for any reason, Cache-Control and Retry-After included
+const unsigned long POLL_MAX_MS = 30 * 60000;
+
+// A departure this close switches to POLL_FAST_MS
+const long APPROACH_WINDOW_S = 5 * 60;
+
+// With the next departure further away than this, poll at POLL_IDLE_MS
+// (but wake up again APPROACH_WINDOW_S before it)
+const long IDLE_THRESHOLD_S = 60 * 60;
+
+// Backoff after failures: 5 s, 10 s, 20 s ... 5 min
+const unsigned long BACKOFF_INITIAL_MS = 5000;
+const unsigned long BACKOFF_MAX_MS = 5 * 60000;
+
+// Spread of the first poll after boot, and of every interval (+/- 1/N)
+const unsigned long FIRST_POLL_SPREAD_MS = 3000;
+const unsigned long JITTER_DIVISOR = 10;
+
+void PollScheduler::begin() {
+  backoffMs = 0;
+  nextPollMs = millis() + random(FIRST_POLL_SPREAD_MS + 1);
+  why = "startup";
+}
+
+void PollScheduler::restoreBackoff(unsigned long ms) {
+  backoffMs = ms > BACKOFF_MAX_MS ? BACKOFF_MAX_MS : ms;
+  if (backoffMs > 0) {
+    // Restarted while failing (e.g. a crash on every response): keep
+    // backing off rather than retrying straight away
+    scheduleIn(backoffMs / 2 + random(backoffMs / 2 + 1), "backoff");
+  }
+}
+
+bool PollScheduler::due() const {
+  return (long)(millis() - nextPollMs) >= 0;
+}
+
+unsigned long PollScheduler::remainingMs() const {
+  return due() ? 0 : nextPollMs - millis();
+}
+
+void PollScheduler::scheduleIn(unsigned long intervalMs, const char* reason) {
+  if (intervalMs > POLL_MAX_MS) intervalMs = POLL_MAX_MS;
+  nextPollMs = millis() + intervalMs;
+  why = reason;
+}
+
+void PollScheduler::succeeded(const TrainTable& board, long maxAgeSeconds) {
+  backoffMs = 0;
+
+  unsigned long interval = POLL_NORMAL_MS;
+  const char* reason = "normal";
+
+  // Proximity needs the wall clock; without it, stay at the normal rate
+  if (timeSynced() && board.hasTrainList) {
+    time_t now = time(nullptr);
+    long nextDeparture = -1;
+    bool delayed = false;
+
+    for (uint8_t i = 0; i < board.count; i++) {
+      const Train& train = board.trains[i];
+      if (train.arrival_time == TIME_UNKNOWN) continue;
+
+      long seconds = (long)(train.arrival_time - now);
+      if (seconds < -60) continue; // Already gone
+      if (seconds < 0) seconds = 0;
+      if (nextDeparture < 0 || seconds < nextDeparture) nextDeparture = seconds;
+      if (train.delay_seconds > 0) delayed = true;
+    }
+
+    if (nextDeparture < 0) {
+      interval = POLL_IDLE_MS;
+      reason = "nothing scheduled";
+    } else if (nextDeparture <= APPROACH_WINDOW_S) {
+      interval = POLL_FAST_MS;
+      reason = "departure soon";
+    } else if (delayed) {
+      interval = POLL_FAST_MS;
+      reason = "train delayed";
+    } else if (nextDeparture > IDLE_THRESHOLD_S) {
+      unsigned long wake = (nextDeparture - APPROACH_WINDOW_S) * 1000UL;
+      interval = wake < POLL_IDLE_MS ? wake : POLL_IDLE_MS;
+      reason = "next departure far off";
+    }
+  }
+
+  // Jitter first, so max-age stays a lower bound
+  interval = interval - interval / JITTER_DIVISOR +
+             random(2 * (interval / JITTER_DIVISOR) + 1);
+
+  // The server says the data cannot change before then
+  if (maxAgeSeconds > 0 && (unsigned long)maxAgeSeconds * 1000UL > interval) {
+    interval = (unsigned long)maxAgeSeconds * 1000UL +
+               random(FIRST_POLL_SPREAD_MS + 1);
+    reason = "Cache-Control max-age";
+  }
+
+  scheduleIn(interval, reason);
+}
+
+void PollScheduler::failed(long retryAfterSeconds) {
+  backoffMs = backoffMs == 0 ? BACKOFF_INITIAL_MS : backoffMs * 2;
+  if (backoffMs > BACKOFF_MAX_MS) backoffMs = BACKOFF_MAX_MS;
+
+  if (retryAfterSeconds >= 0) {
+    // Never earlier than asked; a little later, so a fleet does not return
+    // all at once
+    unsigned long wait = (unsigned long)retryAfterSeconds * 1000UL;
+    scheduleIn(wait + random(wait / JITTER_DIVISOR + FIRST_POLL_SPREAD_MS + 1),
+               "Retry-After");
+    return;
+  }
+
+  // Half fixed, half random
+  scheduleIn(backoffMs / 2 + random(backoffMs / 2 + 1), "backoff");
+}
@@ -0,0 +1,58 @@
+/**
+ * Low-power Modes - implementation
+ *
+ * See power_mode.h for an overview.
+ */
+
+#include "power_mode.h"
+
+#include <WiFi.h>
+#include <esp_idf_version.h>
+#include <esp_pm.h>
+#include <sdkconfig.h>
+
+#if POWER_MODE == POWER_LIGHT_SLEEP && \
+    !(defined(CONFIG_PM_ENABLE) && defined(CONFIG_FREERTOS_USE_TICKLESS_IDLE))
+#error "POWER_MODE 2 needs a core built with CONFIG_PM_ENABLE and CONFIG_FREERTOS_USE_TICKLESS_IDLE: build the arduino_nano_esp32_light_sleep env (platformio.ini)"
+#endif
+
+// CPU clock while idling in the sleep modes (WiFi needs at least 80 MHz)
+const uint32_t LOW_POWER_CPU_MHZ = 80;
+
+// Lowest clock the power manager may drop to between light sleeps (XTAL)
+const uint32_t PM_MIN_CPU_MHZ = 40;
+
+void beginPowerMode() {
+#if POWER_MODE == POWER_MODEM_SLEEP || POWER_MODE == POWER_LIGHT_SLEEP
+  setCpuFrequencyMhz(LOW_POWER_CPU_MHZ);
+
+  // Wake for DTIM beacons only (at most every listen interval, the
+  // driver's default of 3 beacons, announced to the AP on association);
+  // the AP buffers our frames in between
+  WiFi.setSleep(WIFI_PS_MAX_MODEM);
+#endif
+
+#if POWER_MODE == POWER_LIGHT_SLEEP
+  // Let the idle task light-sleep the SoC; the WiFi driver keeps waking it
+  // for beacons, so the association survives any wait
+#if ESP_IDF_VERSION_MAJOR >= 5
+  esp_pm_config_t pm = {};
+#else
+  esp_pm_config_esp32s3_t pm = {};
+#endif
+  pm.max_freq_mhz = LOW_POWER_CPU_MHZ;
+  pm.min_freq_mhz = PM_MIN_CPU_MHZ;
+  pm.light_sleep_enable = true;
+
+  esp_err_t err = esp_pm_configure(&pm);
+  if (err != ESP_OK) {
+    Serial.print("Automatic light sleep failed to start (");
+    Serial.print(esp_err_to_name(err));
+    Serial.println("), staying in modem sleep");
+  }
+#endif
+}
+
+void idleFor(unsigned long ms) {
+  vTaskDelay(pdMS_TO_TICKS(ms));
+}
@@ -0,0 +1,106 @@
+/**
+ * Server Push Channel - implementation
+ *
+ * See push_channel.h for an overview.
+ */
+
+#include "push_channel.h"
+
+#include <string.h>
+
+// A stream silent for this long is taken as dead (3 missed heartbeats)
+const unsigned long PUSH_STALL_MS = 45000;
+
+// Reconnect backoff: 5 s, 10 s, 20 s ... 5 min
+const unsigned long PUSH_RETRY_INITIAL_MS = 5000;
+const unsigned long PUSH_RETRY_MAX_MS = 5 * 60000;
+
+// A stream that stayed up this long resets the backoff
+const unsigned long PUSH_STABLE_MS = 60000;
+
+// Time allowed for the rest of an event once its first bytes arrived
+const unsigned long PUSH_READ_TIMEOUT_MS = 10000;
+
+bool PushChannel::begin(const char* url) {
+  configured = url != nullptr && url[0] != '\0' && http.begin(url);
+  if (!configured) return false;
+
+  http.setAccept("text/event-stream");
+  http.setTimeout(PUSH_READ_TIMEOUT_MS);
+  retryAtMs = millis();
+  return true;
+}
+
+bool PushChannel::connectDue() const {
+  return configured && !open && (long)(millis() - retryAtMs) >= 0;
+}
+
+bool PushChannel::connect(uint32_t since) {
+  http.close();
+
+  char query[24];
+  snprintf(query, sizeof(query), "since=%lu", (unsigned long)since);
+  int code = http.get(query);
+
+  if (code != HTTP_CODE_OK ||
+      strstr(http.contentType(), "text/event-stream") == nullptr) {
+    Serial.print("Push stream unavailable: ");
+    if (code < 0) {
+      Serial.println(HttpSession::errorToString(code));
+    } else {
+      Serial.println(code);
+    }
+    close(true);
+    return false;
+  }
+
+  Serial.println("Push stream open, polling paused");
+  events.begin(http.body());
+  open = true;
+  openedAtMs = millis();
+  lastActivityMs = openedAtMs;
+  return true;
+}
+
+bool PushChannel::next() {
+  if (!open) return false;
+
+  if (http.body().available() > 0) {
+    lastActivityMs = millis();
+    if (events.next()) return true;
+  }
+
+  if (events.ended() || !http.isOpen()) {
+    Serial.println("Push stream closed by the server");
+    close(true);
+  } else if (millis() - lastActivityMs >= PUSH_STALL_MS) {
+    Serial.println("Push stream silent, reconnecting");
+    close(true);
+  }
+  return false;
+}
+
+void PushChannel::close(bool backOff) {
+  if (open) {
+    Serial.println("Push stream closed, polling resumed");
+
+    // Only a stream that held up counts as recovered; one that breaks
+    // right after opening keeps backing off
+    if (millis() - openedAtMs >= PUSH_STABLE_MS) backoffMs = 0;
+  }
+  open = false;
+
+  // An event stream never ends by itself: drop the socket
+  http.close();
+
+  if (!backOff) {
+    retryAtMs = millis();
+    return;
+  }
+
+  backoffMs = backoffMs == 0 ? PUSH_RETRY_INITIAL_MS : backoffMs * 2;
+  if (backoffMs > PUSH_RETRY_MAX_MS) backoffMs = PUSH_RETRY_MAX_MS;
+
+  // Half fixed, half random, so a fleet does not reconnect in lockstep
+  retryAtMs = millis() + backoffMs / 2 + random(backoffMs / 2 + 1);
+}
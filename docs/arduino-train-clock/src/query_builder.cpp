@@ -0,0 +1,82 @@
+/**
+ * Request Query Builder - implementation
+ *
+ * See query_builder.h for an overview.
+ *
+ * Values keep the characters RFC 3986 leaves unreserved, plus ',' (which
+ * separates the fields= keys and needs no escaping in a query); everything
+ * else, spaces and UTF-8 bytes included, becomes %XX.
+ */
+
+#include "query_builder.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+static bool passesUnescaped(char c) {
+  return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') ||
+         (c >= '0' && c <= '9') || strchr("-._~,", c) != nullptr;
+}
+
+QueryBuilder::QueryBuilder(char* buffer, size_t size) : buffer(buffer), size(size) {
+  if (size > 0) buffer[0] = '\0';
+}
+
+void QueryBuilder::append(const char* query) {
+  if (query == nullptr || query[0] == '\0') return;
+  size_t start = used;
+  separate();
+  commit(start, put(query));
+}
+
+void QueryBuilder::add(const char* key, const char* value) {
+  if (value == nullptr || value[0] == '\0') return;
+  size_t start = used;
+  separate();
+  bool fits = put(key) && put('=');
+  static const char HEX_DIGITS[] = "0123456789ABCDEF";
+  for (const char* p = value; fits && *p != '\0'; p++) {
+    uint8_t c = (uint8_t)*p;
+    if (passesUnescaped(*p)) {
+      fits = put(*p);
+    } else {
+      fits = put('%') && put(HEX_DIGITS[c >> 4]) && put(HEX_DIGITS[c & 0x0F]);
+    }
+  }
+  commit(start, fits);
+}
+
+void QueryBuilder::add(const char* key, unsigned long value) {
+  char digits[12];
+  snprintf(digits, sizeof(digits), "%lu", value);
+  add(key, digits);
+}
+
+bool QueryBuilder::put(char c) {
+  if (c == '\0' || used + 1 >= size) return false;
+  buffer[used++] = c;
+  return true;
+}
+
+bool QueryBuilder::put(const char* text) {
+  for (const char* p = text; *p != '\0'; p++) {
+    if (!put(*p)) return false;
+  }
+  return true;
+}
+
+void QueryBuilder::separate() {
+  if (used > 0) put('&');
+}
+
+/**
+ * Keep what was written since `start`, or drop all of it if it did not fit
+ */
+void QueryBuilder::commit(size_t start, bool fits) {
+  if (!fits) {
+    used = start;
+    overflowed = true;
+  }
+  if (size > 0) buffer[used] = '\0';
+}
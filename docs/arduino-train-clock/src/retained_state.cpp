@@ -0,0 +1,56 @@
+/**
+ * RTC-retained State - implementation
+ *
+ * See retained_state.h for an overview.
+ */
+
+#include "retained_state.h"
+
+#include <string.h>
+
+// Bump when TrainTable's layout changes, so an old copy is not misread
+static const uint32_t RETAINED_MAGIC = 0x4D4E5201;
+
+struct RetainedState {
+  uint32_t magic;
+  uint32_t size;
+  uint32_t checksum;
+  uint32_t backoffMs;
+  uint8_t board[sizeof(TrainTable)]; // TrainTable is trivially copyable
+};
+
+// Not cleared at boot; validated by magic, size and checksum instead
+RTC_NOINIT_ATTR static RetainedState retained;
+
+/**
+ * FNV-1a over everything after the checksum field
+ */
+static uint32_t checksumOf(const RetainedState& state) {
+  const uint8_t* p = (const uint8_t*)&state.backoffMs;
+  const uint8_t* end = (const uint8_t*)&state + sizeof(state);
+  uint32_t hash = 2166136261u;
+  while (p < end) {
+    hash = (hash ^ *p++) * 16777619u;
+  }
+  return hash;
+}
+
+void saveRetainedState(const TrainTable& board, const PollScheduler& poller) {
+  retained.magic = RETAINED_MAGIC;
+  retained.size = sizeof(TrainTable);
+  retained.backoffMs = poller.backoff();
+  memcpy(retained.board, &board, sizeof(TrainTable));
+  retained.checksum = checksumOf(retained);
+}
+
+bool restoreRetainedState(TrainTable& board, PollScheduler& poller) {
+  if (retained.magic != RETAINED_MAGIC || retained.size != sizeof(TrainTable) ||
+      retained.checksum != checksumOf(retained)) {
+    return false;
+  }
+
+  memcpy(&board, retained.board, sizeof(TrainTable));
+  board.updatedAtMs = 0; // millis() of the previous boot
+  poller.restoreBackoff(retained.backoffMs);
+  return true;
+}
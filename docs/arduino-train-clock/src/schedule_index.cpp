@@ -0,0 +1,271 @@
+/**
+ * Flash Timetable - implementation
+ *
+ * See schedule_index.h for an overview, and tools/pack_schedule.py for the
+ * image layout (the two have to agree).
+ *
+ * GTFS times count from noon minus 12 hours of the service day, which is
+ * midnight except on the days clocks change, and pass 24:00 for trips
+ * running after midnight. A departure can therefore belong to yesterday's
+ * service (late at night), today's or tomorrow's: lookups walk all three
+ * service days at once and take the earliest departure among them.
+ */
+
+#include "schedule_index.h"
+
+#include <esp_idf_version.h>
+#include <esp_partition.h>
+#include <string.h>
+
+static const uint32_t SCHEDULE_MAGIC = 0x53524E4D; // "MNRS"
+static const uint16_t SCHEDULE_VERSION = 1;
+static const esp_partition_subtype_t SCHEDULE_SUBTYPE = (esp_partition_subtype_t)0x40;
+
+// A scheduled train as a JsonDocument: five short strings
+static const size_t ROW_ARENA_BYTES = 512;
+
+static const int32_t SECONDS_PER_DAY = 24 * 3600;
+
+struct ScheduleHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t headerSize;
+  uint32_t imageSize;
+  uint32_t checksum;        // Of everything after the header
+  uint32_t builtAt;         // Epoch time the image was packed
+  uint32_t firstDay;        // Days since 1970-01-01 of the first service day
+  uint16_t dayCount;
+  uint16_t serviceCount;
+  uint16_t routeCount;
+  uint16_t reserved;
+  uint32_t departureCount;
+  uint32_t stationName;     // String offsets are from stringsOffset
+  uint32_t servicesOffset;  // Byte offsets are from the start of the image
+  uint32_t routesOffset;
+  uint32_t departuresOffset;
+  uint32_t stringsOffset;
+};
+
+struct ScheduleDeparture {
+  uint32_t seconds;         // Into the service day
+  uint32_t tripId;
+  uint32_t headsign;
+  uint16_t service;
+  uint16_t route;
+};
+
+static_assert(sizeof(ScheduleHeader) == 56, "HEADER in tools/pack_schedule.py");
+static_assert(sizeof(ScheduleDeparture) == 16, "DEPARTURE in tools/pack_schedule.py");
+
+/**
+ * FNV-1a, as in board_store.cpp
+ */
+static uint32_t checksumOf(const uint8_t* p, size_t length) {
+  uint32_t hash = 2166136261u;
+  while (length--) {
+    hash = (hash ^ *p++) * 16777619u;
+  }
+  return hash;
+}
+
+/**
+ * Day number (days since 1970-01-01) of the local date at `when`
+ */
+static int32_t localDay(time_t when) {
+  struct tm local;
+  localtime_r(&when, &local);
+
+  // Days from civil date (proleptic Gregorian), with March as month 0
+  int year = local.tm_year + 1900 - (local.tm_mon < 2);
+  int era = (year >= 0 ? year : year - 399) / 400;
+  int yearOfEra = year - era * 400;
+  int month = (local.tm_mon + 10) % 12;
+  int dayOfYear = (153 * month + 2) / 5 + local.tm_mday - 1;
+  int dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+  return era * 146097 + dayOfEra - 719468;
+}
+
+/**
+ * Epoch time that a service day's departure times count from
+ */
+static time_t serviceDayStart(int32_t day) {
+  struct tm noon = {};
+  noon.tm_year = 70;
+  noon.tm_mday = 1 + day; // mktime normalizes into the right month
+  noon.tm_hour = 12;
+  noon.tm_isdst = -1;
+  return mktime(&noon) - SECONDS_PER_DAY / 2;
+}
+
+bool ScheduleIndex::begin() {
+  if (image != nullptr) return true;
+
+  const esp_partition_t* partition = esp_partition_find_first(
+      ESP_PARTITION_TYPE_DATA, SCHEDULE_SUBTYPE, "schedule");
+  if (partition == nullptr) return false;
+
+  ScheduleHeader head;
+  if (esp_partition_read(partition, 0, &head, sizeof(head)) != ESP_OK) return false;
+  if (head.magic != SCHEDULE_MAGIC || head.version != SCHEDULE_VERSION ||
+      head.headerSize != sizeof(head) || head.imageSize <= sizeof(head) ||
+      head.imageSize > partition->size) {
+    return false; // Erased (all 0xFF), or packed for another firmware
+  }
+
+  // The sections have to lie one after the other within the image, so
+  // nothing read below can run past it
+  size_t bitmapBytes = (head.dayCount + 7) / 8;
+  if (head.servicesOffset < sizeof(head) ||
+      head.routesOffset < head.servicesOffset + head.serviceCount * bitmapBytes ||
+      head.departuresOffset < head.routesOffset + head.routeCount * sizeof(uint32_t) ||
+      head.stringsOffset < head.departuresOffset +
+                               (size_t)head.departureCount * sizeof(ScheduleDeparture) ||
+      head.stringsOffset >= head.imageSize || head.departuresOffset % 4 != 0) {
+    return false;
+  }
+
+  // Mapped for the life of the program, so the handle is not kept
+  const void* mapped = nullptr;
+#if ESP_IDF_VERSION_MAJOR >= 5
+  esp_partition_mmap_handle_t handle;
+  esp_err_t result = esp_partition_mmap(partition, 0, head.imageSize,
+                                        ESP_PARTITION_MMAP_DATA, &mapped, &handle);
+#else
+  spi_flash_mmap_handle_t handle;
+  esp_err_t result = esp_partition_mmap(partition, 0, head.imageSize,
+                                        SPI_FLASH_MMAP_DATA, &mapped, &handle);
+#endif
+  if (result != ESP_OK) return false;
+
+  const uint8_t* bytes = (const uint8_t*)mapped;
+  if (checksumOf(bytes + sizeof(head), head.imageSize - sizeof(head)) != head.checksum ||
+      bytes[head.imageSize - 1] != '\0') {
+    esp_partition_munmap(handle);
+    return false; // Flashed partly, or worn
+  }
+
+  image = bytes;
+  header = (const ScheduleHeader*)image;
+  rows = (const ScheduleDeparture*)(image + header->departuresOffset);
+  arena.begin(ROW_ARENA_BYTES);
+  return true;
+}
+
+bool ScheduleIndex::ready(time_t now) const {
+  if (image == nullptr || !timeSynced()) return false;
+  int32_t day = localDay(now) - (int32_t)header->firstDay;
+  return day >= 0 && day < header->dayCount;
+}
+
+const char* ScheduleIndex::text(uint32_t offset) const {
+  // The image ends in a NUL, so any offset inside it ends a string
+  if (offset >= header->imageSize - header->stringsOffset) return "";
+  return (const char*)image + header->stringsOffset + offset;
+}
+
+bool ScheduleIndex::runs(uint16_t service, int32_t day) const {
+  int32_t index = day - (int32_t)header->firstDay;
+  if (service >= header->serviceCount || index < 0 || index >= header->dayCount) {
+    return false;
+  }
+  const uint8_t* bitmap = image + header->servicesOffset +
+                          service * ((header->dayCount + 7) / 8);
+  return (bitmap[index / 8] >> (index % 8)) & 1;
+}
+
+uint32_t ScheduleIndex::lowerBound(int32_t seconds) const {
+  uint32_t low = 0;
+  uint32_t high = header->departureCount;
+  while (low < high) {
+    uint32_t middle = low + (high - low) / 2;
+    if ((int32_t)rows[middle].seconds < seconds) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return low;
+}
+
+uint8_t ScheduleIndex::departures(time_t from, time_t keepAfter,
+                                  const TrainTable& realtime, TrainTable& table) {
+  table.clear();
+  table.hasTrainList = true;
+  if (image == nullptr) return 0;
+
+  // Yesterday's, today's and tomorrow's service, each from its first
+  // departure at or after `from`
+  struct ServiceDay {
+    int32_t day;
+    time_t start;
+    uint32_t next;
+  };
+  ServiceDay days[3];
+  int32_t today = localDay(from);
+  for (int k = 0; k < 3; k++) {
+    days[k].day = today - 1 + k;
+    days[k].start = serviceDayStart(days[k].day);
+    days[k].next = lowerBound(from - days[k].start);
+  }
+
+  while (table.count < MAX_TRAINS) {
+    int earliest = -1;
+    time_t earliestAt = 0;
+    for (int k = 0; k < 3; k++) {
+      ServiceDay& service = days[k];
+      while (service.next < header->departureCount &&
+             !runs(rows[service.next].service, service.day)) {
+        service.next++;
+      }
+      if (service.next >= header->departureCount) continue;
+
+      time_t at = service.start + rows[service.next].seconds;
+      if (earliest < 0 || at < earliestAt) {
+        earliest = k;
+        earliestAt = at;
+      }
+    }
+    if (earliest < 0) break;
+
+    const ScheduleDeparture& departure = rows[days[earliest].next++];
+
+    // Look the trip up as stored, i.e. truncated like the trip_id field
+    char tripId[sizeof(Train::trip_id)];
+    strncpy(tripId, text(departure.tripId), sizeof(tripId) - 1);
+    tripId[sizeof(tripId) - 1] = '\0';
+    if (earliestAt < keepAfter && realtime.find(tripId) < 0) continue;
+
+    row.clear();
+    arena.reset();
+    row["trip_id"] = tripId;
+    if (departure.route < header->routeCount) {
+      uint32_t route;
+      memcpy(&route, image + header->routesOffset + departure.route * sizeof(route),
+             sizeof(route));
+      if (text(route)[0] != '\0') row["route"] = text(route);
+    }
+    const char* headsign = text(departure.headsign);
+    if (headsign[0] != '\0') row["destination"] = headsign;
+    row["status"] = "Scheduled";
+
+    table.add(row.as<JsonObjectConst>());
+    table.setArrival(table.count - 1, earliestAt);
+  }
+  return table.count;
+}
+
+const char* ScheduleIndex::station() const {
+  return image != nullptr ? text(header->stationName) : "";
+}
+
+time_t ScheduleIndex::builtAt() const {
+  return image != nullptr ? (time_t)header->builtAt : TIME_UNKNOWN;
+}
+
+uint16_t ScheduleIndex::dayCount() const {
+  return image != nullptr ? header->dayCount : 0;
+}
+
+uint32_t ScheduleIndex::departureCount() const {
+  return image != nullptr ? header->departureCount : 0;
+}
@@ -0,0 +1,259 @@
+/**
+ * Serial Monitor Display - implementation
+ *
+ * See serial_display.h for an overview.
+ */
+
+#include "serial_display.h"
+
+#include "board_layout.h"
+#include "wall_clock.h"
+
+// Board layout, in display columns
+static constexpr size_t BOX_COLUMNS = SERIAL_BOX_COLUMNS; // Borders included
+static constexpr size_t BOX_VALUE_COLUMN = 18; // Where field values start
+static constexpr size_t BOX_SLOT_END = BOX_COLUMNS - 2; // Then " │"
+static constexpr size_t BOX_VALUE_WIDTH = BOX_SLOT_END - BOX_VALUE_COLUMN;
+
+// Countdown list: "  #1  Stamford        12m"
+static constexpr size_t LIST_DESTINATION_WIDTH = 30;
+static constexpr size_t LIST_COUNTDOWN_COLUMN = 38;
+
+// The board's fixed rows, built by the compiler (box glyphs are 3 bytes)
+static constexpr size_t BOX_ROW_BYTES = SERIAL_ROW_BYTES;
+typedef LayoutText<BOX_ROW_BYTES> BoxRow;
+
+static constexpr BoxRow HEADER_TOP = borderRow<BOX_ROW_BYTES>(BOX_COLUMNS, "╔", "═", "╗");
+static constexpr BoxRow HEADER_TITLE = centredRow<BOX_ROW_BYTES>(
+    BOX_COLUMNS, "║", "METRO-NORTH RAILROAD - UPCOMING TRAINS", "║");
+static constexpr BoxRow HEADER_BOTTOM = borderRow<BOX_ROW_BYTES>(BOX_COLUMNS, "╚", "═", "╝");
+
+static constexpr BoxRow BOX_TOP = borderRow<BOX_ROW_BYTES>(BOX_COLUMNS, "┌", "─", "┐");
+static constexpr BoxRow BOX_RULE = borderRow<BOX_ROW_BYTES>(BOX_COLUMNS, "├", "─", "┤");
+static constexpr BoxRow BOX_BOTTOM = borderRow<BOX_ROW_BYTES>(BOX_COLUMNS, "└", "─", "┘");
+
+static constexpr BoxRow TITLE_LABEL = labelRow<BOX_ROW_BYTES>("│ ", "Train #", 0);
+static constexpr BoxRow DESTINATION_LABEL =
+    labelRow<BOX_ROW_BYTES>("│ ", "→ Destination:", BOX_VALUE_COLUMN);
+static constexpr BoxRow TRACK_LABEL = labelRow<BOX_ROW_BYTES>("│ ", "  Track:", BOX_VALUE_COLUMN);
+static constexpr BoxRow ARRIVAL_LABEL = labelRow<BOX_ROW_BYTES>("│ ", "  Arrival:", BOX_VALUE_COLUMN);
+static constexpr BoxRow DEPARTS_LABEL = labelRow<BOX_ROW_BYTES>("│ ", "  Departs:", BOX_VALUE_COLUMN);
+static constexpr BoxRow STATUS_LABEL = labelRow<BOX_ROW_BYTES>("│ ", "  Status:", BOX_VALUE_COLUMN);
+static constexpr BoxRow ROW_END = labelRow<BOX_ROW_BYTES>(" ", "│", 0);
+
+static_assert(HEADER_TITLE.columns == BOX_COLUMNS, "Board title wider than the box");
+static_assert(DESTINATION_LABEL.columns == BOX_VALUE_COLUMN &&
+                  ARRIVAL_LABEL.columns == BOX_VALUE_COLUMN &&
+                  DEPARTS_LABEL.columns == BOX_VALUE_COLUMN,
+              "A label runs into its value slot");
+
+static void appendRow(FrameRenderer& frame, const BoxRow& row) {
+  frame.appendSized(row.text, row.length, row.columns);
+}
+
+/**
+ * A fixed row of the board and its line end
+ */
+static void appendRowLine(FrameRenderer& frame, const BoxRow& row) {
+  appendRow(frame, row);
+  frame.appendLine();
+}
+
+/**
+ * One "│ <label>  <value> │" row inside a train box
+ */
+static void boxField(FrameRenderer& frame, const BoxRow& label, const char* value) {
+  appendRow(frame, label);
+  frame.appendPadded(value, BOX_VALUE_WIDTH);
+  appendRowLine(frame, ROW_END);
+}
+
+void SerialDisplay::drawBoard(const TrainTable& table,
+                              const TrainTable* previous) {
+  if (previous != nullptr && table.stale == previous->stale &&
+      table.incomplete == previous->incomplete && table.sameRows(*previous)) {
+    drawChanged(table, *previous);
+  } else {
+    drawAll(table);
+  }
+}
+
+void SerialDisplay::tick(const TrainTable& table, bool countdownsMoved) {
+  if (countdownsMoved) drawCountdowns(table);
+}
+
+/**
+ * Display train information from a table
+ *
+ * Tables are decoded from JSON in this format (example):
+ * {
+ *   "trains": [
+ *     {
+ *       "trip_id": "123",
+ *       "route": "Hudson Line",
+ *       "destination": "Grand Central",
+ *       "track": "5",
+ *       "arrival_time": "14:30",
+ *       "status": "On Time",
+ *       "delay_seconds": 0
+ *     }
+ *   ]
+ * }
+ */
+void SerialDisplay::drawAll(const TrainTable& table) {
+  frame.begin();
+
+  frame.append("\n");
+  appendRowLine(frame, HEADER_TOP);
+  appendRowLine(frame, HEADER_TITLE);
+  appendRow(frame, HEADER_BOTTOM);
+  frame.appendLine("\n");
+
+  // Check if trains array exists
+  if (!table.hasTrainList) {
+    frame.appendLine("No train data available");
+    frame.appendLine("\nNote: Ensure your web server provides JSON in the format:");
+    frame.appendLine("  { \"trains\": [ { \"trip_id\": \"...\", \"route\": \"...\", ... } ] }");
+    frame.flush();
+    return;
+  }
+
+  if (table.count == 0) {
+    frame.appendLine("No upcoming trains scheduled");
+    frame.flush();
+    return;
+  }
+
+  // Display each train
+  for (uint8_t i = 0; i < table.count; i++) {
+    drawTrainBox(table, i);
+  }
+
+  drawFooter(table);
+
+  // The whole board leaves in one write
+  frame.flush();
+}
+
+/**
+ * Redraw only the trains that differ from the previously drawn board
+ *
+ * Used when both boards list the same trains in the same order, which is
+ * the common case for delta updates (a delay, a track or a status moved).
+ */
+void SerialDisplay::drawChanged(const TrainTable& table,
+                                const TrainTable& previous) {
+  frame.begin();
+
+  uint8_t changed = 0;
+  for (uint8_t i = 0; i < table.count; i++) {
+    if (table.sameTrain(i, previous, i)) continue;
+
+    if (changed == 0) frame.appendLine("\n--- Updated trains ---\n");
+    drawTrainBox(table, i);
+    changed++;
+  }
+
+  if (changed == 0) frame.appendLine("\nNo train changes");
+  drawFooter(table);
+
+  frame.flush();
+}
+
+/**
+ * One train's box on the board
+ */
+void SerialDisplay::drawTrainBox(const TrainTable& table, uint8_t index) {
+  const Train& train = table.trains[index];
+
+  appendRowLine(frame, BOX_TOP);
+  appendRow(frame, TITLE_LABEL);
+  frame.appendf("%u - ", index + 1);
+  frame.appendPadded(table.text(train.route), BOX_SLOT_END - frame.column());
+  appendRowLine(frame, ROW_END);
+
+  appendRowLine(frame, BOX_RULE);
+
+  boxField(frame, DESTINATION_LABEL, table.text(train.destination));
+  boxField(frame, TRACK_LABEL, train.track);
+
+  char arrival[12];
+  formatLocalTime(train.arrival_time, "%H:%M:%S", arrival, sizeof(arrival));
+  boxField(frame, ARRIVAL_LABEL, arrival);
+
+  if (timeSynced() && train.arrival_time != TIME_UNKNOWN) {
+    char countdown[24];
+    formatCountdown(train.arrival_time, time(nullptr), countdown, sizeof(countdown));
+    boxField(frame, DEPARTS_LABEL, countdown);
+  }
+
+  // Status, with delay information if applicable (clipped by the slot,
+  // however long the delay)
+  char status[64];
+  const char* statusText = table.text(train.status);
+  if (train.delay_seconds > 0) {
+    snprintf(status, sizeof(status), "%s (+%ld min)", statusText, (long)(train.delay_seconds / 60));
+  } else {
+    snprintf(status, sizeof(status), "%s", statusText);
+  }
+  boxField(frame, STATUS_LABEL, status);
+
+  appendRowLine(frame, BOX_BOTTOM);
+  frame.appendLine();
+}
+
+/**
+ * Board totals and age, below the train boxes
+ */
+void SerialDisplay::drawFooter(const TrainTable& table) {
+  frame.appendf("Total trains: %u", table.count);
+  frame.appendLine();
+  if (table.droppedTrains > 0) {
+    frame.appendf("Not shown (board full): %u", table.droppedTrains);
+    frame.appendLine();
+  }
+  if (table.incomplete) {
+    frame.appendLine("INCOMPLETE - the response was cut off; more trains may follow");
+  }
+  if (table.stale) {
+    // Saved by an earlier boot: say when, with the date, as it may be old
+    char updated[20];
+    formatLocalTime(table.updatedAt, "%Y-%m-%d %H:%M", updated, sizeof(updated),
+                    "unknown");
+    frame.appendf("SAVED BOARD (from %s) - waiting for live data", updated);
+  } else if (table.updatedAt != TIME_UNKNOWN) {
+    char updated[12];
+    formatLocalTime(table.updatedAt, "%H:%M:%S", updated, sizeof(updated));
+    frame.appendf("Last updated: %s", updated);
+  } else {
+    frame.appendf("Last updated: %lu seconds since boot", table.updatedAtMs / 1000);
+  }
+  frame.appendLine();
+  frame.appendLine();
+}
+
+/**
+ * Compact list of departure countdowns, printed between boards
+ */
+void SerialDisplay::drawCountdowns(const TrainTable& table) {
+  time_t now = time(nullptr);
+  char clock[8];
+  formatLocalTime(now, "%H:%M", clock, sizeof(clock));
+
+  frame.begin();
+  frame.appendf("\n--- Departures at %s ---", clock);
+  frame.appendLine();
+
+  for (uint8_t i = 0; i < table.count; i++) {
+    const Train& train = table.trains[i];
+    char countdown[24];
+    formatCountdown(train.arrival_time, now, countdown, sizeof(countdown));
+
+    frame.appendf("  #%-2u ", i + 1);
+    frame.appendPadded(table.text(train.destination), LIST_DESTINATION_WIDTH);
+    frame.padTo(LIST_COUNTDOWN_COLUMN);
+    frame.appendLine(countdown);
+  }
+
+  frame.flush();
+}
@@ -0,0 +1,68 @@
+/**
+ * Server Discovery - implementation
+ *
+ * See service_discovery.h for an overview.
+ */
+
+#include "service_discovery.h"
+
+#include <ESPmDNS.h>
+#include <Preferences.h>
+#include <string.h>
+
+static const char* NVS_NAMESPACE = "discovery";
+static const char* NVS_KEY = "endpoint";
+
+// The clock's own mDNS name, needed to take part in mDNS at all
+static const char* MDNS_HOSTNAME = "train-clock";
+
+static const char* DEFAULT_PATH = "/api/trains";
+
+bool loadDiscoveredEndpoint(char* url, size_t size) {
+  Preferences prefs;
+  if (!prefs.begin(NVS_NAMESPACE, true)) return false;
+  size_t length = prefs.getString(NVS_KEY, url, size);
+  prefs.end();
+  return length > 0 && url[0] != '\0';
+}
+
+/**
+ * Save url unless it is already saved (spares the flash a write per boot)
+ */
+static void saveEndpoint(const char* url) {
+  char saved[160] = "";
+  if (loadDiscoveredEndpoint(saved, sizeof(saved)) && strcmp(saved, url) == 0) return;
+
+  Preferences prefs;
+  if (!prefs.begin(NVS_NAMESPACE, false)) return;
+  prefs.putString(NVS_KEY, url);
+  prefs.end();
+}
+
+bool discoverEndpoint(char* url, size_t size) {
+  static bool started = false;
+  if (!started) {
+    if (!MDNS.begin(MDNS_HOSTNAME)) return false;
+    started = true;
+  }
+
+  int found = MDNS.queryService(DISCOVERY_SERVICE, DISCOVERY_PROTOCOL);
+  for (int i = 0; i < found; i++) {
+#if ESP_ARDUINO_VERSION_MAJOR >= 3
+    IPAddress address = MDNS.address(i);
+#else
+    IPAddress address = MDNS.IP(i);
+#endif
+    if ((uint32_t)address == 0) continue; // IPv6 only
+
+    String path = MDNS.hasTxt(i, "path") ? MDNS.txt(i, "path") : String(DEFAULT_PATH);
+    int length = snprintf(url, size, "http://%u.%u.%u.%u:%u%s%s", address[0],
+                          address[1], address[2], address[3], MDNS.port(i),
+                          path.startsWith("/") ? "" : "/", path.c_str());
+    if (length < 0 || (size_t)length >= size) continue;
+
+    saveEndpoint(url);
+    return true;
+  }
+  return false;
+}
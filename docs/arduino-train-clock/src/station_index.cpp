@@ -0,0 +1,401 @@
+/**
+ * Station Index - implementation
+ *
+ * See station_index.h for an overview.
+ *
+ * File layout (/stations.idx):
+ *   StationFileHeader                magic, counts, checksum, validators
+ *   StationRecord[count]             string offsets, sorted by name
+ *   strings                          NUL-terminated; offset 0 is ""
+ *
+ * A new list is built in three steps, all on flash: the response is
+ * streamed one station at a time into unsorted records and the strings
+ * blob (two temporary files), a table of (name, record) pairs is sorted
+ * in RAM (8 bytes a station, freed afterwards), and the records are
+ * written out in that order ahead of the strings.
+ */
+
+#include "station_index.h"
+
+#include <ArduinoJson.h>
+#include <LittleFS.h>
+#include <algorithm>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char* INDEX_PATH = "/stations.idx";
+static const char* TEMP_PATH = "/stations.tmp";
+static const char* RECORDS_PATH = "/stations.rec";
+static const char* STRINGS_PATH = "/stations.str";
+
+// LittleFS partition in partitions.csv
+static const char* FS_PARTITION = "littlefs";
+
+// Bump when the file layout changes, so an old file is rebuilt
+static const uint32_t INDEX_MAGIC = 0x584E524D; // "MNRX"
+static const uint16_t INDEX_LAYOUT = 1;
+
+// Longer lists are refused (Metro-North has about 120 stations)
+static const uint16_t MAX_STATIONS = 1024;
+
+struct StationFileHeader {
+  uint32_t magic;
+  uint16_t layout;
+  uint16_t count;
+  uint32_t stringsSize;
+  uint32_t checksum;         // Of everything after the header
+  HttpValidators validators; // Sent with the next refresh
+};
+
+struct StationRecord {
+  uint32_t id;
+  uint32_t name;
+  uint32_t code;
+};
+
+/**
+ * FNV-1a, as in board_store.cpp, continued from `hash`
+ */
+static uint32_t checksumOf(const uint8_t* p, size_t length,
+                           uint32_t hash = 2166136261u) {
+  while (length--) {
+    hash = (hash ^ *p++) * 16777619u;
+  }
+  return hash;
+}
+
+// ---------------------------------------------------------------------------
+// PageCache
+// ---------------------------------------------------------------------------
+
+void PageCache::attach(File* file) {
+  this->file = file;
+  for (Page& page : pages) page.number = UINT32_MAX;
+}
+
+const PageCache::Page* PageCache::load(uint32_t number) {
+  Page* victim = &pages[0];
+  for (Page& page : pages) {
+    if (page.number == number) {
+      page.lastUse = ++uses;
+      return &page;
+    }
+    if (page.lastUse < victim->lastUse) victim = &page;
+  }
+
+  if (file == nullptr || !file->seek(number * PAGE_SIZE)) return nullptr;
+  int length = file->read(victim->data, PAGE_SIZE);
+  if (length <= 0) return nullptr;
+  victim->number = number;
+  victim->length = length;
+  victim->lastUse = ++uses;
+  return victim;
+}
+
+bool PageCache::read(uint32_t offset, void* out, size_t length) {
+  uint8_t* to = (uint8_t*)out;
+  while (length > 0) {
+    const Page* page = load(offset / PAGE_SIZE);
+    size_t at = offset % PAGE_SIZE;
+    if (page == nullptr || at >= page->length) return false;
+
+    size_t run = std::min(length, (size_t)(page->length - at));
+    memcpy(to, page->data + at, run);
+    to += run;
+    offset += run;
+    length -= run;
+  }
+  return true;
+}
+
+bool PageCache::readString(uint32_t offset, char* out, size_t size) {
+  size_t len = 0;
+  for (;;) {
+    const Page* page = load(offset / PAGE_SIZE);
+    size_t at = offset % PAGE_SIZE;
+    if (page == nullptr || at >= page->length) {
+      out[len] = '\0';
+      return false;
+    }
+
+    for (; at < page->length; at++, offset++) {
+      char c = (char)page->data[at];
+      if (c == '\0') {
+        out[len] = '\0';
+        return true;
+      }
+      if (len + 1 < size) out[len++] = c;
+    }
+  }
+}
+
+// ---------------------------------------------------------------------------
+// StationIndex
+// ---------------------------------------------------------------------------
+
+bool StationIndex::begin() {
+  // A blank partition is formatted on first use
+  if (!LittleFS.begin(true, "/littlefs", 4, FS_PARTITION)) return false;
+  return open();
+}
+
+bool StationIndex::open() {
+  if (file) file.close();
+  count = 0;
+  validators.clear();
+
+  file = LittleFS.open(INDEX_PATH, "r");
+  if (!file) return false;
+
+  StationFileHeader header;
+  bool valid = file.read((uint8_t*)&header, sizeof(header)) == sizeof(header) &&
+               header.magic == INDEX_MAGIC && header.layout == INDEX_LAYOUT &&
+               file.size() == sizeof(header) + header.count * sizeof(StationRecord) +
+                                  header.stringsSize &&
+               header.stringsSize > 0;
+
+  // Torn writes cannot happen (the file is swapped in whole), but the
+  // flash can wear
+  uint32_t hash = 2166136261u;
+  uint8_t buffer[64];
+  uint8_t last = 0;
+  while (valid && file.available() > 0) {
+    int length = file.read(buffer, sizeof(buffer));
+    if (length <= 0) break;
+    hash = checksumOf(buffer, length, hash);
+    last = buffer[length - 1];
+  }
+  if (!valid || hash != header.checksum || last != '\0') {
+    file.close();
+    return false;
+  }
+
+  count = header.count;
+  stringsOffset = sizeof(header) + count * sizeof(StationRecord);
+  validators = header.validators;
+  cache.attach(&file);
+  return true;
+}
+
+StationRefresh StationIndex::refresh(HttpSession& session) {
+  // Without a list there is nothing for a 304 to confirm
+  HttpValidators sent = validators;
+  if (count == 0) sent.clear();
+
+  const char* query = nullptr;
+  HttpValidators* list = &sent;
+  session.pipeline(&query, &list, 1);
+  int code = session.nextResponse();
+
+  StationRefresh result = STATIONS_FAILED;
+  if (code == HTTP_CODE_NOT_MODIFIED && count > 0) {
+    result = STATIONS_CURRENT;
+  } else if (code == HTTP_CODE_OK && session.contentEncoding()[0] == '\0') {
+    session.acceptValidators(); // Into `sent`, kept only if the list is good
+    if (rebuild(session.body(), sent)) result = STATIONS_UPDATED;
+  }
+  session.end();
+  return result;
+}
+
+/**
+ * Consume whitespace and return the next character
+ */
+static int nextToken(Stream& input) {
+  for (;;) {
+    int c = input.read();
+    if (c != ' ' && c != '\t' && c != '\r' && c != '\n') return c;
+  }
+}
+
+/**
+ * Append text and its NUL to the strings file; returns its offset
+ */
+static uint32_t appendString(File& strings, uint32_t& size, const char* text) {
+  if (text[0] == '\0') return 0;
+  uint32_t offset = size;
+  size_t length = strlen(text) + 1;
+  strings.write((const uint8_t*)text, length);
+  size += length;
+  return offset;
+}
+
+bool StationIndex::rebuild(Stream& input, const HttpValidators& from) {
+  File records = LittleFS.open(RECORDS_PATH, "w");
+  File strings = LittleFS.open(STRINGS_PATH, "w");
+  if (!records || !strings) return false;
+
+  // Step 1: stream {"stations": [{...}, ...]} into the temporary files,
+  // parsing one station at a time and only the fields kept
+  JsonDocument filter;
+  filter["stop_id"] = true;
+  filter["stop_name"] = true;
+  filter["stop_code"] = true;
+  JsonDocument station;
+
+  uint32_t stringsSize = 1;
+  strings.write((uint8_t)'\0');
+  uint16_t stations = 0;
+  bool ok = input.find("\"stations\"") && nextToken(input) == ':' &&
+            nextToken(input) == '[';
+  if (ok && input.peek() == ']') input.read(); // Empty list
+  else while (ok) {
+    station.clear();
+    ok = !deserializeJson(station, input, DeserializationOption::Filter(filter)) &&
+         stations < MAX_STATIONS;
+    if (!ok) break;
+
+    StationRecord record;
+    record.id = appendString(strings, stringsSize, station["stop_id"] | "");
+    record.name = appendString(strings, stringsSize, station["stop_name"] | "");
+    record.code = appendString(strings, stringsSize, station["stop_code"] | "");
+    ok = records.write((const uint8_t*)&record, sizeof(record)) == sizeof(record);
+    stations++;
+
+    int c = nextToken(input);
+    if (c == ']') break;
+    ok = ok && c == ',';
+  }
+  records.close();
+  strings.close();
+
+  // Step 2: sort by name (ignoring case), through a page cache on the
+  // strings
+  struct Entry {
+    uint32_t name;
+    uint16_t record;
+  };
+  Entry* order = ok ? (Entry*)malloc(stations * sizeof(Entry) + 1) : nullptr;
+  records = LittleFS.open(RECORDS_PATH, "r");
+  strings = LittleFS.open(STRINGS_PATH, "r");
+  ok = order != nullptr && records && strings;
+
+  for (uint16_t i = 0; ok && i < stations; i++) {
+    StationRecord record;
+    ok = records.read((uint8_t*)&record, sizeof(record)) == sizeof(record);
+    order[i].name = record.name;
+    order[i].record = i;
+  }
+
+  PageCache names;
+  names.attach(&strings);
+  if (ok) {
+    std::sort(order, order + stations, [&names](const Entry& a, const Entry& b) {
+      char left[sizeof(StationEntry::name)];
+      char right[sizeof(StationEntry::name)];
+      names.readString(a.name, left, sizeof(left));
+      names.readString(b.name, right, sizeof(right));
+      int compared = strcasecmp(left, right);
+      return compared != 0 ? compared < 0 : a.record < b.record;
+    });
+  }
+
+  // Step 3: header, sorted records, strings; the header goes last, once
+  // the checksum is known
+  File out = ok ? LittleFS.open(TEMP_PATH, "w") : File();
+  ok = ok && out;
+  StationFileHeader header = {};
+  uint32_t hash = 2166136261u;
+  ok = ok && out.write((const uint8_t*)&header, sizeof(header)) == sizeof(header);
+
+  for (uint16_t i = 0; ok && i < stations; i++) {
+    StationRecord record;
+    ok = records.seek(order[i].record * sizeof(record)) &&
+         records.read((uint8_t*)&record, sizeof(record)) == sizeof(record) &&
+         out.write((const uint8_t*)&record, sizeof(record)) == sizeof(record);
+    hash = checksumOf((const uint8_t*)&record, sizeof(record), hash);
+  }
+
+  ok = ok && strings.seek(0);
+  uint8_t buffer[64];
+  while (ok && strings.available() > 0) {
+    int length = strings.read(buffer, sizeof(buffer));
+    ok = length > 0 && out.write(buffer, length) == (size_t)length;
+    if (ok) hash = checksumOf(buffer, length, hash);
+  }
+
+  header.magic = INDEX_MAGIC;
+  header.layout = INDEX_LAYOUT;
+  header.count = stations;
+  header.stringsSize = stringsSize;
+  header.checksum = hash;
+  header.validators = from;
+  ok = ok && out.seek(0) &&
+       out.write((const uint8_t*)&header, sizeof(header)) == sizeof(header);
+
+  free(order);
+  if (out) out.close();
+  records.close();
+  strings.close();
+  LittleFS.remove(RECORDS_PATH);
+  LittleFS.remove(STRINGS_PATH);
+  if (!ok) {
+    LittleFS.remove(TEMP_PATH);
+    return false;
+  }
+
+  // Swap the new list in; the old one is read until here
+  if (file) file.close();
+  LittleFS.remove(INDEX_PATH);
+  if (!LittleFS.rename(TEMP_PATH, INDEX_PATH)) return false;
+  return open();
+}
+
+bool StationIndex::read(uint16_t index, StationEntry& out) {
+  StationRecord record;
+  if (index >= count ||
+      !cache.read(sizeof(StationFileHeader) + index * sizeof(record), &record,
+                  sizeof(record))) {
+    return false;
+  }
+  return cache.readString(stringsOffset + record.id, out.id, sizeof(out.id)) &&
+         cache.readString(stringsOffset + record.name, out.name, sizeof(out.name)) &&
+         cache.readString(stringsOffset + record.code, out.code, sizeof(out.code));
+}
+
+bool StationIndex::readName(uint16_t index, char* out, size_t size) {
+  uint32_t name;
+  return index < count &&
+         cache.read(sizeof(StationFileHeader) + index * sizeof(StationRecord) +
+                        offsetof(StationRecord, name),
+                    &name, sizeof(name)) &&
+         cache.readString(stringsOffset + name, out, size);
+}
+
+uint16_t StationIndex::lowerBound(const char* name) {
+  uint16_t low = 0;
+  uint16_t high = count;
+  while (low < high) {
+    uint16_t middle = low + (high - low) / 2;
+    char candidate[sizeof(StationEntry::name)];
+    if (readName(middle, candidate, sizeof(candidate)) &&
+        strcasecmp(candidate, name) < 0) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return low;
+}
+
+bool StationIndex::hasPrefix(uint16_t index, const char* prefix) {
+  char candidate[sizeof(StationEntry::name)];
+  return readName(index, candidate, sizeof(candidate)) &&
+         strncasecmp(candidate, prefix, strlen(prefix)) == 0;
+}
+
+int StationIndex::find(const char* stopId) {
+  // Not sorted by id; a scan of a hundred records through the cache
+  for (uint16_t i = 0; i < count; i++) {
+    StationRecord record;
+    char id[sizeof(StationEntry::id)];
+    if (!cache.read(sizeof(StationFileHeader) + i * sizeof(record), &record,
+                    sizeof(record)) ||
+        !cache.readString(stringsOffset + record.id, id, sizeof(id))) {
+      return -1;
+    }
+    if (strcmp(id, stopId) == 0) return i;
+  }
+  return -1;
+}
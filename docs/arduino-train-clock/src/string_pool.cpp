@@ -0,0 +1,38 @@
+/**
+ * String Intern Pool - implementation
+ *
+ * See string_pool.h for an overview.
+ */
+
+#include "string_pool.h"
+
+#include <string.h>
+
+void StringPool::clear() {
+  data[0] = '\0';
+  offsets[EMPTY] = 0;
+  count = 1;
+  used = 1;
+  overflow = false;
+}
+
+StringId StringPool::intern(const char* text) {
+  if (text == nullptr || text[0] == '\0') return EMPTY;
+
+  // A board has a few dozen distinct strings at most: a linear scan is
+  // cheaper than maintaining a hash table
+  for (uint8_t id = 1; id < count; id++) {
+    if (strcmp(data + offsets[id], text) == 0) return id;
+  }
+
+  size_t len = strlen(text) + 1;
+  if (count >= STRING_POOL_MAX_STRINGS || used + len > sizeof(data)) {
+    overflow = true;
+    return EMPTY;
+  }
+
+  memcpy(data + used, text, len);
+  offsets[count] = used;
+  used += len;
+  return count++;
+}
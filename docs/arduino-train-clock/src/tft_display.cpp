@@ -0,0 +1,92 @@
+/**
+ * SPI TFT / OLED Display - implementation
+ *
+ * See tft_display.h for an overview.
+ */
+
+#include "display.h"
+
+#if DISPLAY_BACKEND == DISPLAY_TFT_SPI
+
+#include "tft_display.h"
+
+#include <esp_heap_caps.h>
+
+// Sending an unchanged cell costs far more than setting a new address
+// window, so runs are never merged across unchanged cells
+static const uint8_t TFT_MERGE_GAP = 0;
+
+// GLCD font (TFT_eSPI font 1) cell at text size 1
+static const uint16_t GLYPH_WIDTH = 6;
+static const uint16_t GLYPH_HEIGHT = 8;
+
+static const uint16_t HEADER_COLOR = TFT_YELLOW;
+static const uint16_t TEXT_COLOR = TFT_WHITE;
+static const uint16_t BACKGROUND_COLOR = TFT_BLACK;
+
+TftDisplay::TftDisplay(uint8_t textSize, uint8_t rotation)
+    : GridDisplay(TFT_MERGE_GAP), band(&tft),
+      cellWidth(GLYPH_WIDTH * textSize), cellHeight(GLYPH_HEIGHT * textSize),
+      textSize(textSize), rotation(rotation) {}
+
+bool TftDisplay::begin() {
+  tft.init();
+  tft.setRotation(rotation);
+  tft.fillScreen(BACKGROUND_COLOR);
+  if (!tft.initDMA()) return false;
+
+  uint8_t columns = tft.width() / cellWidth;
+  uint8_t rows = tft.height() / cellHeight;
+  if (columns > GRID_MAX_COLUMNS) columns = GRID_MAX_COLUMNS;
+  if (rows > GRID_MAX_ROWS) rows = GRID_MAX_ROWS;
+
+  // The band is drawn by the CPU only and may live in PSRAM; the DMA
+  // buffers must be in internal, DMA-capable RAM
+  size_t pixels = (size_t)columns * cellWidth * cellHeight;
+  band.setColorDepth(16);
+  if (band.createSprite(columns * cellWidth, cellHeight) == nullptr) return false;
+  for (uint16_t*& buffer : dmaBuffers) {
+    buffer = (uint16_t*)heap_caps_malloc(pixels * sizeof(uint16_t), MALLOC_CAP_DMA);
+    if (buffer == nullptr) return false;
+  }
+
+  setGeometry(columns, rows);
+  panelCleared();
+  return true;
+}
+
+void TftDisplay::drawRun(uint8_t column, uint8_t row, const char* text,
+                         uint8_t length) {
+  uint16_t width = length * cellWidth;
+  uint16_t color = row == 0 ? HEADER_COLOR : TEXT_COLOR;
+
+  // Render the run at the left of the band...
+  band.fillRect(0, 0, width, cellHeight, BACKGROUND_COLOR);
+  for (uint8_t i = 0; i < length; i++) {
+    band.drawChar(i * cellWidth, 0, text[i], color, BACKGROUND_COLOR, textSize);
+  }
+
+  // ...and copy it out as one contiguous rectangle (sprites hold 16-bit
+  // pixels already in panel byte order)
+  uint16_t* buffer = dmaBuffers[nextBuffer];
+  nextBuffer ^= 1;
+  const uint16_t* pixels = (const uint16_t*)band.getPointer();
+  for (uint16_t y = 0; y < cellHeight; y++) {
+    memcpy(buffer + y * width, pixels + y * band.width(), width * sizeof(uint16_t));
+  }
+
+  if (!writing) {
+    tft.startWrite();
+    writing = true;
+  }
+  tft.pushImageDMA(column * cellWidth, row * cellHeight, width, cellHeight, buffer);
+}
+
+void TftDisplay::endFrame() {
+  if (!writing) return;
+  tft.dmaWait();
+  tft.endWrite();
+  writing = false;
+}
+
+#endif // DISPLAY_BACKEND == DISPLAY_TFT_SPI
@@ -0,0 +1,362 @@
+/**
+ * TLS Client - implementation
+ *
+ * See tls_client.h for an overview.
+ *
+ * The socket is non-blocking throughout: mbedTLS asks for more bytes with
+ * WANT_READ / WANT_WRITE, the handshake and writes wait for the socket
+ * with select() up to the timeout, and reads return what has arrived, as
+ * WiFiClient's do (HttpSession does its own waiting).
+ *
+ * The SSL context, with its record buffers, only exists while connected;
+ * the configuration (and a parsed CA) and the saved session stay.
+ */
+
+#include "tls_client.h"
+
+#include "host_resolver.h"
+#include "wall_clock.h"
+
+#include <errno.h>
+#include <lwip/sockets.h>
+#include <mbedtls/md.h>
+#include <mbedtls/net_sockets.h> // MBEDTLS_ERR_NET_* codes
+#include <string.h>
+
+static const char* RANDOM_PERSONALIZATION = "mnr-train-clock";
+
+static int sendToSocket(void* context, const unsigned char* buffer, size_t length) {
+  int n = lwip_send(*(int*)context, buffer, length, 0);
+  if (n >= 0) return n;
+  if (errno == EAGAIN || errno == EWOULDBLOCK) return MBEDTLS_ERR_SSL_WANT_WRITE;
+  if (errno == EPIPE || errno == ECONNRESET) return MBEDTLS_ERR_NET_CONN_RESET;
+  return MBEDTLS_ERR_NET_SEND_FAILED;
+}
+
+static int receiveFromSocket(void* context, unsigned char* buffer, size_t length) {
+  int n = lwip_recv(*(int*)context, buffer, length, 0);
+  if (n >= 0) return n; // 0: closed, which mbedTLS reports as end of file
+  if (errno == EAGAIN || errno == EWOULDBLOCK) return MBEDTLS_ERR_SSL_WANT_READ;
+  if (errno == EPIPE || errno == ECONNRESET) return MBEDTLS_ERR_NET_CONN_RESET;
+  return MBEDTLS_ERR_NET_RECV_FAILED;
+}
+
+/**
+ * Value of one hex digit, or -1
+ */
+static int hexValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+TlsClient::TlsClient() {
+  mbedtls_entropy_init(&entropy);
+  mbedtls_ctr_drbg_init(&random);
+  mbedtls_ssl_config_init(&config);
+  mbedtls_x509_crt_init(&ca);
+  mbedtls_ssl_init(&ssl);
+  mbedtls_ssl_session_init(&session);
+}
+
+TlsClient::~TlsClient() {
+  stop();
+  mbedtls_ssl_session_free(&session);
+  mbedtls_x509_crt_free(&ca);
+  mbedtls_ssl_config_free(&config);
+  mbedtls_ctr_drbg_free(&random);
+  mbedtls_entropy_free(&entropy);
+}
+
+bool TlsClient::setCACert(const char* pem) {
+  setInsecure();
+  // The length includes the NUL, which is how mbedTLS tells PEM from DER
+  if (mbedtls_x509_crt_parse(&ca, (const unsigned char*)pem, strlen(pem) + 1) != 0) {
+    mbedtls_x509_crt_free(&ca);
+    mbedtls_x509_crt_init(&ca);
+    return false;
+  }
+  trust = TRUST_CA;
+  return true;
+}
+
+bool TlsClient::setFingerprint(const char* sha256) {
+  setInsecure();
+  size_t digits = 0;
+  for (const char* p = sha256; *p != '\0'; p++) {
+    if (*p == ':' || *p == ' ') continue;
+    int value = hexValue(*p);
+    if (value < 0 || digits >= 2 * sizeof(fingerprint)) return false;
+    if (digits % 2 == 0) {
+      fingerprint[digits / 2] = value << 4;
+    } else {
+      fingerprint[digits / 2] |= value;
+    }
+    digits++;
+  }
+  if (digits != 2 * sizeof(fingerprint)) return false;
+  trust = TRUST_FINGERPRINT;
+  return true;
+}
+
+void TlsClient::setInsecure() {
+  stop();
+  forgetSession(); // It was accepted under the old checks
+  mbedtls_x509_crt_free(&ca);
+  mbedtls_x509_crt_init(&ca);
+  trust = TRUST_ANY;
+  if (prepared) {
+    mbedtls_ssl_config_free(&config);
+    mbedtls_ssl_config_init(&config);
+    prepared = false;
+  }
+}
+
+bool TlsClient::prepare() {
+  if (prepared) return true;
+
+  // Seeded once; the generator then runs on for every handshake
+  if (!seeded) {
+    if (mbedtls_ctr_drbg_seed(&random, mbedtls_entropy_func, &entropy,
+                              (const unsigned char*)RANDOM_PERSONALIZATION,
+                              strlen(RANDOM_PERSONALIZATION)) != 0) {
+      return false;
+    }
+    seeded = true;
+  }
+  if (mbedtls_ssl_config_defaults(&config, MBEDTLS_SSL_IS_CLIENT,
+                                  MBEDTLS_SSL_TRANSPORT_STREAM,
+                                  MBEDTLS_SSL_PRESET_DEFAULT) != 0) {
+    return false;
+  }
+  mbedtls_ssl_conf_rng(&config, mbedtls_ctr_drbg_random, &random);
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+  mbedtls_ssl_conf_session_tickets(&config, MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+#endif
+
+  if (trust == TRUST_ANY) {
+    mbedtls_ssl_conf_authmode(&config, MBEDTLS_SSL_VERIFY_NONE);
+  } else {
+    // For a fingerprint the chain is the empty `ca`: nothing is trusted
+    // until verifyCertificate() finds the server's certificate
+    mbedtls_ssl_conf_authmode(&config, MBEDTLS_SSL_VERIFY_REQUIRED);
+    mbedtls_ssl_conf_ca_chain(&config, &ca, nullptr);
+    mbedtls_ssl_conf_verify(&config, verifyCertificate, this);
+  }
+
+  prepared = true;
+  return true;
+}
+
+int TlsClient::verifyCertificate(void* context, mbedtls_x509_crt* certificate,
+                                 int depth, uint32_t* flags) {
+  TlsClient* self = (TlsClient*)context;
+
+  if (self->trust == TRUST_FINGERPRINT) {
+    // Only the server's own certificate counts; the CAs above it do not
+    // matter, nor do their dates
+    if (depth > 0) {
+      *flags = 0;
+      return 0;
+    }
+    uint8_t digest[sizeof(self->fingerprint)];
+    bool match = mbedtls_md(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256),
+                            certificate->raw.p, certificate->raw.len, digest) == 0 &&
+                 memcmp(digest, self->fingerprint, sizeof(digest)) == 0;
+    *flags = match ? 0 : MBEDTLS_X509_BADCERT_NOT_TRUSTED;
+    return 0;
+  }
+
+  // Without a synced clock it is 1970, long before any certificate
+  if (!timeSynced()) {
+    *flags &= ~(MBEDTLS_X509_BADCERT_FUTURE | MBEDTLS_X509_BADCERT_EXPIRED);
+  }
+  return 0;
+}
+
+bool TlsClient::waitFor(bool writable, unsigned long start, unsigned long limitMs) {
+  unsigned long elapsed = millis() - start;
+  if (elapsed >= limitMs) return false;
+
+  fd_set set;
+  FD_ZERO(&set);
+  FD_SET(fd, &set);
+  struct timeval wait;
+  wait.tv_sec = (limitMs - elapsed) / 1000;
+  wait.tv_usec = (limitMs - elapsed) % 1000 * 1000;
+  return lwip_select(fd + 1, writable ? nullptr : &set, writable ? &set : nullptr,
+                     nullptr, &wait) > 0;
+}
+
+int TlsClient::connect(IPAddress address, uint16_t port, const char* host,
+                       int32_t timeoutMs) {
+  stop();
+  this->timeoutMs = timeoutMs;
+  if (!prepare()) return 0;
+  unsigned long start = millis();
+
+  fd = lwip_socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  if (fd < 0) return 0;
+  lwip_fcntl(fd, F_SETFL, lwip_fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+  int one = 1;
+  lwip_setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+  struct sockaddr_in server = {};
+  server.sin_family = AF_INET;
+  server.sin_port = htons(port);
+  server.sin_addr.s_addr = (uint32_t)address;
+  if (lwip_connect(fd, (struct sockaddr*)&server, sizeof(server)) != 0) {
+    int error = 0;
+    socklen_t length = sizeof(error);
+    if (errno != EINPROGRESS || !waitFor(true, start, timeoutMs) ||
+        lwip_getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length) != 0 || error != 0) {
+      stop();
+      return 0;
+    }
+  }
+
+  active = true;
+  if (mbedtls_ssl_setup(&ssl, &config) != 0 ||
+      mbedtls_ssl_set_hostname(&ssl, host) != 0) {
+    stop();
+    return 0;
+  }
+  mbedtls_ssl_set_bio(&ssl, &fd, sendToSocket, receiveFromSocket, nullptr);
+
+  // Offer the last session; the server resumes it or starts afresh
+  if (hasSession && sessionPort == port && strcmp(sessionHost, host) == 0) {
+    mbedtls_ssl_set_session(&ssl, &session);
+  }
+
+  int result;
+  while ((result = mbedtls_ssl_handshake(&ssl)) != 0) {
+    if (result != MBEDTLS_ERR_SSL_WANT_READ && result != MBEDTLS_ERR_SSL_WANT_WRITE) break;
+    if (!waitFor(result == MBEDTLS_ERR_SSL_WANT_WRITE, start, timeoutMs)) break;
+  }
+  if (result != 0) {
+    forgetSession();
+    stop();
+    return 0;
+  }
+
+  // Keep this session (the same one, if it was resumed) for next time
+  mbedtls_ssl_session_free(&session);
+  mbedtls_ssl_session_init(&session);
+  hasSession = mbedtls_ssl_get_session(&ssl, &session) == 0 &&
+               strlen(host) < sizeof(sessionHost);
+  if (hasSession) {
+    strcpy(sessionHost, host);
+    sessionPort = port;
+  }
+  return 1;
+}
+
+int TlsClient::connect(const char* host, uint16_t port, int32_t timeoutMs) {
+  IPAddress address;
+  if (!resolveHost(host, address)) return 0;
+  return connect(address, port, host, timeoutMs);
+}
+
+int TlsClient::connect(IPAddress address, uint16_t port) {
+  // No name to check the certificate against
+  char host[16];
+  snprintf(host, sizeof(host), "%u.%u.%u.%u", address[0], address[1], address[2],
+           address[3]);
+  return connect(address, port, host, timeoutMs);
+}
+
+int TlsClient::connect(const char* host, uint16_t port) {
+  return connect(host, port, timeoutMs);
+}
+
+size_t TlsClient::write(const uint8_t* buffer, size_t size) {
+  if (!active) return 0;
+
+  size_t written = 0;
+  unsigned long start = millis();
+  while (written < size) {
+    int n = mbedtls_ssl_write(&ssl, buffer + written, size - written);
+    if (n > 0) {
+      written += n;
+    } else if (n == MBEDTLS_ERR_SSL_WANT_WRITE || n == MBEDTLS_ERR_SSL_WANT_READ) {
+      if (!waitFor(n == MBEDTLS_ERR_SSL_WANT_WRITE, start, timeoutMs)) break;
+    } else {
+      peerClosed = true;
+      break;
+    }
+  }
+  return written;
+}
+
+int TlsClient::available() {
+  if (!active) return 0;
+  int buffered = peeked >= 0 ? 1 : 0;
+
+  if (!peerClosed && mbedtls_ssl_get_bytes_avail(&ssl) == 0) {
+    // A zero-length read processes whatever record has arrived
+    int result = mbedtls_ssl_read(&ssl, nullptr, 0);
+    if (result < 0 && result != MBEDTLS_ERR_SSL_WANT_READ &&
+        result != MBEDTLS_ERR_SSL_WANT_WRITE) {
+      peerClosed = true;
+    }
+  }
+  return buffered + (int)mbedtls_ssl_get_bytes_avail(&ssl);
+}
+
+int TlsClient::read(uint8_t* buffer, size_t size) {
+  if (!active || size == 0) return -1;
+
+  size_t total = 0;
+  if (peeked >= 0) {
+    buffer[total++] = (uint8_t)peeked;
+    peeked = -1;
+  }
+  if (total < size && !peerClosed) {
+    int n = mbedtls_ssl_read(&ssl, buffer + total, size - total);
+    if (n > 0) {
+      total += n;
+    } else if (n != MBEDTLS_ERR_SSL_WANT_READ && n != MBEDTLS_ERR_SSL_WANT_WRITE) {
+      peerClosed = true; // 0 or close_notify: the server closed
+    }
+  }
+  return total > 0 ? (int)total : -1;
+}
+
+int TlsClient::read() {
+  uint8_t c;
+  return read(&c, 1) == 1 ? c : -1;
+}
+
+int TlsClient::peek() {
+  if (peeked < 0) peeked = read();
+  return peeked;
+}
+
+uint8_t TlsClient::connected() {
+  if (!active) return 0;
+  // Bytes still buffered count as connected, as with WiFiClient
+  return available() > 0 || !peerClosed;
+}
+
+void TlsClient::stop() {
+  if (active) {
+    if (!peerClosed) mbedtls_ssl_close_notify(&ssl); // Best effort
+    mbedtls_ssl_free(&ssl);
+    mbedtls_ssl_init(&ssl);
+    active = false;
+  }
+  if (fd >= 0) {
+    lwip_close(fd);
+    fd = -1;
+  }
+  peerClosed = false;
+  peeked = -1;
+}
+
+void TlsClient::forgetSession() {
+  if (!hasSession) return;
+  mbedtls_ssl_session_free(&session);
+  mbedtls_ssl_session_init(&session);
+  hasSession = false;
+}
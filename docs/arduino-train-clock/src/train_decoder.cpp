@@ -0,0 +1,533 @@
+/**
+ * Streaming Train Decoder - implementation
+ *
+ * See train_decoder.h for an overview.
+ *
+ * The scanners below only understand what they have to: the top-level map,
+ * its keys, the train arrays, the removed ids, the version numbers, and how
+ * to skip any other value. Train
+ * objects themselves are parsed by ArduinoJson, which stops right after the
+ * closing brace (or last map entry) and leaves the rest of the stream alone.
+ */
+
+#include "train_decoder.h"
+
+// Longest top-level key compared; longer keys are skipped either way
+static const size_t KEY_CAPACITY = 16;
+
+// Deepest nesting skipped in an unknown value
+static const uint8_t SKIP_DEPTH_LIMIT = 16;
+
+bool TrainDecoder::begin(size_t arenaBytes) {
+  buildTrainFilter(filter);
+  return arena.begin(arenaBytes);
+}
+
+DeserializationError TrainDecoder::decode(Stream& input, PayloadFormat format,
+                                          TrainTable& table) {
+  seq = 0;
+  base = 0;
+  delta = false;
+  records = 0;
+
+  DeserializationError error = format == PAYLOAD_MSGPACK
+      ? decodeMsgPack(input, table)
+      : decodeJson(input, table);
+
+  // A server without versioning leaves seq at 0: no deltas next time
+  if (!error) table.seq = seq;
+  return error;
+}
+
+void TrainDecoder::beginTrains(TrainTable& table, bool replace) {
+  if (replace) {
+    table.clear();
+    table.hasTrainList = true;
+  } else {
+    // Upserts intern new strings; make room by dropping stale ones first
+    table.compactStrings();
+  }
+}
+
+void TrainDecoder::beginRecord() {
+  // The previous record has been copied into the table; its memory is
+  // reused from the start of the arena
+  record.clear();
+  arena.reset();
+}
+
+static bool isDeltaKey(const char* key) {
+  return strcmp(key, "base") == 0 || strcmp(key, "upserts") == 0 ||
+         strcmp(key, "removes") == 0;
+}
+
+// ---------------------------------------------------------------------------
+// JSON
+// ---------------------------------------------------------------------------
+
+/**
+ * Consume whitespace; returns the next character without consuming it
+ */
+static int jsonPeek(Stream& input) {
+  for (;;) {
+    int c = input.peek();
+    if (c != ' ' && c != '\t' && c != '\r' && c != '\n') return c;
+    input.read();
+  }
+}
+
+static DeserializationError jsonEnd(int c) {
+  return c < 0 ? DeserializationError::IncompleteInput
+               : DeserializationError::InvalidInput;
+}
+
+/**
+ * Consume a string (opening quote included), keeping up to size - 1
+ * characters of it in buffer if one is given. Escapes are kept undecoded.
+ */
+static DeserializationError jsonString(Stream& input, char* buffer,
+                                       size_t size) {
+  input.read(); // Opening quote
+  size_t len = 0;
+  bool escaped = false;
+
+  for (;;) {
+    int c = input.read();
+    if (c < 0) return DeserializationError::IncompleteInput;
+    if (!escaped && c == '"') break;
+    escaped = !escaped && c == '\\';
+    if (buffer != nullptr && len + 1 < size) buffer[len++] = (char)c;
+  }
+
+  if (buffer != nullptr) buffer[len] = '\0';
+  return DeserializationError::Ok;
+}
+
+/**
+ * Consume one value of any type
+ */
+static DeserializationError jsonSkip(Stream& input) {
+  int c = jsonPeek(input);
+
+  if (c == '"') return jsonString(input, nullptr, 0);
+
+  if (c == '{' || c == '[') {
+    uint8_t depth = 0;
+    do {
+      c = jsonPeek(input);
+      if (c == '"') {
+        DeserializationError error = jsonString(input, nullptr, 0);
+        if (error) return error;
+        continue;
+      }
+      if (c < 0) return DeserializationError::IncompleteInput;
+      input.read();
+      if (c == '{' || c == '[') {
+        if (++depth > SKIP_DEPTH_LIMIT) return DeserializationError::TooDeep;
+      } else if (c == '}' || c == ']') {
+        depth--;
+      }
+    } while (depth > 0);
+    return DeserializationError::Ok;
+  }
+
+  // Number, true, false or null: runs up to the next delimiter
+  bool any = false;
+  while (c >= 0 && c != ',' && c != '}' && c != ']' && c != ' ' &&
+         c != '\t' && c != '\r' && c != '\n') {
+    input.read();
+    any = true;
+    c = input.peek();
+  }
+  return any ? DeserializationError::Ok : jsonEnd(c);
+}
+
+/**
+ * Consume a value, storing it in `value` if it is a non-negative integer
+ * (anything else leaves 0)
+ */
+static DeserializationError jsonUnsigned(Stream& input, uint32_t& value) {
+  value = 0;
+  int c = jsonPeek(input);
+  if (c < '0' || c > '9') return jsonSkip(input);
+
+  while (c >= '0' && c <= '9') {
+    value = value * 10 + (c - '0');
+    input.read();
+    c = input.peek();
+  }
+  return DeserializationError::Ok;
+}
+
+DeserializationError TrainDecoder::decodeJson(Stream& input, TrainTable& table) {
+  int c = jsonPeek(input);
+  if (c < 0) return DeserializationError::EmptyInput;
+  if (c != '{') return DeserializationError::InvalidInput;
+  input.read();
+
+  if (jsonPeek(input) == '}') {
+    input.read();
+    return DeserializationError::Ok;
+  }
+
+  for (;;) {
+    char key[KEY_CAPACITY];
+    c = jsonPeek(input);
+    if (c != '"') return jsonEnd(c);
+    DeserializationError error = jsonString(input, key, sizeof(key));
+    if (error) return error;
+
+    c = jsonPeek(input);
+    if (c != ':') return jsonEnd(c);
+    input.read();
+
+    if (isDeltaKey(key)) delta = true;
+
+    if (strcmp(key, "trains") == 0) {
+      error = decodeJsonTrains(input, table, true);
+    } else if (strcmp(key, "upserts") == 0) {
+      error = decodeJsonTrains(input, table, false);
+    } else if (strcmp(key, "removes") == 0) {
+      error = decodeJsonRemoves(input, table);
+    } else if (strcmp(key, "seq") == 0) {
+      error = jsonUnsigned(input, seq);
+    } else if (strcmp(key, "base") == 0) {
+      error = jsonUnsigned(input, base);
+    } else {
+      error = jsonSkip(input);
+    }
+    if (error) return error;
+
+    c = jsonPeek(input);
+    input.read();
+    if (c == '}') return DeserializationError::Ok;
+    if (c != ',') return jsonEnd(c);
+  }
+}
+
+DeserializationError TrainDecoder::decodeJsonTrains(Stream& input,
+                                                    TrainTable& table,
+                                                    bool replace) {
+  // Anything but an array (null, say) is treated like a missing key
+  if (jsonPeek(input) != '[') return jsonSkip(input);
+  input.read();
+  beginTrains(table, replace);
+
+  if (jsonPeek(input) == ']') {
+    input.read();
+    return DeserializationError::Ok;
+  }
+
+  for (;;) {
+    if (jsonPeek(input) == '{') {
+      beginRecord();
+      DeserializationError error =
+          deserializeJson(record, input, DeserializationOption::Filter(filter));
+      if (error) return error;
+      // Only records the table kept: one later than every train of a full
+      // table is counted in droppedTrains instead
+      bool kept = replace ? table.add(record.as<JsonObjectConst>())
+                          : table.upsert(record.as<JsonObjectConst>());
+      if (kept) records++;
+    } else {
+      DeserializationError error = jsonSkip(input);
+      if (error) return error;
+    }
+
+    int c = jsonPeek(input);
+    input.read();
+    if (c == ']') return DeserializationError::Ok;
+    if (c != ',') return jsonEnd(c);
+  }
+}
+
+DeserializationError TrainDecoder::decodeJsonRemoves(Stream& input,
+                                                     TrainTable& table) {
+  if (jsonPeek(input) != '[') return jsonSkip(input);
+  input.read();
+
+  if (jsonPeek(input) == ']') {
+    input.read();
+    return DeserializationError::Ok;
+  }
+
+  for (;;) {
+    DeserializationError error;
+    if (jsonPeek(input) == '"') {
+      char tripId[sizeof(Train::trip_id)];
+      error = jsonString(input, tripId, sizeof(tripId));
+      if (!error) table.remove(tripId);
+    } else {
+      error = jsonSkip(input);
+    }
+    if (error) return error;
+
+    int c = jsonPeek(input);
+    input.read();
+    if (c == ']') return DeserializationError::Ok;
+    if (c != ',') return jsonEnd(c);
+  }
+}
+
+// ---------------------------------------------------------------------------
+// MessagePack
+// ---------------------------------------------------------------------------
+
+static bool msgPackRead(Stream& input, uint8_t* dest, size_t count) {
+  return input.readBytes((char*)dest, count) == count;
+}
+
+/**
+ * Read a big-endian length of `size` bytes
+ */
+static bool msgPackLength(Stream& input, size_t size, uint32_t& length) {
+  uint8_t bytes[4];
+  if (!msgPackRead(input, bytes, size)) return false;
+  length = 0;
+  for (size_t i = 0; i < size; i++) length = (length << 8) | bytes[i];
+  return true;
+}
+
+static bool msgPackDiscard(Stream& input, uint32_t count) {
+  uint8_t scratch[32];
+  while (count > 0) {
+    size_t n = count < sizeof(scratch) ? count : sizeof(scratch);
+    if (!msgPackRead(input, scratch, n)) return false;
+    count -= n;
+  }
+  return true;
+}
+
+/**
+ * Length of a map (entries) or array (elements) from its header byte, or
+ * false if the header is something else
+ */
+static bool msgPackContainer(Stream& input, uint8_t header, bool map,
+                             uint32_t& count, bool& ok) {
+  ok = true;
+  if (map ? (header & 0xF0) == 0x80 : (header & 0xF0) == 0x90) {
+    count = header & 0x0F;
+    return true;
+  }
+  uint8_t base = map ? 0xDE : 0xDC;
+  if (header == base || header == base + 1) {
+    ok = msgPackLength(input, header == base ? 2 : 4, count);
+    return true;
+  }
+  return false;
+}
+
+/**
+ * Consume the rest of the value that starts with `header`
+ */
+static DeserializationError msgPackSkip(Stream& input, uint8_t header,
+                                        uint8_t depth = 0) {
+  uint32_t length = 0;
+  uint32_t values = 0; // Nested values that follow
+  bool ok = true;
+
+  if (header <= 0x7F || header >= 0xE0 || header == 0xC0 || header == 0xC2 ||
+      header == 0xC3) {
+    // Fixint, nil, bool: no payload
+  } else if ((header & 0xE0) == 0xA0) {
+    length = header & 0x1F;
+  } else if (msgPackContainer(input, header, true, values, ok)) {
+    values *= 2;
+  } else if (msgPackContainer(input, header, false, values, ok)) {
+    // Array: values already holds the element count
+  } else {
+    switch (header) {
+      case 0xC4: case 0xD9: ok = msgPackLength(input, 1, length); break;
+      case 0xC5: case 0xDA: ok = msgPackLength(input, 2, length); break;
+      case 0xC6: case 0xDB: ok = msgPackLength(input, 4, length); break;
+      case 0xC7: ok = msgPackLength(input, 1, length); length++; break;
+      case 0xC8: ok = msgPackLength(input, 2, length); length++; break;
+      case 0xC9: ok = msgPackLength(input, 4, length); length++; break;
+      case 0xCC: case 0xD0: length = 1; break;
+      case 0xCD: case 0xD1: length = 2; break;
+      case 0xCA: case 0xCE: case 0xD2: length = 4; break;
+      case 0xCB: case 0xCF: case 0xD3: length = 8; break;
+      case 0xD4: length = 2; break;
+      case 0xD5: length = 3; break;
+      case 0xD6: length = 5; break;
+      case 0xD7: length = 9; break;
+      case 0xD8: length = 17; break;
+      default: return DeserializationError::InvalidInput; // 0xC1
+    }
+  }
+
+  if (!ok || !msgPackDiscard(input, length)) {
+    return DeserializationError::IncompleteInput;
+  }
+  if (values > 0 && depth >= SKIP_DEPTH_LIMIT) {
+    return DeserializationError::TooDeep;
+  }
+
+  for (uint32_t i = 0; i < values; i++) {
+    uint8_t next;
+    if (!msgPackRead(input, &next, 1)) return DeserializationError::IncompleteInput;
+    DeserializationError error = msgPackSkip(input, next, depth + 1);
+    if (error) return error;
+  }
+  return DeserializationError::Ok;
+}
+
+/**
+ * Consume the rest of the value that starts with `header`. If it is a
+ * string, up to size - 1 bytes of it are kept in buffer and isString is set.
+ */
+static DeserializationError msgPackText(Stream& input, uint8_t header,
+                                        char* buffer, size_t size,
+                                        bool& isString) {
+  uint32_t length = 0;
+  isString = true;
+  buffer[0] = '\0';
+
+  if ((header & 0xE0) == 0xA0) {
+    length = header & 0x1F;
+  } else if (header >= 0xD9 && header <= 0xDB) {
+    if (!msgPackLength(input, (size_t)1 << (header - 0xD9), length)) {
+      return DeserializationError::IncompleteInput;
+    }
+  } else {
+    isString = false;
+    return msgPackSkip(input, header);
+  }
+
+  size_t kept = length < size - 1 ? length : size - 1;
+  if (!msgPackRead(input, (uint8_t*)buffer, kept) ||
+      !msgPackDiscard(input, length - kept)) {
+    return DeserializationError::IncompleteInput;
+  }
+  buffer[kept] = '\0';
+  return DeserializationError::Ok;
+}
+
+/**
+ * Read a value, storing it in `value` if it is a non-negative integer
+ * (anything else leaves 0)
+ */
+static DeserializationError msgPackUnsigned(Stream& input, uint32_t& value) {
+  uint8_t header;
+  if (!msgPackRead(input, &header, 1)) return DeserializationError::IncompleteInput;
+
+  value = 0;
+  if (header <= 0x7F) {
+    value = header;
+    return DeserializationError::Ok;
+  }
+  if (header < 0xCC || header > 0xCF) return msgPackSkip(input, header);
+
+  // uint8 / 16 / 32 / 64; a 64-bit value keeps its low 32 bits
+  size_t size = (size_t)1 << (header - 0xCC);
+  uint8_t bytes[8];
+  if (!msgPackRead(input, bytes, size)) return DeserializationError::IncompleteInput;
+  for (size_t i = 0; i < size; i++) value = (value << 8) | bytes[i];
+  return DeserializationError::Ok;
+}
+
+DeserializationError TrainDecoder::decodeMsgPack(Stream& input,
+                                                 TrainTable& table) {
+  uint8_t header;
+  if (!msgPackRead(input, &header, 1)) return DeserializationError::EmptyInput;
+
+  uint32_t entries;
+  bool ok;
+  if (!msgPackContainer(input, header, true, entries, ok)) {
+    return DeserializationError::InvalidInput;
+  }
+  if (!ok) return DeserializationError::IncompleteInput;
+
+  for (uint32_t i = 0; i < entries; i++) {
+    if (!msgPackRead(input, &header, 1)) return DeserializationError::IncompleteInput;
+
+    // Keys are strings; the value of a key of any other type is skipped
+    char key[KEY_CAPACITY];
+    bool isString;
+    DeserializationError error =
+        msgPackText(input, header, key, sizeof(key), isString);
+    if (error) return error;
+
+    if (isDeltaKey(key)) delta = true;
+
+    if (strcmp(key, "trains") == 0) {
+      error = decodeMsgPackTrains(input, table, true);
+    } else if (strcmp(key, "upserts") == 0) {
+      error = decodeMsgPackTrains(input, table, false);
+    } else if (strcmp(key, "removes") == 0) {
+      error = decodeMsgPackRemoves(input, table);
+    } else if (strcmp(key, "seq") == 0) {
+      error = msgPackUnsigned(input, seq);
+    } else if (strcmp(key, "base") == 0) {
+      error = msgPackUnsigned(input, base);
+    } else {
+      if (!msgPackRead(input, &header, 1)) return DeserializationError::IncompleteInput;
+      error = msgPackSkip(input, header);
+    }
+    if (error) return error;
+  }
+  return DeserializationError::Ok;
+}
+
+DeserializationError TrainDecoder::decodeMsgPackTrains(Stream& input,
+                                                       TrainTable& table,
+                                                       bool replace) {
+  uint8_t header;
+  if (!msgPackRead(input, &header, 1)) return DeserializationError::IncompleteInput;
+
+  // Anything but an array (nil, say) is treated like a missing key
+  uint32_t elements;
+  bool ok;
+  if (!msgPackContainer(input, header, false, elements, ok)) {
+    return msgPackSkip(input, header);
+  }
+  if (!ok) return DeserializationError::IncompleteInput;
+  beginTrains(table, replace);
+
+  for (uint32_t i = 0; i < elements; i++) {
+    int next = input.peek();
+    if (next < 0) return DeserializationError::IncompleteInput;
+
+    if ((next & 0xF0) == 0x80 || next == 0xDE || next == 0xDF) {
+      beginRecord();
+      DeserializationError error = deserializeMsgPack(
+          record, input, DeserializationOption::Filter(filter));
+      if (error) return error;
+      // Only records the table kept: one later than every train of a full
+      // table is counted in droppedTrains instead
+      bool kept = replace ? table.add(record.as<JsonObjectConst>())
+                          : table.upsert(record.as<JsonObjectConst>());
+      if (kept) records++;
+    } else {
+      input.read();
+      DeserializationError error = msgPackSkip(input, (uint8_t)next);
+      if (error) return error;
+    }
+  }
+  return DeserializationError::Ok;
+}
+
+DeserializationError TrainDecoder::decodeMsgPackRemoves(Stream& input,
+                                                        TrainTable& table) {
+  uint8_t header;
+  if (!msgPackRead(input, &header, 1)) return DeserializationError::IncompleteInput;
+
+  uint32_t elements;
+  bool ok;
+  if (!msgPackContainer(input, header, false, elements, ok)) {
+    return msgPackSkip(input, header);
+  }
+  if (!ok) return DeserializationError::IncompleteInput;
+
+  for (uint32_t i = 0; i < elements; i++) {
+    if (!msgPackRead(input, &header, 1)) return DeserializationError::IncompleteInput;
+
+    char tripId[sizeof(Train::trip_id)];
+    bool isString;
+    DeserializationError error =
+        msgPackText(input, header, tripId, sizeof(tripId), isString);
+    if (error) return error;
+    if (isString) table.remove(tripId);
+  }
+  return DeserializationError::Ok;
+}
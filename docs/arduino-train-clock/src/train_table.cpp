@@ -0,0 +1,255 @@
+/**
+ * Train Table - implementation
+ *
+ * See train_table.h for an overview.
+ */
+
+#include "train_table.h"
+
+void TrainTable::clear() {
+  hasTrainList = false;
+  incomplete = false;
+  count = 0;
+  droppedTrains = 0;
+  strings.clear();
+}
+
+/**
+ * Fill `train` from `object`, sort key included
+ */
+static void loadTrain(Train& train, JsonObjectConst object, StringPool& strings) {
+#define X(key, kind, fallback) kind::load(train.key, object[#key], fallback, strings);
+  TRAIN_FIELDS(X)
+#undef X
+  train.departs = departureKey(train.arrival_time);
+}
+
+bool TrainTable::add(JsonObjectConst object) {
+  if (count < MAX_TRAINS) {
+    loadTrain(trains[count++], object, strings);
+    return true;
+  }
+
+  // Full: keep the earliest MAX_TRAINS. Only the time is read before it is
+  // known whether the train stays, so one that does not costs no strings.
+  droppedTrains++;
+  time_t arrival;
+  LocalTime::load(arrival, object["arrival_time"], "", strings);
+
+  uint8_t latest = 0;
+  for (uint8_t i = 1; i < count; i++) {
+    if (trains[i].departs >= trains[latest].departs) latest = i;
+  }
+  if (departureKey(arrival) >= trains[latest].departs) return false;
+
+  // The replaced train's strings stay in the pool until it is compacted;
+  // once they crowd out the new train's, compact and load it again
+  loadTrain(trains[latest], object, strings);
+  if (strings.overflowed()) {
+    compactStrings();
+    loadTrain(trains[latest], object, strings);
+  }
+  return true;
+}
+
+bool TrainTable::upsert(JsonObjectConst object) {
+  // Look up the id as stored, i.e. truncated like the trip_id field
+  char tripId[sizeof(Train::trip_id)];
+  strncpy(tripId, object["trip_id"] | "", sizeof(tripId) - 1);
+  tripId[sizeof(tripId) - 1] = '\0';
+
+  int index = find(tripId);
+  if (index < 0) return add(object);
+
+  loadTrain(trains[index], object, strings);
+  return true;
+}
+
+bool TrainTable::remove(const char* tripId) {
+  int index = find(tripId);
+  if (index < 0) return false;
+
+  // Keep the remaining trains in order
+  memmove(&trains[index], &trains[index + 1],
+          (count - index - 1) * sizeof(Train));
+  count--;
+  return true;
+}
+
+int TrainTable::find(const char* tripId) const {
+  for (uint8_t i = 0; i < count; i++) {
+    if (strcmp(trains[i].trip_id, tripId) == 0) return i;
+  }
+  return -1;
+}
+
+bool TrainTable::sameRows(const TrainTable& other) const {
+  if (hasTrainList != other.hasTrainList || count != other.count) return false;
+  for (uint8_t i = 0; i < count; i++) {
+    if (strcmp(trains[i].trip_id, other.trains[i].trip_id) != 0) return false;
+  }
+  return true;
+}
+
+bool TrainTable::sameTrain(uint8_t i, const TrainTable& other, uint8_t j) const {
+  const Train& a = trains[i];
+  const Train& b = other.trains[j];
+#define X(key, kind, fallback) \
+  if (!kind::equal(a.key, strings, b.key, other.strings)) return false;
+  TRAIN_FIELDS(X)
+#undef X
+  return true;
+}
+
+uint8_t TrainTable::dropDeparted(time_t before) {
+  uint32_t cutoff = departureKey(before);
+  uint8_t kept = 0;
+  for (uint8_t i = 0; i < count; i++) {
+    if (trains[i].departs < cutoff) continue;
+    if (kept != i) trains[kept] = trains[i];
+    kept++;
+  }
+  uint8_t dropped = count - kept;
+  count = kept;
+  return dropped;
+}
+
+void TrainTable::setArrival(uint8_t index, time_t arrival) {
+  trains[index].arrival_time = arrival;
+  trains[index].departs = departureKey(arrival);
+}
+
+void TrainTable::merge(const TrainTable* sources, uint8_t sourceCount,
+                       time_t departedBefore) {
+  // Choose the earliest trains first and copy them in afterwards, so the
+  // strings of trains that do not make the cut never enter the pool
+  struct Pick {
+    uint8_t source;
+    uint8_t index;
+  };
+  Pick picks[MAX_TRAINS];
+  uint8_t picked = 0;
+  uint16_t dropped = 0;
+  bool listed = false;
+  bool partial = false;
+
+  uint32_t cutoff = departedBefore == TIME_UNKNOWN ? 0 : departureKey(departedBefore);
+
+  for (uint8_t s = 0; s < sourceCount; s++) {
+    const TrainTable& source = sources[s];
+    listed = listed || source.hasTrainList;
+    partial = partial || source.incomplete;
+    dropped += source.droppedTrains;
+
+    for (uint8_t i = 0; i < source.count; i++) {
+      const Train& train = source.trains[i];
+      if (train.departs < cutoff) continue;
+
+      bool duplicate = false;
+      for (uint8_t p = 0; p < picked && !duplicate; p++) {
+        const Train& other = sources[picks[p].source].trains[picks[p].index];
+        duplicate = strcmp(other.trip_id, train.trip_id) == 0;
+      }
+      if (duplicate) continue;
+
+      // After every train leaving no later, so equal times keep their order
+      uint8_t at = picked;
+      while (at > 0 &&
+             train.departs < sources[picks[at - 1].source].trains[picks[at - 1].index].departs) {
+        at--;
+      }
+      if (at >= MAX_TRAINS) {
+        dropped++;
+        continue;
+      }
+      if (picked == MAX_TRAINS) {
+        dropped++; // The latest train falls off the board
+        picked--;
+      }
+      memmove(&picks[at + 1], &picks[at], (picked - at) * sizeof(Pick));
+      picks[at].source = s;
+      picks[at].index = i;
+      picked++;
+    }
+  }
+
+  clear();
+  hasTrainList = listed;
+  incomplete = partial;
+  droppedTrains = dropped;
+  seq = sourceCount == 1 ? sources[0].seq : 0;
+
+  for (uint8_t p = 0; p < picked; p++) {
+    const TrainTable& source = sources[picks[p].source];
+    Train& train = trains[count++];
+    train = source.trains[picks[p].index];
+#define X(key, kind, fallback) kind::rehome(train.key, source.strings, strings);
+    TRAIN_FIELDS(X)
+#undef X
+  }
+}
+
+void TrainTable::overlay(const TrainTable& realtime) {
+  // [0] the timetable with realtime applied, [1] trips only realtime has
+  static TrainTable parts[2];
+  TrainTable& patched = parts[0];
+  TrainTable& unscheduled = parts[1];
+  patched.clear();
+  unscheduled.clear();
+
+  for (uint8_t i = 0; i < count; i++) {
+    Train& train = patched.trains[patched.count++];
+    train = trains[i];
+#define X(key, kind, fallback) kind::rehome(train.key, strings, patched.strings);
+    TRAIN_FIELDS(X)
+#undef X
+
+    int j = realtime.find(train.trip_id);
+    if (j < 0) continue;
+
+    const Train& live = realtime.trains[j];
+    time_t scheduled = train.arrival_time;
+#define X(key, kind, fallback)                                   \
+  if (!kind::isFallback(live.key, realtime.strings, fallback)) { \
+    memcpy(&train.key, &live.key, sizeof(train.key));            \
+    kind::rehome(train.key, realtime.strings, patched.strings);  \
+  }
+    TRAIN_FIELDS(X)
+#undef X
+    if (live.arrival_time == TIME_UNKNOWN && scheduled != TIME_UNKNOWN) {
+      train.arrival_time = scheduled + live.delay_seconds;
+    }
+    train.departs = departureKey(train.arrival_time);
+  }
+
+  for (uint8_t j = 0; j < realtime.count; j++) {
+    const Train& live = realtime.trains[j];
+    if (live.arrival_time == TIME_UNKNOWN || find(live.trip_id) >= 0) continue;
+
+    Train& train = unscheduled.trains[unscheduled.count++];
+    train = live;
+#define X(key, kind, fallback) kind::rehome(train.key, realtime.strings, unscheduled.strings);
+    TRAIN_FIELDS(X)
+#undef X
+  }
+
+  // Sorts by the patched times, so a delayed train moves down the board
+  patched.hasTrainList = true;
+  unscheduled.droppedTrains = realtime.droppedTrains;
+  merge(parts, 2);
+  seq = realtime.seq;
+  incomplete = realtime.incomplete;
+}
+
+void TrainTable::compactStrings() {
+  static StringPool live;
+  live.clear();
+
+  for (uint8_t i = 0; i < count; i++) {
+    Train& train = trains[i];
+#define X(key, kind, fallback) kind::rehome(train.key, strings, live);
+    TRAIN_FIELDS(X)
+#undef X
+  }
+  strings = live;
+}
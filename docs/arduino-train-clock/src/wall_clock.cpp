@@ -0,0 +1,61 @@
+/**
+ * Wall Clock - implementation
+ *
+ * See wall_clock.h for an overview.
+ */
+
+#include "wall_clock.h"
+
+#include <Arduino.h>
+#include "config.h"
+#include "config_defaults.h"
+
+// Anything earlier means SNTP has not answered yet (2021-01-01)
+static const time_t MIN_SYNCED_TIME = 1609459200;
+
+static const time_t SECONDS_PER_DAY = 24 * 3600;
+
+void applyTimeZone() {
+  setenv("TZ", TIME_ZONE, 1);
+  tzset();
+}
+
+void beginTimeSync() {
+  configTzTime(TIME_ZONE, NTP_SERVER);
+}
+
+bool timeSynced() {
+  return time(nullptr) >= MIN_SYNCED_TIME;
+}
+
+time_t localTimeNear(int32_t secondsAfterMidnight) {
+  if (secondsAfterMidnight < 0) return TIME_UNKNOWN;
+
+  time_t now = time(nullptr);
+  struct tm local;
+  localtime_r(&now, &local);
+
+  // mktime normalizes hours past 23 into the next day
+  local.tm_hour = secondsAfterMidnight / 3600;
+  local.tm_min = secondsAfterMidnight / 60 % 60;
+  local.tm_sec = secondsAfterMidnight % 60;
+  local.tm_isdst = -1;
+  time_t when = mktime(&local);
+  if (when == TIME_UNKNOWN) return TIME_UNKNOWN;
+
+  // Boards span a few hours, so the nearest day is the right one
+  if (timeSynced()) {
+    if (when - now > SECONDS_PER_DAY / 2) when -= SECONDS_PER_DAY;
+    if (now - when > SECONDS_PER_DAY / 2) when += SECONDS_PER_DAY;
+  }
+  return when;
+}
+
+void formatLocalTime(time_t when, const char* format, char* buffer,
+                     size_t size, const char* fallback) {
+  struct tm local;
+  if (when == TIME_UNKNOWN || localtime_r(&when, &local) == nullptr ||
+      strftime(buffer, size, format, &local) == 0) {
+    snprintf(buffer, size, "%s", fallback);
+  }
+}
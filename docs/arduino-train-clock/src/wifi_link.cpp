@@ -0,0 +1,194 @@
+/**
+ * Non-blocking WiFi Connection - implementation
+ *
+ * See wifi_link.h for an overview.
+ */
+
+#include "wifi_link.h"
+
+#include <Preferences.h>
+#include "config.h"
+
+// Give up on an attempt after this long (association + DHCP)
+const unsigned long CONNECT_TIMEOUT_MS = 20000;
+
+// Retry delays after failed attempts: 1 s, 2 s, 4 s ... 60 s
+const unsigned long BACKOFF_INITIAL_MS = 1000;
+const unsigned long BACKOFF_MAX_MS = 60000;
+
+// NVS namespace for the cached AP
+static const char* NVS_NAMESPACE = "wifi";
+
+void WiFiLink::begin(const char* ssid, const char* password) {
+  this->ssid = ssid;
+  this->password = password;
+
+  // Our own state machine decides when to reconnect, and the credentials
+  // come from config.h, so keep the driver from doing either
+  WiFi.persistent(false);
+  WiFi.setAutoReconnect(false);
+  WiFi.mode(WIFI_STA);
+
+#ifdef WIFI_STATIC_IP
+  IPAddress ip, gateway, subnet, dns;
+  ip.fromString(WIFI_STATIC_IP);
+  gateway.fromString(WIFI_GATEWAY);
+  subnet.fromString(WIFI_SUBNET);
+  dns.fromString(WIFI_DNS);
+  if (!WiFi.config(ip, gateway, subnet, dns)) {
+    Serial.println("Static IP configuration failed, using DHCP");
+  }
+#endif
+
+  WiFi.onEvent([this](arduino_event_id_t event, arduino_event_info_t info) {
+    onEvent(event, info);
+  });
+
+  loadCachedAp();
+  state = WIFI_LINK_IDLE;
+}
+
+/**
+ * Runs in the WiFi event task: only record what happened
+ */
+void WiFiLink::onEvent(arduino_event_id_t event, arduino_event_info_t info) {
+  switch (event) {
+    case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+      gotIp = true;
+      break;
+    case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+      lostReason = info.wifi_sta_disconnected.reason;
+      linkLost = true;
+      break;
+    default:
+      break;
+  }
+}
+
+void WiFiLink::startAttempt() {
+  gotIp = false;
+  linkLost = false;
+
+  fastConnect = (cachedChannel != 0);
+
+  Serial.print("Connecting to WiFi network: ");
+  Serial.print(ssid);
+  if (fastConnect) {
+    Serial.print(" (cached AP, channel ");
+    Serial.print(cachedChannel);
+    Serial.print(")");
+  }
+  Serial.println();
+
+  if (fastConnect) {
+    WiFi.begin(ssid, password, cachedChannel, cachedBssid);
+  } else {
+    WiFi.begin(ssid, password);
+  }
+
+  state = WIFI_LINK_CONNECTING;
+  stateSince = millis();
+}
+
+void WiFiLink::attemptFailed(uint8_t reason) {
+  WiFi.disconnect();
+
+  Serial.print("WiFi connection failed");
+  if (reason != 0) {
+    Serial.print(" (reason ");
+    Serial.print(reason);
+    Serial.print(")");
+  }
+
+  // The cached AP may be gone or on another channel: scan next time
+  if (fastConnect) {
+    cachedChannel = 0;
+    Serial.println(", retrying with a full scan");
+    backoffMs = 0;
+  } else {
+    backoffMs = (backoffMs == 0) ? BACKOFF_INITIAL_MS : backoffMs * 2;
+    if (backoffMs > BACKOFF_MAX_MS) backoffMs = BACKOFF_MAX_MS;
+    Serial.print(", retrying in ");
+    Serial.print(backoffMs / 1000);
+    Serial.println(" s");
+    if (reason == WIFI_REASON_AUTH_FAIL || reason == WIFI_REASON_NO_AP_FOUND) {
+      Serial.println("Please check credentials in config.h");
+    }
+  }
+
+  state = WIFI_LINK_BACKOFF;
+  stateSince = millis();
+}
+
+void WiFiLink::update() {
+  unsigned long now = millis();
+
+  switch (state) {
+    case WIFI_LINK_IDLE:
+      startAttempt();
+      break;
+
+    case WIFI_LINK_CONNECTING:
+      if (gotIp.exchange(false)) {
+        state = WIFI_LINK_CONNECTED;
+        stateSince = now;
+        backoffMs = 0;
+        saveCachedAp();
+      } else if (linkLost.exchange(false)) {
+        attemptFailed(lostReason);
+      } else if (now - stateSince >= CONNECT_TIMEOUT_MS) {
+        attemptFailed(0);
+      }
+      break;
+
+    case WIFI_LINK_CONNECTED:
+      if (linkLost.exchange(false)) {
+        drops++;
+        Serial.print("WiFi link lost (reason ");
+        Serial.print(lostReason.load());
+        Serial.println("), reconnecting");
+
+        // A blip usually clears at once: retry the same AP immediately
+        backoffMs = 0;
+        state = WIFI_LINK_BACKOFF;
+        stateSince = now;
+      }
+      break;
+
+    case WIFI_LINK_BACKOFF:
+      if (now - stateSince >= backoffMs) startAttempt();
+      break;
+  }
+}
+
+void WiFiLink::loadCachedAp() {
+  Preferences prefs;
+  if (!prefs.begin(NVS_NAMESPACE, true)) return;
+
+  if (prefs.getBytes("bssid", cachedBssid, sizeof(cachedBssid)) == sizeof(cachedBssid)) {
+    cachedChannel = prefs.getUChar("channel", 0);
+  } else {
+    cachedChannel = 0;
+  }
+  prefs.end();
+}
+
+void WiFiLink::saveCachedAp() {
+  const uint8_t* bssid = WiFi.BSSID();
+  uint8_t channel = (uint8_t)WiFi.channel();
+  if (bssid == nullptr || channel == 0) return;
+
+  // Only touch flash when the AP actually changed
+  if (channel == cachedChannel && memcmp(bssid, cachedBssid, sizeof(cachedBssid)) == 0) {
+    return;
+  }
+
+  memcpy(cachedBssid, bssid, sizeof(cachedBssid));
+  cachedChannel = channel;
+
+  Preferences prefs;
+  if (!prefs.begin(NVS_NAMESPACE, false)) return;
+  prefs.putBytes("bssid", cachedBssid, sizeof(cachedBssid));
+  prefs.putUChar("channel", cachedChannel);
+  prefs.end();
+}
@@ -0,0 +1,195 @@
+#!/usr/bin/env python3
+"""
+Pack one station's static GTFS timetable into the clock's schedule image
+
+The image is flashed to the "schedule" partition (see partitions.csv) and
+read in place by the firmware (include/schedule_index.h), which builds the
+board from it and only needs delays and track changes from the server.
+
+Usage:
+    python tools/pack_schedule.py GTFS_DIR --stop-id 1 --output schedule.bin
+    python tools/pack_schedule.py GTFS_DIR --stop-id 1 --days 30 --start 2024-05-01
+
+GTFS_DIR is an unpacked static feed (routes.txt, trips.txt, stop_times.txt,
+calendar.txt and/or calendar_dates.txt), as update_gtfs.py downloads it.
+`pio run -t schedule` and `pio run -t uploadschedule` call this script with
+the custom_schedule_* options of platformio.ini (tools/schedule_image.py).
+
+Image layout (little-endian; keep in step with src/schedule_index.cpp):
+    header          HEADER below, HEADER_SIZE bytes
+    services        one bitmap per service, (days + 7) // 8 bytes each:
+                    bit d set if the service runs on day d of the window
+    routes          u32 string offset per route
+    departures      DEPARTURE records, sorted by time
+    strings         NUL-terminated, deduplicated; offset 0 is ""
+Departure times are seconds since noon minus 12 hours of the service day
+(GTFS's definition, so 25:10:00 is 01:10 the next morning).
+"""
+
+import argparse
+import os
+import struct
+import sys
+import time
+from datetime import date
+from pathlib import Path
+
+TOOLS_DIR = os.path.dirname(os.path.abspath(__file__))
+sys.path.insert(0, os.path.abspath(os.path.join(TOOLS_DIR, '../../..')))
+
+from src.gtfs_static_reader import GTFSStaticReader  # noqa: E402
+
+MAGIC = 0x53524E4D  # "MNRS"
+VERSION = 1
+
+# magic, version, headerSize, imageSize, checksum, builtAt, firstDay,
+# dayCount, serviceCount, routeCount, reserved, departureCount,
+# stationName, servicesOffset, routesOffset, departuresOffset, stringsOffset
+HEADER = struct.Struct('<IHHIIIIHHHHIIIIII')
+HEADER_SIZE = HEADER.size
+
+# seconds, tripId, headsign, service, route
+DEPARTURE = struct.Struct('<IIIHH')
+
+# Size of the schedule partition in partitions.csv
+PARTITION_SIZE = 0x200000
+
+
+def fnv1a(data):
+    """FNV-1a, as the firmware checks the image (src/schedule_index.cpp)"""
+    value = 2166136261
+    for byte in data:
+        value = ((value ^ byte) * 16777619) & 0xFFFFFFFF
+    return value
+
+
+def parse_gtfs_time(text):
+    """'HH:MM:SS' (hours may pass 24) to seconds, or None"""
+    try:
+        hours, minutes, seconds = (int(part) for part in text.split(':'))
+    except ValueError:
+        return None
+    return hours * 3600 + minutes * 60 + seconds
+
+
+class StringTable:
+    """Deduplicated NUL-terminated strings, addressed by byte offset"""
+
+    def __init__(self):
+        self.blob = bytearray(b'\0')
+        self.offsets = {'': 0}
+
+    def add(self, text):
+        if text not in self.offsets:
+            self.offsets[text] = len(self.blob)
+            self.blob += text.encode('utf-8') + b'\0'
+        return self.offsets[text]
+
+
+def align(data, boundary=4):
+    data += b'\0' * (-len(data) % boundary)
+
+
+def pack(reader, stop_id, start, days):
+    """Build the image for stop_id's departures over days from start"""
+    stop = reader.get_stop_info(stop_id)
+    if stop is None:
+        raise ValueError(f'stop {stop_id} is not in stops.txt')
+
+    strings = StringTable()
+    station_name = strings.add(stop['stop_name'])
+    running = reader.get_service_dates(start, days)
+
+    services = {}  # service_id -> index
+    routes = {}    # route_id -> index
+    route_names = []
+    records = []
+    for departure in reader.get_departures(stop_id):
+        trip = reader.get_trip_info(departure['trip_id'])
+        seconds = parse_gtfs_time(departure['departure_time'])
+        if trip is None or seconds is None:
+            continue
+        if not running.get(trip['service_id']):
+            continue  # Does not run in the window
+
+        service = services.setdefault(trip['service_id'], len(services))
+        if trip['route_id'] not in routes:
+            route = reader.get_route_info(trip['route_id']) or {}
+            name = route.get('route_long_name') or route.get('route_short_name', '')
+            routes[trip['route_id']] = len(route_names)
+            route_names.append(strings.add(name))
+
+        records.append((seconds, departure['trip_id'], trip['trip_headsign'],
+                        service, routes[trip['route_id']]))
+
+    records.sort(key=lambda record: (record[0], record[1]))
+
+    bitmap_bytes = (days + 7) // 8
+    body = bytearray()
+    services_offset = HEADER_SIZE
+    for service_id, _ in sorted(services.items(), key=lambda item: item[1]):
+        bitmap = bytearray(bitmap_bytes)
+        for day in running[service_id]:
+            index = (day - start).days
+            bitmap[index // 8] |= 1 << (index % 8)
+        body += bitmap
+    align(body)
+
+    routes_offset = HEADER_SIZE + len(body)
+    for name in route_names:
+        body += struct.pack('<I', name)
+
+    departures_offset = HEADER_SIZE + len(body)
+    for seconds, trip_id, headsign, service, route in records:
+        body += DEPARTURE.pack(seconds, strings.add(trip_id),
+                               strings.add(headsign), service, route)
+
+    strings_offset = HEADER_SIZE + len(body)
+    body += strings.blob
+    align(body)
+
+    first_day = (start - date(1970, 1, 1)).days
+    header = HEADER.pack(MAGIC, VERSION, HEADER_SIZE, HEADER_SIZE + len(body),
+                         fnv1a(body), int(time.time()), first_day, days,
+                         len(services), len(route_names), 0, len(records),
+                         station_name, services_offset, routes_offset,
+                         departures_offset, strings_offset)
+    return header + body, len(records), len(services)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n\n')[0])
+    parser.add_argument('gtfs_dir', help='unpacked static GTFS feed')
+    parser.add_argument('--stop-id', required=True,
+                        help='station the clock shows (stop_id in stops.txt)')
+    parser.add_argument('--start', type=date.fromisoformat, default=date.today(),
+                        help='first service day, YYYY-MM-DD (default: today)')
+    parser.add_argument('--days', type=int, default=60,
+                        help='service days covered (default: 60)')
+    parser.add_argument('--output', default='schedule.bin',
+                        help='image file to write (default: schedule.bin)')
+    args = parser.parse_args()
+
+    if not 1 <= args.days <= 366:
+        parser.error('--days must be between 1 and 366')
+
+    reader = GTFSStaticReader(Path(args.gtfs_dir))
+    if not reader.load():
+        sys.exit(f'Could not read the GTFS feed in {args.gtfs_dir}')
+
+    try:
+        image, departures, services = pack(reader, args.stop_id, args.start, args.days)
+    except ValueError as error:
+        sys.exit(str(error))
+    if len(image) > PARTITION_SIZE:
+        sys.exit(f'Image is {len(image)} bytes; the schedule partition holds '
+                 f'{PARTITION_SIZE}. Pack fewer --days.')
+
+    with open(args.output, 'wb') as file:
+        file.write(image)
+    print(f'{args.output}: {departures} departures, {services} services, '
+          f'{args.days} days from {args.start}, {len(image)} bytes')
+
+
+if __name__ == '__main__':
+    main()
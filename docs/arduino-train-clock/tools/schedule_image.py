@@ -0,0 +1,69 @@
+"""
+PlatformIO extra script: build and flash the timetable image
+
+Adds two targets to the board env:
+    pio run -t schedule          pack the image into the build directory
+    pio run -t uploadschedule    pack it and write it to the "schedule"
+                                 partition with esptool
+
+The feed and station come from custom_schedule_gtfs and
+custom_schedule_stop in platformio.ini. esptool talks to the ESP32-S3's ROM
+bootloader, not the Nano ESP32's DFU one: bridge B1 to GND and press reset
+before uploading the image (and press reset again afterwards).
+"""
+
+import csv
+import os
+
+Import("env")  # noqa: F821 (provided by PlatformIO)
+
+PROJECT_DIR = env.subst("$PROJECT_DIR")  # noqa: F821
+IMAGE = os.path.join(env.subst("$BUILD_DIR"), "schedule.bin")  # noqa: F821
+
+# The board uploads firmware with dfu-util, so $UPLOADER is not esptool
+ESPTOOL = os.path.join(
+    env.PioPlatform().get_package_dir("tool-esptoolpy") or "",  # noqa: F821
+    "esptool.py")
+
+
+def partition_offset(name):
+    """Offset of partition `name` in board_build.partitions"""
+    table = env.GetProjectOption("board_build.partitions", "")  # noqa: F821
+    with open(os.path.join(PROJECT_DIR, table), newline="") as file:
+        for row in csv.reader(file):
+            if row and row[0].strip() == name:
+                return row[3].strip()
+    raise ValueError(f"no {name} partition in {table}")
+
+
+gtfs = env.GetProjectOption("custom_schedule_gtfs", "")  # noqa: F821
+stop = env.GetProjectOption("custom_schedule_stop", "")  # noqa: F821
+
+pack = " ".join([
+    '"$PYTHONEXE"',
+    '"%s"' % os.path.join(PROJECT_DIR, "tools", "pack_schedule.py"),
+    '"%s"' % os.path.join(PROJECT_DIR, gtfs),
+    "--stop-id", '"%s"' % stop,
+    "--output", '"%s"' % IMAGE,
+])
+
+env.AddCustomTarget(  # noqa: F821
+    name="schedule",
+    dependencies=None,
+    actions=[pack],
+    title="Pack timetable",
+    description="Pack custom_schedule_stop's timetable from custom_schedule_gtfs",
+)
+
+env.AddCustomTarget(  # noqa: F821
+    name="uploadschedule",
+    dependencies=None,
+    actions=[
+        pack,
+        '"$PYTHONEXE" "%s" --chip esp32s3 --port "$UPLOAD_PORT" '
+        '--baud 921600 write_flash %s "%s"'
+        % (ESPTOOL, partition_offset("schedule"), IMAGE),
+    ],
+    title="Upload timetable",
+    description="Pack the timetable and write it to the schedule partition",
+)
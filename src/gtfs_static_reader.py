@@ -7,8 +7,9 @@ This module provides functionality to read and cache GTFS static schedule data
 
 import csv
 import logging
+from datetime import date, timedelta
 from pathlib import Path
-from typing import Optional, Dict
+from typing import Optional, Dict, Set
 
 logger = logging.getLogger(__name__)
 
@@ -119,12 +120,110 @@ class GTFSStaticReader:
                         'trip_short_name': row.get('trip_short_name', ''),
                         'direction_id': row.get('direction_id', ''),
                         'route_id': row.get('route_id', ''),
+                        'service_id': row.get('service_id', ''),
                         'block_id': row.get('block_id', ''),  # NEW: Block identifier
                         'shape_id': row.get('shape_id', ''),  # NEW: Shape for trip path
                         'wheelchair_accessible': row.get('wheelchair_accessible', ''),  # NEW: Wheelchair accessibility
                         'bikes_allowed': row.get('bikes_allowed', ''),  # NEW: Bike allowance
                     }
     
+    def get_departures(self, stop_id: str) -> list:
+        """
+        Get every scheduled departure from a stop.
+
+        stop_times.txt is read on each call rather than cached, as it is by
+        far the largest GTFS file. Trips that end at the stop, or do not
+        pick up passengers there, are left out.
+
+        Args:
+            stop_id: The stop ID to list departures for
+
+        Returns:
+            List of dictionaries with trip_id, departure_time ("HH:MM:SS",
+            past 24:00 for trips after midnight) and stop_sequence, in file
+            order
+        """
+        stop_times_file = self.gtfs_dir / "stop_times.txt"
+        if not stop_times_file.exists():
+            logger.warning(f"Stop times file not found: {stop_times_file}")
+            return []
+
+        departures = []
+        last_sequence: Dict[str, int] = {}
+        with open(stop_times_file, 'r', encoding='utf-8') as f:
+            reader = csv.DictReader(f)
+            for row in reader:
+                trip_id = row.get('trip_id')
+                try:
+                    sequence = int(row.get('stop_sequence', ''))
+                except ValueError:
+                    continue
+                if trip_id and sequence > last_sequence.get(trip_id, -1):
+                    last_sequence[trip_id] = sequence
+
+                if row.get('stop_id') != stop_id or row.get('pickup_type') == '1':
+                    continue
+                departure_time = row.get('departure_time') or row.get('arrival_time')
+                if trip_id and departure_time:
+                    departures.append({
+                        'trip_id': trip_id,
+                        'departure_time': departure_time.strip(),
+                        'stop_sequence': sequence,
+                    })
+
+        return [d for d in departures
+                if d['stop_sequence'] < last_sequence[d['trip_id']]]
+
+    def get_service_dates(self, start: date, days: int) -> Dict[str, Set[date]]:
+        """
+        Get the dates each service runs on, within a window.
+
+        Combines the weekly patterns of calendar.txt with the exceptions
+        of calendar_dates.txt (either file may be missing).
+
+        Args:
+            start: First date of the window
+            days: Number of dates in the window
+
+        Returns:
+            Dictionary mapping service_id to the set of dates it runs on
+        """
+        window = [start + timedelta(days=i) for i in range(days)]
+        weekdays = ['monday', 'tuesday', 'wednesday', 'thursday', 'friday',
+                    'saturday', 'sunday']
+        services: Dict[str, Set[date]] = {}
+
+        calendar_file = self.gtfs_dir / "calendar.txt"
+        if calendar_file.exists():
+            with open(calendar_file, 'r', encoding='utf-8') as f:
+                for row in csv.DictReader(f):
+                    service_id = row.get('service_id')
+                    if not service_id:
+                        continue
+                    first = _parse_gtfs_date(row.get('start_date', ''))
+                    last = _parse_gtfs_date(row.get('end_date', ''))
+                    runs = services.setdefault(service_id, set())
+                    for day in window:
+                        if (first and last and first <= day <= last and
+                                row.get(weekdays[day.weekday()]) == '1'):
+                            runs.add(day)
+
+        calendar_dates_file = self.gtfs_dir / "calendar_dates.txt"
+        if calendar_dates_file.exists():
+            with open(calendar_dates_file, 'r', encoding='utf-8') as f:
+                for row in csv.DictReader(f):
+                    service_id = row.get('service_id')
+                    day = _parse_gtfs_date(row.get('date', ''))
+                    if not service_id or day is None:
+                        continue
+                    runs = services.setdefault(service_id, set())
+                    if row.get('exception_type') == '1' and day in window:
+                        runs.add(day)
+                    elif row.get('exception_type') == '2':
+                        runs.discard(day)
+
+        return services
+
     def get_route_info(self, route_id: str) -> Optional[dict]:
         """
         Get route information by route ID.
@@ -286,3 +385,11 @@ class GTFSStaticReader:
                         stop['stop_lon'] = stop_info.get('stop_lon', '')
         
         return train_info
+
+
+def _parse_gtfs_date(text: str) -> Optional[date]:
+    """Parse a GTFS date (YYYYMMDD), or None if it is not one"""
+    try:
+        return date(int(text[0:4]), int(text[4:6]), int(text[6:8]))
+    except (ValueError, IndexError):
+        return None
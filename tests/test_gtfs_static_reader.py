@@ -5,6 +5,7 @@ Unit tests for GTFS Static Reader
 import unittest
 import tempfile
 import shutil
+from datetime import date
 from pathlib import Path
 from src.gtfs_static_reader import GTFSStaticReader
 
@@ -42,6 +43,33 @@ class TestGTFSStaticReader(unittest.TestCase):
 """
         with open(self.gtfs_dir / "trips.txt", 'w') as f:
             f.write(trips_content)
+        
+        # Create test stop_times.txt (TRIP_001 leaves Grand Central,
+        # TRIP_002 ends there, TRIP_003 runs past midnight)
+        stop_times_content = """trip_id,arrival_time,departure_time,stop_id,stop_sequence,pickup_type,drop_off_type
+TRIP_001,08:00:00,08:00:00,1,1,0,1
+TRIP_001,08:12:00,08:13:00,4,2,0,0
+TRIP_002,09:10:00,09:11:00,4,1,0,0
+TRIP_002,09:25:00,09:25:00,1,2,1,0
+TRIP_003,24:40:00,24:40:00,1,1,0,1
+TRIP_003,24:52:00,24:52:00,4,2,1,0
+"""
+        with open(self.gtfs_dir / "stop_times.txt", 'w') as f:
+            f.write(stop_times_content)
+        
+        # Create test calendar.txt and calendar_dates.txt (weekdays in
+        # May 2024, but not Memorial Day, which runs service 2 instead)
+        calendar_content = """service_id,monday,tuesday,wednesday,thursday,friday,saturday,sunday,start_date,end_date
+1,1,1,1,1,1,0,0,20240501,20240531
+"""
+        with open(self.gtfs_dir / "calendar.txt", 'w') as f:
+            f.write(calendar_content)
+        calendar_dates_content = """service_id,date,exception_type
+1,20240527,2
+2,20240527,1
+"""
+        with open(self.gtfs_dir / "calendar_dates.txt", 'w') as f:
+            f.write(calendar_dates_content)
     
     def tearDown(self):
         """Clean up test fixtures"""
@@ -164,6 +192,58 @@ class TestGTFSStaticReader(unittest.TestCase):
         self.assertEqual(len(reader._stops), 0)
         self.assertEqual(len(reader._trips), 0)
 
+    def test_trip_service_id(self):
+        """Test that trips keep their service ID"""
+        reader = GTFSStaticReader(self.gtfs_dir)
+        reader.load()
+        
+        self.assertEqual(reader.get_trip_info('TRIP_001')['service_id'], '1')
+    
+    def test_get_departures(self):
+        """Test listing departures from a stop"""
+        reader = GTFSStaticReader(self.gtfs_dir)
+        
+        departures = reader.get_departures('1')
+        times = {d['trip_id']: d['departure_time'] for d in departures}
+        
+        # TRIP_002 ends at Grand Central, so it does not depart from it
+        self.assertEqual(times, {'TRIP_001': '08:00:00', 'TRIP_003': '24:40:00'})
+        
+        # Harlem is the last stop of TRIP_001, and TRIP_003 does not pick up there
+        departures = reader.get_departures('4')
+        self.assertEqual([d['trip_id'] for d in departures], ['TRIP_002'])
+        self.assertEqual(departures[0]['departure_time'], '09:11:00')
+    
+    def test_get_departures_missing_file(self):
+        """Test listing departures without stop_times.txt"""
+        empty_dir = Path(self.test_dir) / "empty"
+        empty_dir.mkdir()
+        
+        reader = GTFSStaticReader(empty_dir)
+        self.assertEqual(reader.get_departures('1'), [])
+    
+    def test_get_service_dates(self):
+        """Test combining calendar.txt with calendar_dates.txt"""
+        reader = GTFSStaticReader(self.gtfs_dir)
+        
+        services = reader.get_service_dates(date(2024, 5, 24), 7)
+        
+        # Friday the 24th, then Tuesday to Thursday; the holiday is removed
+        self.assertEqual(services['1'], {
+            date(2024, 5, 24), date(2024, 5, 28),
+            date(2024, 5, 29), date(2024, 5, 30),
+        })
+        self.assertEqual(services['2'], {date(2024, 5, 27)})
+    
+    def test_get_service_dates_outside_window(self):
+        """Test that dates outside the window are left out"""
+        reader = GTFSStaticReader(self.gtfs_dir)
+        
+        services = reader.get_service_dates(date(2024, 6, 1), 7)
+        
+        self.assertEqual(services['1'], set())
+        self.assertEqual(services['2'], set())
+
 
 if __name__ == '__main__':
     unittest.main()
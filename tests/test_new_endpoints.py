@@ -2,6 +2,7 @@
 Unit tests for new API endpoints: /stations, /routes, /train/<trip_id>, and enhanced /trains filtering.
 """
 
+import json
 import unittest
 from unittest.mock import patch
 import sys
@@ -58,6 +59,29 @@ class TestNewEndpoints(unittest.TestCase):
         self.assertEqual(data['stations'][0]['stop_id'], '1')
         self.assertEqual(data['stations'][0]['stop_name'], 'Grand Central Terminal')
 
+    @patch('web_server.gtfs_reader')
+    def test_stations_endpoint_conditional(self, mock_gtfs_reader):
+        """Test /stations answers 304 until the station list changes."""
+        mock_gtfs_reader.is_loaded.return_value = True
+        mock_gtfs_reader.get_all_stops.return_value = [
+            {'stop_id': '1', 'stop_name': 'Grand Central Terminal', 'stop_code': 'GCT'}
+        ]
+
+        response = self.client.get('/stations')
+        self.assertEqual(response.status_code, 200)
+        etag = response.headers['ETag']
+        self.assertEqual(etag.strip('"'), response.get_json()['version'])
+
+        response = self.client.get('/stations', headers={'If-None-Match': etag})
+        self.assertEqual(response.status_code, 304)
+
+        mock_gtfs_reader.get_all_stops.return_value = [
+            {'stop_id': '1', 'stop_name': 'Grand Central', 'stop_code': 'GCT'}
+        ]
+        response = self.client.get('/stations', headers={'If-None-Match': etag})
+        self.assertEqual(response.status_code, 200)
+        self.assertNotEqual(response.headers['ETag'], etag)
+
     @patch('web_server.gtfs_reader')
     def test_stations_endpoint_not_loaded(self, mock_gtfs_reader):
         """Test /stations endpoint when GTFS data is not loaded."""
@@ -254,6 +278,159 @@ class TestNewEndpoints(unittest.TestCase):
         self.assertGreaterEqual(len(data['trains']), 1)
         self.assertEqual(data['trains'][0]['trip_id'], 'TRIP_1')
 
+    @patch('web_server.gtfs_reader')
+    @patch('web_server.client')
+    def test_trains_endpoint_with_fields(self, mock_client, mock_gtfs_reader):
+        """Test /trains endpoint returns only the requested fields."""
+        from src.gtfs_realtime.com.google.transit.realtime import gtfs_realtime_pb2
+
+        feed = gtfs_realtime_pb2.FeedMessage()
+        feed.header.timestamp = 1609459200
+
+        for i in range(3):
+            entity = feed.entity.add()
+            entity.id = str(i)
+            entity.trip_update.trip.trip_id = f"TRIP_{i}"
+            entity.trip_update.trip.route_id = "1"
+
+        mock_client.fetch_feed.return_value = feed
+        mock_client.get_trip_updates.return_value = [
+            entity.trip_update for entity in feed.entity]
+
+        mock_gtfs_reader.is_loaded.return_value = True
+        mock_gtfs_reader.enrich_train_info.side_effect = lambda x: x
+
+        response = self.client.get('/trains?fields=trip_id,route_id,missing&limit=2')
+        self.assertEqual(response.status_code, 200)
+
+        data = response.get_json()
+        self.assertEqual(len(data['trains']), 2)
+        for train in data['trains']:
+            self.assertEqual(set(train), {'trip_id', 'route_id'})
+        self.assertEqual(data['filters_applied']['fields'], ['trip_id', 'route_id', 'missing'])
+
+    @patch('web_server.gtfs_reader')
+    @patch('web_server.client')
+    def test_trains_endpoint_with_train_clock_query(self, mock_client, mock_gtfs_reader):
+        """Test /trains filters by the query the Arduino train clock sends."""
+        from src.gtfs_realtime.com.google.transit.realtime import gtfs_realtime_pb2
+
+        feed = gtfs_realtime_pb2.FeedMessage()
+        feed.header.timestamp = 1609459200
+
+        # (trip, stops): only A and D call at 56 and end at 1
+        trips = [('TRIP_A', ['56', '1']), ('TRIP_B', ['56', '4']),
+                 ('TRIP_C', ['12', '1']), ('TRIP_D', ['56', '1'])]
+        for trip_id, stops in trips:
+            entity = feed.entity.add()
+            entity.id = trip_id
+            entity.trip_update.trip.trip_id = trip_id
+            entity.trip_update.trip.route_id = "1"
+            for stop_id in stops:
+                entity.trip_update.stop_time_update.add().stop_id = stop_id
+
+        mock_client.fetch_feed.return_value = feed
+        mock_client.get_trip_updates.return_value = [
+            entity.trip_update for entity in feed.entity]
+
+        mock_gtfs_reader.is_loaded.return_value = True
+        mock_gtfs_reader.enrich_train_info.side_effect = lambda x: x
+
+        # As viewQuery() in docs/arduino-train-clock/src/main.cpp builds it,
+        # with API_STATION "56" and API_DESTINATION "1"
+        response = self.client.get(
+            '/trains?fields=trip_id,route,destination,track,arrival_time,status,delay_seconds'
+            '&limit=3&origin_station=56&destination_station=1')
+        self.assertEqual(response.status_code, 200)
+
+        data = response.get_json()
+        self.assertEqual([train['trip_id'] for train in data['trains']], ['TRIP_A', 'TRIP_D'])
+        self.assertEqual(data['filters_applied']['origin_station'], '56')
+        self.assertEqual(data['filters_applied']['destination_station'], '1')
+
+    @patch('web_server.gtfs_reader')
+    @patch('web_server.client')
+    def test_trains_endpoint_conditional(self, mock_client, mock_gtfs_reader):
+        """Test /trains answers 304 until its trains change."""
+        from src.gtfs_realtime.com.google.transit.realtime import gtfs_realtime_pb2
+
+        def feed_of(stop_id, timestamp):
+            feed = gtfs_realtime_pb2.FeedMessage()
+            feed.header.timestamp = timestamp
+            entity = feed.entity.add()
+            entity.id = 'TRIP_A'
+            entity.trip_update.trip.trip_id = 'TRIP_A'
+            entity.trip_update.trip.route_id = "1"
+            entity.trip_update.stop_time_update.add().stop_id = stop_id
+            return feed
+
+        mock_client.get_trip_updates.side_effect = lambda feed: [
+            entity.trip_update for entity in feed.entity]
+        mock_gtfs_reader.is_loaded.return_value = False
+
+        mock_client.fetch_feed.return_value = feed_of('1', 1609459200)
+        response = self.client.get('/trains?fields=trip_id,current_stop')
+        self.assertEqual(response.status_code, 200)
+        etag = response.headers['ETag']
+
+        # A newer feed with the same trains is not a change
+        mock_client.fetch_feed.return_value = feed_of('1', 1609459230)
+        response = self.client.get('/trains?fields=trip_id,current_stop',
+                                   headers={'If-None-Match': etag})
+        self.assertEqual(response.status_code, 304)
+
+        mock_client.fetch_feed.return_value = feed_of('4', 1609459260)
+        response = self.client.get('/trains?fields=trip_id,current_stop',
+                                   headers={'If-None-Match': etag})
+        self.assertEqual(response.status_code, 200)
+        self.assertNotEqual(response.headers['ETag'], etag)
+
+    @patch('web_server.time.sleep')
+    @patch('web_server.gtfs_reader')
+    @patch('web_server.client')
+    def test_trains_stream_pushes_changed_boards(self, mock_client, mock_gtfs_reader, mock_sleep):
+        """Test /trains/stream sends the filtered board, then only changes."""
+        from src.gtfs_realtime.com.google.transit.realtime import gtfs_realtime_pb2
+
+        def feed_of(trip_ids):
+            feed = gtfs_realtime_pb2.FeedMessage()
+            feed.header.timestamp = 1609459200
+            for trip_id in trip_ids:
+                entity = feed.entity.add()
+                entity.id = trip_id
+                entity.trip_update.trip.trip_id = trip_id
+                entity.trip_update.trip.route_id = "1"
+                entity.trip_update.stop_time_update.add().stop_id = "1"
+            return feed
+
+        feeds = [feed_of(['TRIP_A']), feed_of(['TRIP_A']), feed_of(['TRIP_A', 'TRIP_B'])]
+        mock_client.fetch_feed.side_effect = feeds
+        mock_client.get_trip_updates.side_effect = lambda feed: [
+            entity.trip_update for entity in feed.entity]
+        mock_gtfs_reader.is_loaded.return_value = False
+
+        response = self.client.get('/trains/stream?fields=trip_id&destination_station=1')
+        self.assertEqual(response.status_code, 200)
+        self.assertIn('text/event-stream', response.headers['Content-Type'])
+
+        events = iter(response.response)
+        chunks = [next(events) for _ in feeds]
+        response.close()
+        chunks = [chunk.decode() if isinstance(chunk, bytes) else chunk for chunk in chunks]
+
+        # A board on connecting, a heartbeat while unchanged, then the new board
+        self.assertTrue(chunks[0].startswith('event: board\ndata: '))
+        first = json.loads(chunks[0].split('data: ', 1)[1])
+        self.assertEqual(first['trains'], [{'trip_id': 'TRIP_A'}])
+        self.assertEqual(chunks[1], ': keep-alive\n\n')
+        last = json.loads(chunks[2].split('data: ', 1)[1])
+        self.assertEqual([train['trip_id'] for train in last['trains']], ['TRIP_A', 'TRIP_B'])
+
+    def test_trains_stream_rejects_invalid_limit(self):
+        """Test /trains/stream validates its query like /trains."""
+        response = self.client.get('/trains/stream?limit=0')
+        self.assertEqual(response.status_code, 400)
+
 
 class TestFilterHelpers(unittest.TestCase):
     """Test helper functions for filtering trains."""
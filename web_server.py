@@ -11,11 +11,14 @@ Usage:
 """
 
 import argparse
+import hashlib
+import json
 import sys
+import time
 from datetime import datetime, timezone
 import logging
 import requests
-from flask import Flask, jsonify, request
+from flask import Flask, Response, jsonify, request
 from pathlib import Path
 import yaml
 from src.mta_gtfs_client import MTAGTFSRealtimeClient
@@ -37,6 +40,10 @@ gtfs_reader = None
 travel_assistant = None
 FEATURE_FLAGS = GlobalSettings.FeatureFlags.as_dict()
 
+# /trains/stream refetches the feed this often (MTA updates it about every
+# 30 s), and sends a heartbeat comment when nothing changed
+STREAM_CHECK_SECONDS = 15
+
 
 def timestamp_to_datetime(timestamp):
     """Convert Unix timestamp to ISO 8601 datetime string in UTC."""
@@ -463,6 +470,118 @@ def extract_alert_info(alert):
     return alert_info
 
 
+def _parse_trains_query():
+    """
+    Read the /trains query parameters of the current request.
+
+    Returns:
+        (query, None) with the keyword arguments of _trains_response(), or
+        (None, error) with the 400 response for an invalid parameter
+    """
+    city = request.args.get('city', 'mnr').lower()
+    limit_param = request.args.get('limit', 20)
+    try:
+        limit = int(limit_param)
+    except (ValueError, TypeError):
+        return None, (jsonify({
+            'error': f'Invalid value for "limit": {limit_param}. Must be an integer between 1 and 100.'
+        }), 400)
+    if not (1 <= limit <= 100):
+        return None, (jsonify({
+            'error': f'Invalid value for "limit": {limit}. Must be an integer between 1 and 100.'
+        }), 400)
+    fields_param = request.args.get('fields')
+
+    # Currently only supports MNR (Metro-North Railroad)
+    if city not in ['mnr', 'metro-north', 'metronorth']:
+        return None, (jsonify({
+            'error': 'Unsupported city. Currently only supports "mnr" (Metro-North Railroad)',
+            'supported_cities': ['mnr', 'metro-north', 'metronorth']
+        }), 400)
+
+    return {
+        'limit': min(limit, 100),
+        'origin_station': request.args.get('origin_station'),
+        'destination_station': request.args.get('destination_station'),
+        'route_filter': request.args.get('route'),
+        'time_from': request.args.get('time_from'),
+        'time_to': request.args.get('time_to'),
+        'fields': [field for field in fields_param.split(',') if field] if fields_param else None,
+    }, None
+
+
+def _trains_response(limit, origin_station, destination_station, route_filter,
+                     time_from, time_to, fields):
+    """
+    Fetch the GTFS-RT feed and build the /trains response body.
+
+    Raises whatever fetching the feed raises (requests.RequestException).
+    """
+    # Fetch the GTFS-RT feed
+    feed = client.fetch_feed()
+
+    # Extract trip updates
+    all_trip_updates = client.get_trip_updates(feed)
+
+    # Convert to simplified format and apply filters
+    trains = []
+    for trip_update in all_trip_updates:
+        train_info = extract_train_info(trip_update)
+        # Enrich with GTFS static data
+        if gtfs_reader and gtfs_reader.is_loaded():
+            train_info = gtfs_reader.enrich_train_info(train_info)
+        
+        # Apply filters
+        if route_filter and train_info.get('route_id') != route_filter:
+            continue
+        
+        if origin_station and not _train_passes_through_station(train_info, origin_station):
+            continue
+        
+        if destination_station and not _train_goes_to_destination(train_info, destination_station):
+            continue
+        
+        if time_from or time_to:
+            if not _train_in_time_range(train_info, time_from, time_to):
+                continue
+        
+        if fields is not None:
+            train_info = {key: train_info[key] for key in fields if key in train_info}
+
+        trains.append(train_info)
+        
+        # Apply limit after filtering
+        if len(trains) >= limit:
+            break
+
+    # Build response
+    return {
+        'timestamp': timestamp_to_datetime(feed.header.timestamp),
+        'city': 'mnr',
+        'total_trains': len(trains),
+        'trains': trains,
+        'filters_applied': {
+            'origin_station': origin_station,
+            'destination_station': destination_station,
+            'route': route_filter,
+            'time_from': time_from,
+            'time_to': time_to,
+            'fields': fields
+        },
+        'features': FEATURE_FLAGS
+    }
+
+
+def _trains_version(board):
+    """
+    Version of a /trains response: a hash of its trains and filters, so it
+    changes when a train does, but not with the feed timestamp.
+    """
+    content = json.dumps([board['trains'], board['filters_applied']],
+                         sort_keys=True, separators=(',', ':'))
+    return hashlib.sha1(content.encode('utf-8')).hexdigest()[:16]
+
+
 @app.route('/trains', methods=['GET'])
 def get_trains():
     """
@@ -476,89 +595,25 @@ def get_trains():
         route: Filter by route/line ID
         time_from: Filter trains arriving after this time (HH:MM format)
         time_to: Filter trains arriving before this time (HH:MM format)
+        fields: Comma-separated keys of each train to return (default: all),
+            e.g. "trip_id,track,status" for a small display
+
+    The response carries an ETag of its trains (see _trains_version()):
+    clients that send it back in If-None-Match, like the train clock, get
+    304 Not Modified while the board they hold is still current.
 
     Returns:
         JSON response with train information
     """
     try:
-        # Get query parameters
-        city = request.args.get('city', 'mnr').lower()
-        limit_param = request.args.get('limit', 20)
-        try:
-            limit = int(limit_param)
-        except (ValueError, TypeError):
-            return jsonify({
-                'error': f'Invalid value for "limit": {limit_param}. Must be an integer between 1 and 100.'
-            }), 400
-        if not (1 <= limit <= 100):
-            return jsonify({
-                'error': f'Invalid value for "limit": {limit}. Must be an integer between 1 and 100.'
-            }), 400
-        limit = min(limit, 100)
-        origin_station = request.args.get('origin_station')
-        destination_station = request.args.get('destination_station')
-        route_filter = request.args.get('route')
-        time_from = request.args.get('time_from')
-        time_to = request.args.get('time_to')
-
-        # Currently only supports MNR (Metro-North Railroad)
-        if city not in ['mnr', 'metro-north', 'metronorth']:
-            return jsonify({
-                'error': 'Unsupported city. Currently only supports "mnr" (Metro-North Railroad)',
-                'supported_cities': ['mnr', 'metro-north', 'metronorth']
-            }), 400
-
-        # Fetch the GTFS-RT feed
-        feed = client.fetch_feed()
+        query, error = _parse_trains_query()
+        if error is not None:
+            return error
 
-        # Extract trip updates
-        all_trip_updates = client.get_trip_updates(feed)
-
-        # Convert to simplified format and apply filters
-        trains = []
-        for trip_update in all_trip_updates:
-            train_info = extract_train_info(trip_update)
-            # Enrich with GTFS static data
-            if gtfs_reader and gtfs_reader.is_loaded():
-                train_info = gtfs_reader.enrich_train_info(train_info)
-            
-            # Apply filters
-            if route_filter and train_info.get('route_id') != route_filter:
-                continue
-            
-            if origin_station and not _train_passes_through_station(train_info, origin_station):
-                continue
-            
-            if destination_station and not _train_goes_to_destination(train_info, destination_station):
-                continue
-            
-            if time_from or time_to:
-                if not _train_in_time_range(train_info, time_from, time_to):
-                    continue
-            
-            trains.append(train_info)
-            
-            # Apply limit after filtering
-            if len(trains) >= limit:
-                break
-
-        # Build response
-        response = {
-            'timestamp': timestamp_to_datetime(feed.header.timestamp),
-            'city': 'mnr',
-            'total_trains': len(trains),
-            'trains': trains,
-            'filters_applied': {
-                'origin_station': origin_station,
-                'destination_station': destination_station,
-                'route': route_filter,
-                'time_from': time_from,
-                'time_to': time_to
-            },
-            'features': FEATURE_FLAGS
-        }
-
-        return jsonify(response)
+        board = _trains_response(**query)
+        response = jsonify(board)
+        response.set_etag(_trains_version(board))
+        return response.make_conditional(request)
 
     except ValueError as e:
         # Log the actual error for debugging
@@ -582,6 +637,49 @@ def get_trains():
         }), 500
 
 
+@app.route('/trains/stream', methods=['GET'])
+def stream_trains():
+    """
+    Server-Sent Events stream of the /trains board, for push clients such
+    as the Arduino train clock (its PUSH_ENDPOINT).
+
+    Takes the same query parameters as /trains. The feed is refetched every
+    STREAM_CHECK_SECONDS; whenever the filtered trains differ from the last
+    ones sent (and once on connecting), the whole /trains response goes out
+    as a "board" event. Otherwise a heartbeat comment keeps the connection
+    alive. Boards are always full: since= is accepted and ignored.
+
+    Returns:
+        text/event-stream response, or 400 for an invalid parameter
+    """
+    query, error = _parse_trains_query()
+    if error is not None:
+        return error
+
+    def events():
+        last_trains = None
+        while True:
+            try:
+                board = _trains_response(**query)
+            except Exception as e:
+                # Keep the stream open; the client still has the last board
+                app.logger.error(
+                    f"Feed refresh failed in /trains/stream: {type(e).__name__}: {str(e)}")
+                board = None
+
+            if board is not None and board['trains'] != last_trains:
+                last_trains = board['trains']
+                data = json.dumps(board, separators=(',', ':'))
+                yield f"event: board\ndata: {data}\n\n"
+            else:
+                yield ": keep-alive\n\n"
+            time.sleep(STREAM_CHECK_SECONDS)
+
+    response = Response(events(), mimetype='text/event-stream')
+    response.cache_control.no_cache = True
+    return response
+
+
 def _train_passes_through_station(train_info, station_id):
     """
     Check if a train passes through a specific station.
@@ -664,11 +762,29 @@ def _train_in_time_range(train_info, time_from, time_to):
         return False
 
 
+def _stations_version(stations):
+    """
+    Version of a station list: a hash of the IDs, names and codes, so it
+    changes when a station does, but not with the response timestamp.
+    """
+    digest = hashlib.sha1()
+    for station in stations:
+        for field in ('stop_id', 'stop_name', 'stop_code'):
+            digest.update(str(station.get(field, '')).encode('utf-8'))
+            digest.update(b'\0')
+    return digest.hexdigest()[:16]
+
+
 @app.route('/stations', methods=['GET'])
 def get_stations():
     """
     Get list of all available stations.
     
+    The list only changes with the static feed, so it carries a version
+    (also sent as the ETag): clients that keep the list, like the train
+    clock's station index, send it back in If-None-Match and get 304 Not
+    Modified until the stations change.
+    
     Returns:
         JSON response with station information including IDs and names
     """
@@ -680,12 +796,16 @@ def get_stations():
             }), 503
         
         stations = gtfs_reader.get_all_stops()
+        version = _stations_version(stations)
         
-        return jsonify({
+        response = jsonify({
             'timestamp': datetime.now(timezone.utc).isoformat(),
+            'version': version,
             'total_stations': len(stations),
             'stations': stations
         })
+        response.set_etag(version)
+        return response.make_conditional(request)
     
     except Exception as e:
         app.logger.error(f"Unexpected error in /stations: {type(e).__name__}: {str(e)}")
@@ -1101,6 +1221,7 @@ def index():
         '/': 'This information page',
         '/health': 'Health check endpoint',
         '/trains': 'Get real-time train information with filtering options',
+        '/trains/stream': 'Server-Sent Events stream of /trains boards as they change',
         '/stations': 'Get list of all available stations',
         '/routes': 'Get list of all available routes/lines',
         '/train/<trip_id>': 'Get detailed information about a specific train',
@@ -1113,6 +1234,7 @@ def index():
         'filter_by_station': '/trains?origin_station=1&limit=10',
         'filter_by_route': '/trains?route=1&limit=10',
         'filter_by_time': '/trains?time_from=14:00&time_to=16:00',
+        'stream_trains': '/trains/stream?origin_station=1&limit=10',
         'get_stations': '/stations',
         'get_routes': '/routes',
         'get_train_details': '/train/1234567',